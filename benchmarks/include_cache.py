@@ -0,0 +1,78 @@
+"""Time instrument loads with and without the include cache, for an
+instrument split over many #include files.
+
+Usage: python benchmarks/include_cache.py [--includes 200] [--regions 20] [--repeat 5]
+
+Regions play generated sines, so that the times measure reading and
+parsing the SFZ text rather than decoding samples. sfizz parses the whole
+instrument either way; the cache only saves opening and reading each
+include file, while the plain load reads them twice (once to find the
+samples to read ahead, once in sfizz). Every cached load is checked to
+give the same regions as the plain one.
+"""
+import argparse
+import tempfile
+import time
+from pathlib import Path
+
+import pysfizz
+
+
+def write_instrument(directory, num_includes, regions_per_include):
+    (directory / "parts").mkdir()
+    lines = ["#define $VEL 100"]
+    for i in range(num_includes):
+        part = [f"// part {i}", "<group> ampeg_release=0.3"]
+        for j in range(regions_per_include):
+            key = (i * regions_per_include + j) % 128
+            part.append(f"<region> sample=*sine key={key} amp_velcurve_$VEL=1 pitch_keycenter={key}")
+        (directory / "parts" / f"part{i:04d}.sfz").write_text("\n".join(part) + "\n")
+        lines.append(f'#include "parts/part{i:04d}.sfz"')
+    sfz = directory / "instrument.sfz"
+    sfz.write_text("\n".join(lines) + "\n")
+    return sfz
+
+
+def load(sfz, include_cache):
+    synth = pysfizz.Synth()
+    start = time.perf_counter()
+    if not synth.load_sfz_file(sfz, include_cache=include_cache):
+        raise RuntimeError(f"Failed to load {sfz}")
+    return synth, time.perf_counter() - start
+
+
+def regions(synth):
+    return [synth._synth.get_region_data(i) for i in range(synth._synth.get_num_regions())]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--includes", type=int, default=200)
+    parser.add_argument("--regions", type=int, default=20)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        directory = Path(tmp)
+        sfz = write_instrument(directory, args.includes, args.regions)
+        cache = directory / "cache"
+        reference = regions(load(sfz, False)[0])
+        load(sfz, cache)  # builds the cache
+
+        times = {"plain": [], "cached": []}
+        for _ in range(args.repeat):
+            times["plain"].append(load(sfz, False)[1])
+            synth, elapsed = load(sfz, cache)
+            times["cached"].append(elapsed)
+            if regions(synth) != reference:
+                raise AssertionError("The cached load differs from the plain one")
+
+        plain = min(times["plain"]) * 1e3
+        cached = min(times["cached"]) * 1e3
+        print(f"{args.includes} includes of {args.regions} regions")
+        print(f"{'plain ms':>10}{'cached ms':>12}{'speedup':>10}")
+        print(f"{plain:>10.1f}{cached:>12.1f}{plain / cached:>9.2f}x")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+"""Time instrument loads against the number of load threads, with the sample
+files evicted from the page cache before every load (cold) or not (warm).
+
+Usage: python benchmarks/load.py [--samples 512] [--seconds 2] [--dir DIR] [--repeat 3]
+                                 [--format wav|flac]
+
+Cold loads need posix_fadvise (Linux); point --dir at the disk to measure,
+since a tmpfs directory never leaves memory. Every load is checked to give
+the same regions and the same audio as the serial one.
+
+--format flac writes the samples as FLAC (this needs the soundfile
+package) and times loads with decode_cache: "decode" loads start from an
+empty decode cache, so the samples are decoded on the load threads, and
+"reuse" loads find them decoded. Without the cache, sfizz decodes FLAC
+serially whatever the thread count.
+"""
+import argparse
+import os
+import tempfile
+import time
+import wave
+from pathlib import Path
+
+import numpy as np
+import pysfizz
+
+
+def write_library(directory, num_samples, seconds, fmt="wav"):
+    sr = 48000
+    t = np.arange(int(sr * seconds)) / sr
+    lines = ["<control> default_path=samples/"]
+    (directory / "samples").mkdir()
+    for i in range(num_samples):
+        tone = np.sin(2 * np.pi * (55 + i) * t) * np.exp(-t)
+        stereo = np.stack([tone, tone[::-1]], axis=1)
+        pcm = (0.5 * stereo * 32767).astype(np.int16)
+        name = f"s{i:04d}.{fmt}"
+        if fmt == "flac":
+            import soundfile
+            soundfile.write(str(directory / "samples" / name), pcm, sr, subtype="PCM_16")
+        else:
+            with wave.open(str(directory / "samples" / name), "wb") as f:
+                f.setnchannels(2)
+                f.setsampwidth(2)
+                f.setframerate(sr)
+                f.writeframes(pcm.tobytes())
+        lines.append(f"<region> sample={name} key={i % 128} lovel={1 + (i // 128) % 127}")
+    sfz = directory / "library.sfz"
+    sfz.write_text("\n".join(lines) + "\n")
+    return sfz
+
+
+def evict(directory):
+    for path in (directory / "samples").iterdir():
+        fd = os.open(path, os.O_RDONLY)
+        try:
+            os.fsync(fd)
+            os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+        finally:
+            os.close(fd)
+
+
+def load(sfz, threads, decode_cache=False):
+    synth = pysfizz.Synth()
+    synth.set_load_threads(threads)
+    start = time.perf_counter()
+    if not synth.load_sfz_file(sfz, decode_cache=decode_cache):
+        raise RuntimeError(f"Failed to load {sfz}")
+    return synth, time.perf_counter() - start
+
+
+def fingerprint(synth):
+    regions = [synth._synth.get_region_data(i) for i in range(synth._synth.get_num_regions())]
+    # decoded samples are named by their cache file
+    for region in regions:
+        region.pop("sample_id", None)
+    return regions, synth.render_note(60, 100, 0.5, 1.0)
+
+
+def decode_benchmark(directory, sfz, counts, repeat, reference):
+    print(f"{'threads':>8}{'plain ms':>12}{'decode ms':>12}{'speedup':>10}{'reuse ms':>12}")
+    for threads in counts:
+        times = {"plain": [], "decode": [], "reuse": []}
+        for attempt in range(repeat):
+            times["plain"].append(load(sfz, threads)[1])
+            cache = directory / f"decoded-{threads}-{attempt}"
+            synth, elapsed = load(sfz, threads, cache)
+            times["decode"].append(elapsed)
+            times["reuse"].append(load(sfz, threads, cache)[1])
+        regions, audio = fingerprint(synth)
+        if regions != reference[0] or not np.array_equal(audio, reference[1]):
+            raise AssertionError(f"Load with decoded samples on {threads} threads differs from the plain load")
+        plain, decode, reuse = (min(times[k]) * 1e3 for k in ("plain", "decode", "reuse"))
+        print(f"{threads:>8}{plain:>12.1f}{decode:>12.1f}{plain / decode:>9.2f}x{reuse:>12.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--samples", type=int, default=512)
+    parser.add_argument("--seconds", type=float, default=2.0)
+    parser.add_argument("--dir", type=Path, default=None)
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--format", choices=("wav", "flac"), default="wav")
+    args = parser.parse_args()
+
+    cores = os.cpu_count() or 1
+    counts = sorted({1, 2, 4, 8, cores} & set(range(1, cores + 1)))
+    cold = hasattr(os, "posix_fadvise")
+    with tempfile.TemporaryDirectory(dir=args.dir) as tmp:
+        directory = Path(tmp)
+        sfz = write_library(directory, args.samples, args.seconds, args.format)
+        reference = fingerprint(load(sfz, 1)[0])
+        if args.format == "flac":
+            decode_benchmark(directory, sfz, counts, args.repeat, reference)
+            return
+
+        print(f"{args.samples} samples of {args.seconds} s, {cores} cores")
+        print(f"{'threads':>8}{'cold ms':>12}{'speedup':>10}{'warm ms':>12}")
+        base = None
+        for threads in counts:
+            times = {"cold": [], "warm": []}
+            for _ in range(args.repeat):
+                for mode in ("cold", "warm"):
+                    if mode == "cold":
+                        if not cold:
+                            continue
+                        evict(directory)
+                    synth, elapsed = load(sfz, threads)
+                    times[mode].append(elapsed)
+            regions, audio = fingerprint(synth)
+            if regions != reference[0] or not np.array_equal(audio, reference[1]):
+                raise AssertionError(f"Load with {threads} threads differs from the serial load")
+
+            cold_ms = min(times["cold"]) * 1e3 if times["cold"] else float("nan")
+            base = base or cold_ms
+            speedup = f"{base / cold_ms:.2f}x" if times["cold"] else "-"
+            print(f"{threads:>8}{cold_ms:>12.1f}{speedup:>10}{min(times['warm']) * 1e3:>12.1f}")
+
+
+if __name__ == "__main__":
+    main()
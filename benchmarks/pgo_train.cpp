@@ -0,0 +1,151 @@
+// Training workload for profile-guided builds (PYSFIZZ_PGO).
+// Renders synthetic instruments covering the usual hot paths: file-backed
+// and generated samples, loops and one-shots, filters with envelope and CC
+// modulation, LFOs, sustain pedal, pitch wheel and polyphony from one to
+// one hundred voices, through the same render core as the bindings.
+//
+// Usage: pysfizz_pgo_train <working directory>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "engine.h"
+
+namespace {
+
+constexpr int kBlockSize = 1024;
+
+void writeU32(std::ofstream& out, uint32_t value) {
+    const char bytes[4] = { char(value), char(value >> 8), char(value >> 16), char(value >> 24) };
+    out.write(bytes, 4);
+}
+
+void writeU16(std::ofstream& out, uint16_t value) {
+    const char bytes[2] = { char(value), char(value >> 8) };
+    out.write(bytes, 2);
+}
+
+// One second of a harmonic-rich 16-bit mono tone
+bool writeTone(const std::string& path, int sampleRate, double frequency, int harmonics) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+
+    const double pi = 3.14159265358979323846;
+    std::vector<double> tone(sampleRate);
+    double peak = 0.0;
+    for (int i = 0; i < sampleRate; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+        for (int k = 1; k <= harmonics; ++k)
+            tone[i] += std::sin(2.0 * pi * frequency * k * t) / k;
+        peak = std::max(peak, std::abs(tone[i]));
+    }
+
+    const uint32_t dataSize = static_cast<uint32_t>(sampleRate) * 2;
+    out.write("RIFF", 4);
+    writeU32(out, 36 + dataSize);
+    out.write("WAVEfmt ", 8);
+    writeU32(out, 16);
+    writeU16(out, 1);
+    writeU16(out, 1);
+    writeU32(out, static_cast<uint32_t>(sampleRate));
+    writeU32(out, static_cast<uint32_t>(sampleRate) * 2);
+    writeU16(out, 2);
+    writeU16(out, 16);
+    out.write("data", 4);
+    writeU32(out, dataSize);
+    for (double value : tone)
+        writeU16(out, static_cast<uint16_t>(static_cast<int16_t>(0.5 * value / peak * 32767.0)));
+    return static_cast<bool>(out);
+}
+
+const char* kInstruments[] = {
+    // Looped file sample through a resonant low-pass with filter envelope
+    "<global> sample=tone.wav pitch_keycenter=48 loop_mode=loop_continuous\n"
+    "<region> lokey=0 hikey=127 fil_type=lpf_2p cutoff=800 resonance=6 fileg_depth=2400"
+    " fileg_decay=0.5 fileg_sustain=30 cutoff_oncc74=3600 ampeg_attack=0.01 ampeg_release=0.4\n",
+
+    // Velocity layers of generated waveforms with LFOs and a high-pass
+    "<region> sample=*saw hivel=63 fil_type=hpf_2p cutoff=200 amplfo_freq=5 amplfo_depth=2"
+    " ampeg_release=0.2\n"
+    "<region> sample=*square lovel=64 fil_type=lpf_4p cutoff=3000 fillfo_freq=0.5 fillfo_depth=1200"
+    " pitchlfo_freq=6 pitchlfo_depth=15 ampeg_release=0.3\n"
+    "<region> sample=*sine transpose=12 volume=-12 ampeg_release=1\n",
+
+    // Percussive one-shots on split keys with band-pass noise
+    "<region> sample=*noise hikey=59 loop_mode=one_shot fil_type=bpf_2p cutoff=1500 resonance=3"
+    " ampeg_decay=0.15 ampeg_sustain=0\n"
+    "<region> sample=tone.wav lokey=60 pitch_keycenter=72 loop_mode=one_shot offset=2000"
+    " fil_type=lpf_1p cutoff=5000 ampeg_decay=0.3 ampeg_sustain=0\n",
+};
+
+// Chord of the given size with sustain, pitch wheel and filter sweeps
+std::vector<pysfizz::Event> chord(int polyphony, int sampleRate) {
+    using pysfizz::EventType;
+    std::vector<pysfizz::Event> events;
+    events.push_back({ 0, EventType::cc, 64, 127 });
+    for (int v = 0; v < polyphony; ++v)
+        events.push_back({ v * kBlockSize / 8, EventType::note_on, 24 + (v * 7) % 84, 30 + (v * 37) % 97 });
+    for (int step = 0; step < 8; ++step) {
+        const int64_t frame = static_cast<int64_t>(step) * sampleRate / 8;
+        events.push_back({ frame, EventType::cc, 74, step * 16 });
+        events.push_back({ frame, EventType::pitch_wheel, (step - 4) * 1024, 0 });
+    }
+    for (int v = 0; v < polyphony; ++v)
+        events.push_back({ sampleRate, EventType::note_off, 24 + (v * 7) % 84, 64 });
+    events.push_back({ sampleRate, EventType::cc, 64, 0 });
+    events.push_back({ sampleRate, EventType::pitch_wheel, 0, 0 });
+    std::stable_sort(events.begin(), events.end(),
+        [](const pysfizz::Event& a, const pysfizz::Event& b) { return a.frame < b.frame; });
+    return events;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string directory = (argc > 1) ? argv[1] : ".";
+    if (!writeTone(directory + "/tone.wav", 48000, 110.0, 40)) {
+        std::fprintf(stderr, "Cannot write the training sample in %s\n", directory.c_str());
+        return 1;
+    }
+
+    const int sampleRates[] = { 44100, 48000 };
+    const int polyphonies[] = { 1, 8, 32, 100 };
+
+    for (int rate : sampleRates) {
+        pysfizz::Engine engine(rate, kBlockSize);
+        engine.setNumVoices(128);
+        engine.enableFreeWheeling();
+
+        int index = 0;
+        for (const char* instrument : kInstruments) {
+            const std::string path = directory + "/instrument" + std::to_string(index) + ".sfz";
+            std::ofstream(path) << instrument;
+            if (!engine.loadSfzFile(path)) {
+                std::fprintf(stderr, "Cannot load training instrument %s\n", path.c_str());
+                return 1;
+            }
+
+            for (int polyphony : polyphonies) {
+                // Alternate the output paths: plain stereo, and downmix with
+                // resampling, statistics and normalization
+                pysfizz::RenderOptions options;
+                if (index++ % 2 == 1) {
+                    options.channels = "mono";
+                    options.outputSampleRate = 16000;
+                    options.stats = true;
+                    options.normalize = "loudness";
+                    options.target = -23.0;
+                }
+                engine.renderEvents(chord(polyphony, rate), 1.5, options);
+            }
+            engine.renderNote(60, 100, 0.5, 1.0, pysfizz::RenderOptions());
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+"""Time a set of representative renders, to compare two builds of pysfizz
+(for example a default build against a PYSFIZZ_PGO=ON build).
+
+Usage: python benchmarks/render.py [--repeat 5] [--save times.json] [--baseline times.json]
+
+Run once with the default build and --save, then with the other build and
+--baseline pointing at the saved file to get the speedup of each case.
+"""
+import argparse
+import json
+import tempfile
+import time
+import wave
+from pathlib import Path
+
+import numpy as np
+import pysfizz
+
+INSTRUMENTS = {
+    "looped": "<region> sample=tone.wav pitch_keycenter=48 loop_mode=loop_continuous"
+              " fil_type=lpf_2p cutoff=800 resonance=6 fileg_depth=2400 fileg_decay=0.5 ampeg_release=0.4\n",
+    "generated": "<region> sample=*saw fil_type=lpf_4p cutoff=3000 fillfo_freq=0.5 fillfo_depth=1200"
+                 " amplfo_freq=5 amplfo_depth=2 ampeg_release=0.3\n",
+    "one_shot": "<region> sample=*noise loop_mode=one_shot fil_type=bpf_2p cutoff=1500"
+                " ampeg_decay=0.15 ampeg_sustain=0\n",
+}
+
+
+def write_instruments(directory):
+    sr = 48000
+    t = np.arange(sr) / sr
+    tone = sum(np.sin(2 * np.pi * 110 * k * t) / k for k in range(1, 40))
+    tone = (0.5 * tone / np.abs(tone).max() * 32767).astype(np.int16)
+    with wave.open(str(directory / "tone.wav"), "wb") as f:
+        f.setnchannels(1)
+        f.setsampwidth(2)
+        f.setframerate(sr)
+        f.writeframes(tone.tobytes())
+    paths = {}
+    for name, text in INSTRUMENTS.items():
+        paths[name] = directory / f"{name}.sfz"
+        paths[name].write_text(text)
+    return paths
+
+
+def chord(polyphony, duration=2.0):
+    rows = []
+    for v in range(polyphony):
+        rows.append((0.001 * v, "note_on", 24 + (v * 7) % 84, 30 + (v * 37) % 97))
+        rows.append((duration, "note_off", 24 + (v * 7) % 84, 64))
+    return pysfizz.event_array(rows)
+
+
+def cases(paths):
+    for name, path in paths.items():
+        yield f"{name}, single note", path, lambda s: s.render_note(60, 100, 1.0, 1.5)
+        for polyphony in (16, 64):
+            events = chord(polyphony)
+            yield f"{name}, {polyphony} voices", path, lambda s, e=events: s.render_events(e, 3.0)
+    events = chord(32)
+    yield "looped, 32 voices, mono 16 kHz + stats", paths["looped"], lambda s: s.render_events(
+        events, 3.0, channels="mono", output_sample_rate=16000, stats=True, normalize="loudness")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--save", type=Path)
+    parser.add_argument("--baseline", type=Path)
+    args = parser.parse_args()
+
+    baseline = json.loads(args.baseline.read_text()) if args.baseline else {}
+    times = {}
+
+    print(f"pgo build: {pysfizz._sfizz.pgo}, simd: {pysfizz.simd_path()}")
+    print(f"{'case':<44}{'ms/render':>12}{'speedup':>10}")
+    with tempfile.TemporaryDirectory() as tmp:
+        paths = write_instruments(Path(tmp))
+        for name, path, render in cases(paths):
+            synth = pysfizz.Synth(sample_rate=48000)
+            synth.load_sfz_file(path)
+            synth._synth.set_num_voices(128)
+            render(synth)
+            start = time.perf_counter()
+            for _ in range(args.repeat):
+                render(synth)
+            times[name] = (time.perf_counter() - start) / args.repeat
+            speedup = f"{baseline[name] / times[name]:.2f}x" if name in baseline else "-"
+            print(f"{name:<44}{times[name] * 1e3:>12.2f}{speedup:>10}")
+
+    if baseline:
+        common = [name for name in times if name in baseline]
+        if common:
+            geomean = np.exp(np.mean([np.log(baseline[name] / times[name]) for name in common]))
+            print(f"{'geometric mean speedup':<44}{'':>12}{geomean:>9.2f}x")
+    if args.save:
+        args.save.write_text(json.dumps(times, indent=2))
+
+
+if __name__ == "__main__":
+    main()
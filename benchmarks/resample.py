@@ -0,0 +1,73 @@
+"""Compare rendering directly at a low sample rate against rendering at the
+synth rate and resampling with output_sample_rate.
+
+Usage: python benchmarks/resample.py [--rate 16000] [--repeat 5]
+
+The reference is a 48 kHz render at sample quality 10, resampled with the
+"best" preset; error is the RMS difference to it in dB (lower is better).
+"""
+import argparse
+import tempfile
+import time
+import wave
+from pathlib import Path
+
+import numpy as np
+import pysfizz
+
+
+def write_instrument(directory):
+    # one second of a 55 Hz harmonic-rich tone, played two octaves up
+    sr = 48000
+    t = np.arange(sr) / sr
+    tone = sum(np.sin(2 * np.pi * 55 * k * t) / k for k in range(1, 200))
+    tone = (0.3 * tone / np.abs(tone).max() * 32767).astype(np.int16)
+    with wave.open(str(directory / "tone.wav"), "wb") as f:
+        f.setnchannels(1)
+        f.setsampwidth(2)
+        f.setframerate(sr)
+        f.writeframes(tone.tobytes())
+    sfz = directory / "tone.sfz"
+    sfz.write_text("<region> sample=tone.wav pitch_keycenter=36 loop_mode=loop_continuous ampeg_release=0.2\n")
+    return sfz
+
+
+def render(sfz, sample_rate, repeat, quality=None, **kwargs):
+    synth = pysfizz.Synth(sample_rate=sample_rate)
+    synth.load_sfz_file(sfz)
+    if quality is not None:
+        synth._synth.set_sample_quality(quality)
+    audio = synth.render_note(60, 100, 1.0, 1.5, **kwargs)
+    start = time.perf_counter()
+    for _ in range(repeat):
+        audio = synth.render_note(60, 100, 1.0, 1.5, **kwargs)
+    return audio, (time.perf_counter() - start) / repeat
+
+
+def error_db(audio, reference):
+    n = min(audio.shape[-1], reference.shape[-1])
+    diff = audio[..., :n] - reference[..., :n]
+    return 10 * np.log10(np.mean(diff ** 2) / np.mean(reference[..., :n] ** 2) + 1e-20)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--rate", type=int, default=16000)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        sfz = write_instrument(Path(tmp))
+        reference, _ = render(sfz, 48000, 1, quality=10, output_sample_rate=args.rate, resample_quality="best")
+
+        print(f"{'method':<36}{'ms/render':>12}{'error dB':>12}")
+        for quality in (1, 2, 3, 10):
+            audio, elapsed = render(sfz, args.rate, args.repeat, quality=quality)
+            print(f"{f'direct {args.rate} Hz, sample_quality={quality}':<36}{elapsed * 1e3:>12.2f}{error_db(audio, reference):>12.1f}")
+        for preset in ("fast", "medium", "best"):
+            audio, elapsed = render(sfz, 48000, args.repeat, output_sample_rate=args.rate, resample_quality=preset)
+            print(f"{f'48000 Hz -> {args.rate} Hz, {preset}':<36}{elapsed * 1e3:>12.2f}{error_db(audio, reference):>12.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,4 +1,26 @@
 from . import _sfizz
 from .synth import Synth
+from .multirate import MultiRateSynth
+from .ensemble import Ensemble
+from .events import EVENT_TYPES, event_array
+from .memory_samples import SampleBank
+from .packs import pack_instrument, open_instrument, unpack_instrument, remove_unpacked
+from .registry import InstrumentRegistry, instrument_registry
+
+# Stopping long renders: pass cancel=CancelToken() or timeout=seconds to a
+# render method; a stopped render raises RenderCancelled or RenderTimeout
+CancelToken = _sfizz.CancelToken
+RenderCancelled = _sfizz.RenderCancelled
+RenderTimeout = _sfizz.RenderTimeout
+
+# Progress of renders and loads: pass progress=Progress() and poll it from
+# another thread, or give it a callback called at most every interval seconds
+Progress = _sfizz.Progress
+
+# SIMD variant of the native kernels, picked at import time from the CPU
+# features (override with the PYSFIZZ_SIMD environment variable)
+simd_path = _sfizz.get_simd_path
+simd_paths = _sfizz.get_simd_paths
+set_simd_path = _sfizz.set_simd_path
 
 __version__ = "0.1.3"
\ No newline at end of file
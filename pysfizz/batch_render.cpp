@@ -0,0 +1,268 @@
+// pysfizz-render: render a manifest of jobs to WAV files on native threads.
+//
+// Usage: pysfizz-render MANIFEST [--threads N] [--sample-rate HZ]
+//                       [--block-size N] [--voices N] [--quiet] [--progress]
+//
+// MANIFEST is JSON Lines, or CSV with a header row when it ends in .csv;
+// see makeJob() in manifest.h for the fields. Relative paths in it are
+// relative to the manifest's directory. Each worker thread keeps its own
+// engines, so an instrument is loaded at most once per thread as long as
+// it stays among the last few the thread used; jobs are grouped by
+// instrument to make that the common case.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "engine.h"
+#include "manifest.h"
+#include "midi_file.h"
+#include "wav_writer.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Settings {
+    std::string manifest;
+    size_t threads = 0;
+    int sampleRate = 48000;
+    int blockSize = 1024;
+    int voices = 0;
+    bool quiet = false;
+    bool progress = false;
+};
+
+// Engines kept by each worker
+constexpr size_t kEnginesPerWorker = 4;
+
+void usage() {
+    std::fprintf(stderr,
+        "Usage: pysfizz-render MANIFEST [--threads N] [--sample-rate HZ] [--block-size N] [--voices N] [--quiet]\n"
+        "                      [--progress]\n"
+        "Render every job of a JSONL or CSV manifest to a WAV file.\n"
+        "--progress reports jobs, frames and sample data loaded every second.\n");
+}
+
+std::string resolve(const fs::path& base, const std::string& path) {
+    const fs::path p(path);
+    return p.is_absolute() ? path : (base / p).string();
+}
+
+// Most recently used engines of one worker, keyed by instrument and rate
+class EngineCache {
+public:
+    EngineCache(const Settings& settings, pysfizz::Progress& progress) : settings_(settings), progress_(progress) {}
+
+    pysfizz::Engine& get(const std::string& instrument, int sampleRate, size_t& loads) {
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->instrument == instrument && it->sampleRate == sampleRate) {
+                entries_.splice(entries_.begin(), entries_, it);
+                return *entries_.front().engine;
+            }
+        }
+
+        if (entries_.size() >= kEnginesPerWorker)
+            entries_.pop_back();
+        std::unique_ptr<pysfizz::Engine> engine(new pysfizz::Engine(sampleRate, settings_.blockSize));
+        engine->enableFreeWheeling();
+        if (settings_.voices > 0)
+            engine->setNumVoices(settings_.voices);
+        if (!engine->loadSfzFile(instrument, &progress_))
+            throw std::runtime_error("Failed to load " + instrument);
+        ++loads;
+        entries_.push_front({ instrument, sampleRate, std::move(engine) });
+        return *entries_.front().engine;
+    }
+
+private:
+    struct Entry {
+        std::string instrument;
+        int sampleRate;
+        std::unique_ptr<pysfizz::Engine> engine;
+    };
+
+    const Settings& settings_;
+    pysfizz::Progress& progress_;
+    std::list<Entry> entries_;
+};
+
+// Render one job and write it; returns the seconds of audio written
+double renderJob(const pysfizz::Job& job, const fs::path& base, const Settings& settings, EngineCache& cache,
+                 size_t& loads, pysfizz::Progress& progress) {
+    const int sampleRate = job.sampleRate > 0 ? job.sampleRate : settings.sampleRate;
+    pysfizz::Engine& engine = cache.get(resolve(base, job.instrument), sampleRate, loads);
+
+    // Controller state first, so that it applies before the first note
+    std::vector<double> rows;
+    for (const auto& cc : job.ccState)
+        rows.insert(rows.end(), { 0.0, double(pysfizz::EventType::cc), double(cc.first), double(cc.second) });
+
+    double end = 0.0;
+    std::vector<pysfizz::Event> events;
+    if (!job.midiFile.empty()) {
+        pysfizz::MidiFile midi = pysfizz::readMidiFile(resolve(base, job.midiFile), sampleRate);
+        events = pysfizz::makeEvents(rows.data(), rows.size() / 4, sampleRate);
+        events.insert(events.end(), midi.events.begin(), midi.events.end());
+        end = midi.duration;
+    } else {
+        for (const auto& note : job.notes) {
+            if (note.start < 0 || note.duration < 0)
+                throw std::invalid_argument("Note times must be non-negative");
+            rows.insert(rows.end(), { note.start, double(pysfizz::EventType::note_on), double(note.pitch), double(note.velocity) });
+            rows.insert(rows.end(), { note.start + note.duration, double(pysfizz::EventType::note_off), double(note.pitch), 0.0 });
+            end = std::max(end, note.start + note.duration);
+        }
+        events = pysfizz::makeEvents(rows.data(), rows.size() / 4, sampleRate);
+    }
+
+    const double renderDur = job.renderDur >= 0 ? job.renderDur : end + job.tail;
+    engine.resetAllControllers();
+    pysfizz::RenderOptions options = job.options;
+    options.progress = &progress;
+    pysfizz::RenderOutput output = engine.renderEvents(events, renderDur, options);
+
+    const int outputRate = pysfizz::outputSampleRate(job.options, sampleRate);
+    const std::string path = resolve(base, job.output);
+    const fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty())
+        fs::create_directories(parent);
+    pysfizz::writeWav(path, output.channel(0), output.numChannels(), output.numFrames(), outputRate, job.float32);
+    return static_cast<double>(output.numFrames()) / outputRate;
+}
+
+bool parseArguments(int argc, char** argv, Settings& settings) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> long {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(arg + " needs a value");
+            char* end = nullptr;
+            const long number = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || number < 0)
+                throw std::invalid_argument(arg + " needs a non-negative integer");
+            return number;
+        };
+        if (arg == "--threads")
+            settings.threads = static_cast<size_t>(value());
+        else if (arg == "--sample-rate")
+            settings.sampleRate = static_cast<int>(value());
+        else if (arg == "--block-size")
+            settings.blockSize = static_cast<int>(value());
+        else if (arg == "--voices")
+            settings.voices = static_cast<int>(value());
+        else if (arg == "--quiet")
+            settings.quiet = true;
+        else if (arg == "--progress")
+            settings.progress = true;
+        else if (arg == "-h" || arg == "--help")
+            return false;
+        else if (!arg.empty() && arg[0] == '-')
+            throw std::invalid_argument("Unknown option " + arg);
+        else if (settings.manifest.empty())
+            settings.manifest = arg;
+        else
+            throw std::invalid_argument("Only one manifest can be given");
+    }
+    if (settings.sampleRate <= 0 || settings.blockSize <= 0)
+        throw std::invalid_argument("Sample rate and block size must be positive");
+    return !settings.manifest.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    std::vector<pysfizz::Job> jobs;
+    try {
+        if (!parseArguments(argc, argv, settings)) {
+            usage();
+            return 2;
+        }
+        jobs = pysfizz::readManifest(settings.manifest);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "pysfizz-render: %s\n", e.what());
+        return 2;
+    }
+
+    const fs::path base = fs::path(settings.manifest).parent_path();
+    if (settings.threads == 0)
+        settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    settings.threads = std::max<size_t>(1, std::min(settings.threads, jobs.size()));
+
+    // Group jobs by instrument and rate, so that workers mostly reuse engines
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        if (jobs[a].instrument != jobs[b].instrument)
+            return jobs[a].instrument < jobs[b].instrument;
+        return jobs[a].sampleRate < jobs[b].sampleRate;
+    });
+
+    std::atomic<size_t> next { 0 };
+    std::atomic<size_t> failed { 0 };
+    std::atomic<size_t> loads { 0 };
+    std::mutex outputMutex;
+    double audioSeconds = 0.0;
+
+    pysfizz::Progress progress;
+    progress.addJobsTotal(static_cast<int64_t>(jobs.size()));
+    if (settings.progress) {
+        progress.setCallback([&outputMutex](const pysfizz::Progress& p) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::fprintf(stderr, "Progress: %lld/%lld jobs, %lld frames rendered, %.1f MB of samples loaded\n",
+                static_cast<long long>(p.jobsDone()), static_cast<long long>(p.jobsTotal()),
+                static_cast<long long>(p.framesDone()), p.bytesLoaded() / 1e6);
+        }, std::chrono::seconds(1));
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < settings.threads; ++t) {
+        workers.emplace_back([&]() {
+            EngineCache cache(settings, progress);
+            size_t workerLoads = 0;
+            double workerSeconds = 0.0;
+            for (size_t n; (n = next.fetch_add(1)) < jobs.size();) {
+                const pysfizz::Job& job = jobs[order[n]];
+                try {
+                    workerSeconds += renderJob(job, base, settings, cache, workerLoads, progress);
+                    if (!settings.quiet) {
+                        std::lock_guard<std::mutex> lock(outputMutex);
+                        std::printf("%s\n", job.output.c_str());
+                    }
+                } catch (const std::exception& e) {
+                    ++failed;
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::fprintf(stderr, "%s:%zu: %s\n", settings.manifest.c_str(), job.line, e.what());
+                }
+                progress.jobDone();
+            }
+            loads += workerLoads;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            audioSeconds += workerSeconds;
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const size_t rendered = jobs.size() - failed;
+    std::fprintf(stderr,
+        "Rendered %zu of %zu jobs in %.2f s on %zu threads (%zu instrument loads)\n"
+        "Throughput: %.2f jobs/s, %.1f s of audio, %.1fx real time\n",
+        rendered, jobs.size(), elapsed, settings.threads, loads.load(),
+        elapsed > 0 ? rendered / elapsed : 0.0, audioSeconds, elapsed > 0 ? audioSeconds / elapsed : 0.0);
+    return failed > 0 ? 1 : 0;
+}
@@ -5,577 +5,913 @@
 #include <nanobind/stl/optional.h>
 #include <nanobind/stl/tuple.h>
 #include <nanobind/ndarray.h>
-#include <sfizz.hpp>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <sfizz/Synth.h>
 #include <sfizz/Region.h>
 #include <sfizz/Defaults.h>
-#include <sfizz/sfizz_private.hpp>
-#include <sfizz/SynthConfig.h>
+#include "cancel.h"
+#include "engine.h"
+#include "events.h"
+#include "kernels.h"
+#include "render_output.h"
+#include "thread_pool.h"
 
 namespace nb = nanobind;
 
-class Synth {
-private:
-    sfz::Sfizz synth_;
-    sfizz_synth_t* synth_handle_;
-    std::vector<float> leftBuffer_;
-    std::vector<float> rightBuffer_;
-    int sampleRate_;
-    int blockSize_;
+// Event list as passed from Python: rows of (time, type, data1, data2)
+using EventArray = nb::ndarray<const double, nb::shape<-1, 4>, nb::c_contig, nb::device::cpu>;
+
+// Caller-provided destination of a render, e.g. a view of shared memory
+using OutArray = nb::ndarray<float, nb::c_contig, nb::device::cpu>;
+
+// === NATIVE RENDER HELPERS ===
+
+// Statistics measured on the rendered output, before normalization
+static std::map<std::string, nb::object> makeStatsDict(const pysfizz::RenderStats& stats, double gainDb) {
+    using pysfizz::RenderStats;
+    std::map<std::string, nb::object> result;
     
-public:
-    // CONSTRUCTOR: Initialize synth with audio configuration
-    // Based on sfizz Config.h: defaultSampleRate=48000, defaultSamplesPerBlock=1024
-    Synth(int sampleRate = 48000, int blockSize = 1024) 
-        : sampleRate_(sampleRate), blockSize_(blockSize) {
-        
-        // Cache handle once in constructor
-        synth_handle_ = synth_.handle();
-        if (!synth_handle_) {
-            throw std::runtime_error("Failed to get synth handle");
-        }
-        
-        // Configure synth audio settings (from Synth.cpp setSampleRate/setSamplesPerBlock)
-        synth_.setSampleRate(sampleRate);
-        synth_.setSamplesPerBlock(blockSize);
-        
-        // Allocate stereo buffers for rendering
-        leftBuffer_.resize(blockSize);
-        rightBuffer_.resize(blockSize);
-    }
+    result["num_frames"] = nb::int_(stats.numFrames());
+    
+    // Sample peak, linear and in dBFS
+    result["peak"] = nb::float_(stats.peak());
+    result["peak_db"] = nb::float_(RenderStats::toDecibels(stats.peak()));
+    
+    // RMS over all channels, linear and in dBFS
+    result["rms"] = nb::float_(stats.rms());
+    result["rms_db"] = nb::float_(RenderStats::toDecibels(stats.rms()));
     
-    // === PARSER METHODS ===
+    // EBU R128 gated integrated loudness in LUFS (-inf for silence or < 400 ms)
+    result["loudness_lufs"] = nb::float_(stats.integratedLoudness());
     
-    // Load SFZ file into the synth's internal parser
-    // Based on sfizz Synth.cpp loadSfzFile() method
-    bool loadSfzFile(const std::string& path) {
-        return synth_.loadSfzFile(path);
+    nb::list channelPeaks, channelRms;
+    for (size_t c = 0; c < stats.numChannels(); ++c) {
+        channelPeaks.append(nb::float_(stats.channelPeak(c)));
+        channelRms.append(nb::float_(stats.channelRms(c)));
     }
+    result["channel_peak"] = channelPeaks;
+    result["channel_rms"] = channelRms;
     
-    // Get number of regions parsed from SFZ file
-    // Based on sfizz Synth.cpp getNumRegions() method
-    int getNumRegions() const {
-        return synth_.getNumRegions();
+    // Gain applied by normalization in dB (0 when disabled)
+    result["normalization_gain_db"] = nb::float_(gainDb);
+    
+    return result;
+}
+
+// Hand the rendered buffer over to NumPy, plus the statistics if requested
+// Output rendered into a caller array (out) returns that array instead
+static nb::object makeRenderResult(pysfizz::RenderOutput& output, const pysfizz::RenderOptions& options,
+                                   nb::handle out = nb::handle()) {
+    const size_t numChannels = output.numChannels();
+    const size_t numFrames = output.numFrames();
+    nb::object audio;
+    if (float* data = output.release()) {
+        nb::capsule owner(data, [](void* p) noexcept { delete[] static_cast<float*>(p); });
+        // Single-channel layouts come back as 1-D arrays
+        audio = (numChannels == 1)
+            ? nb::cast(nb::ndarray<nb::numpy, float, nb::ndim<1>>(data, { numFrames }, owner))
+            : nb::cast(nb::ndarray<nb::numpy, float, nb::ndim<2>>(data, { numChannels, numFrames }, owner));
+    } else {
+        audio = nb::borrow<nb::object>(out);
     }
     
-    // Get detailed region data for analysis
-    // Based on sfizz Region.h and SynthPrivate.h region access
-    std::map<std::string, nb::object> getRegionData(int regionIndex) const {
-        if (regionIndex < 0 || regionIndex >= synth_.getNumRegions()) {
-            throw nb::value_error("Region index out of range");
-        }
-        
-        const auto* region = synth_handle_->synth.getRegionView(regionIndex);
-        if (!region) {
-            throw nb::value_error("Failed to access region");
-        }
-        
-        std::map<std::string, nb::object> region_data;
-        
-        // ============================================================================
-        // BASIC REGION INFORMATION
-        // ============================================================================
-        
-        // Unique identifier for this region (0-based index)
-        region_data["id"] = nb::int_(region->getId().number());
-        
-        // Sample filename (e.g., "piano_C4.wav", "*sine", "*silence")
-        // Note: "*" prefix indicates generated samples (sine wave, silence, etc.)
-        region_data["sample_id"] = nb::str(region->sampleId->filename().c_str());
-        
-        // ============================================================================
-        // KEY MAPPING (MIDI Note Numbers: 0-127)
-        // ============================================================================
-        
-        // Lowest MIDI note number that triggers this region (default: 0)
-        // Range: 0-127, where 60 = middle C
-        region_data["lokey"] = nb::int_(region->keyRange.getStart());
-        
-        // Highest MIDI note number that triggers this region (default: 127)
-        // Range: 0-127, where 60 = middle C
-        region_data["hikey"] = nb::int_(region->keyRange.getEnd());
-        
-        // Pitch keycenter - the root note of the sample (default: 60 = middle C)
-        // This is the note that plays at the sample's original pitch
-        // Range: 0-127, where 60 = middle C
-        region_data["key"] = nb::int_(region->pitchKeycenter);
-        
-        // ============================================================================
-        // VELOCITY MAPPING (MIDI Velocity: 0-127)
-        // ============================================================================
-        
-        // Lowest velocity value that triggers this region (default: 0.0)
-        // Range: 0.0-1.0 (normalized MIDI velocity, 1.0 = MIDI velocity 127)
-        region_data["lovel"] = nb::float_(region->velocityRange.getStart());
-        
-        // Highest velocity value that triggers this region (default: 1.0)
-        // Range: 0.0-1.0 (normalized MIDI velocity, 1.0 = MIDI velocity 127)
-        region_data["hivel"] = nb::float_(region->velocityRange.getEnd());
-        
-        // ============================================================================
-        // PITCH INFORMATION
-        // ============================================================================
-        
-        // Pitch keycenter - same as "key" above (default: 60)
-        // This is the reference note for pitch calculations
-        region_data["pitch_keycenter"] = nb::int_(region->pitchKeycenter);
-        
-        // Pitch tracking per key - how much pitch changes per semitone (default: 100)
-        // 100 cents = 1 semitone, 1200 cents = 1 octave
-        // Positive values: higher keys = higher pitch
-        // Negative values: higher keys = lower pitch (rare)
-        region_data["pitch_keytrack"] = nb::float_(region->pitchKeytrack);
-    
-        // Random pitch variation - adds natural pitch variation to each note (default: 0)
-        // Range: 0-12000 cents (0 = no variation, 100 = 1 semitone variation)
-        // Creates human-like pitch variation for more natural sound
-        region_data["pitch_random"] = nb::float_(region->pitchRandom);
-
-        // Pitch tracking per velocity - how much pitch changes with velocity (default: 0)
-        // Positive values: higher velocity = higher pitch
-        // Negative values: higher velocity = lower pitch
-        region_data["pitch_veltrack"] = nb::float_(region->pitchVeltrack);
-        
-        // Transpose - pitch shift in semitones (default: 0)
-        // Range: typically -12 to +12 semitones
-        // Positive values: pitch up, negative values: pitch down
-        region_data["transpose"] = nb::float_(region->transpose);
-        
-        // Fine tuning - pitch adjustment in cents (default: 0)
-        // Range: typically -100 to +100 cents
-        // Used for fine-tuning the sample's pitch
-        region_data["tune"] = nb::float_(region->pitch);
-        
-        // PITCH CALCULATION RELATIONSHIP (in cents):
-        // pitchVariationInCents = pitch_keytrack * (noteNumber - pitch_keycenter)  // note difference
-        //                       + tune                                             // sample tuning (region_data['tune'])
-        //                       + 100 * transpose                                  // transpose opcode (region_data['transpose'])
-        //                       + velocity * pitch_veltrack                        // velocity tracking (region_data['pitch_veltrack'])
-        //                       + random(0, pitch_random)                          // random pitch variation (region_data['pitch_random'])
-        // Where: noteNumber = MIDI note pressed (0-127)
-        
-        // ============================================================================
-        // SUSTAIN PEDAL INFORMATION
-        // ============================================================================
-        
-        // Whether this region responds to sustain pedal (default: true)
-        // true = region respects sustain pedal (CC 64 by default)
-        // false = region ignores sustain pedal completely
-        region_data["check_sustain"] = nb::bool_(region->checkSustain);
-        
-        // MIDI CC number for sustain control (default: 64)
-        // 64 = standard MIDI sustain pedal
-        // Can be set to any CC number (0-127) for custom sustain control
-        region_data["sustain_cc"] = nb::int_(region->sustainCC);
-        
-        // SUSTAIN BEHAVIOR:
-        // - When check_sustain=true: Notes continue playing after key release if sustain pedal is pressed
-        // - When check_sustain=false: Notes stop immediately when key is released (no pedal effect)
-        // - Natural sustain (from sample envelope/loops) works regardless of check_sustain setting
-        
-        // ============================================================================
-        // LOOP INFORMATION
-        // ============================================================================
-        
-        // Loop mode - how the sample plays back (default: "no_loop")
-        // Based on sfizz Defaults.cpp: loopMode { LoopMode::no_loop, ... }
-        // From sfizz Opcode.cpp: enum class LoopMode { no_loop = 0, one_shot, loop_continuous, loop_sustain }
-        std::string loopModeStr;
-        if (region->loopMode.has_value()) {
-            switch (region->loopMode.value()) {
-                case sfz::LoopMode::no_loop: loopModeStr = "no_loop"; break;
-                case sfz::LoopMode::one_shot: loopModeStr = "one_shot"; break;
-                case sfz::LoopMode::loop_continuous: loopModeStr = "loop_continuous"; break;
-                case sfz::LoopMode::loop_sustain: loopModeStr = "loop_sustain"; break;
-            }
-        } else {
-            loopModeStr = "no_loop"; // Default when not specified (from Defaults.cpp line 210)
-        }
-        region_data["loop_mode"] = nb::str(loopModeStr.c_str());
-        
-        // LOOP MODE BEHAVIORS:
-        // - "no_loop": Sample plays from start to end OR until note-off, whichever comes first
-        // - "one_shot": Sample plays from start to end, completely ignoring note-off events (common for drums)
-        // - "loop_continuous": Sample loops continuously from loop_start to loop_end
-        // - "loop_sustain": Sample loops only while key is held down
-        
-        // ============================================================================
-        // TRIGGER INFORMATION (Mutually Exclusive)
-        // ============================================================================
-        
-        // Trigger type - when this region activates (default: "attack")
-        // Based on sfizz Defaults.cpp: trigger { Trigger::attack, ... }
-        // From sfizz Defaults.h: enum class Trigger { attack = 0, release, release_key, first, legato }
-        std::string triggerStr;
-        switch (region->trigger) {
-            case sfz::Trigger::attack: triggerStr = "attack"; break;
-            case sfz::Trigger::release: triggerStr = "release"; break;
-            case sfz::Trigger::release_key: triggerStr = "release_key"; break;
-            case sfz::Trigger::first: triggerStr = "first"; break;
-            case sfz::Trigger::legato: triggerStr = "legato"; break;
-        }
-        region_data["trigger"] = nb::str(triggerStr.c_str());
-        
-        // TRIGGER BEHAVIORS (Only one can be active per region):
-        // - "attack": Triggers when note is pressed (normal playback)
-        // - "release": Triggers when note is released AND sustain pedal is pressed
-        // - "release_key": Triggers when note is released (regardless of sustain pedal)
-        // - "first": Triggers only on the first note when no other notes are playing
-        // - "legato": Triggers only on subsequent notes when other notes are already playing
-        
-        // ============================================================================
-        // SAMPLE PLAYBACK INFORMATION
-        // ============================================================================
-        
-        // Sample start offset in samples (default: 0)
-        // Range: 0 to sample length
-        region_data["offset"] = nb::int_(region->offset);
-        
-        // Sample end position in samples (default: end of file)
-        // Range: 0 to sample length, must be > offset
-        region_data["end"] = nb::int_(region->sampleEnd);
-        
-        // Sample count/length in samples (optional)
-        // When specified, overrides natural sample length
-        if (region->sampleCount.has_value()) {
-            region_data["count"] = nb::int_(region->sampleCount.value());
-        } else {
-            region_data["count"] = nb::none(); // No count specified
-        }
-        
-        // Loop start position in samples (default: 0)
-        region_data["loop_start"] = nb::int_(region->loopRange.getStart());
-        
-        // Loop end position in samples (default: end of sample)
-        region_data["loop_end"] = nb::int_(region->loopRange.getEnd());
-        
-        // Loop count/length in samples (optional)
-        // When specified, limits number of loop iterations
-        if (region->loopCount.has_value()) {
-            region_data["loop_count"] = nb::int_(region->loopCount.value());
-        } else {
-            region_data["loop_count"] = nb::none(); // No loop count specified
-        }
-        
-        // ============================================================================
-        // AMPLITUDE/GAIN INFORMATION
-        // ============================================================================
-        
-        // Volume level in dB (default: 0.0)
-        // Range: typically -96.0 to +12.0 dB
-        region_data["volume"] = nb::float_(region->volume);
-        
-        // Amplitude level (default: 100.0)
-        // Range: typically 0.0 to 100.0
-        region_data["amplitude"] = nb::float_(region->amplitude);
-        
-        // Gain level in dB (default: 0.0)
-        // Range: typically -96.0 to +12.0 dB
-        region_data["gain"] = nb::float_(region->getBaseGain());
-        
-        // ============================================================================
-        // EFFECTS INFORMATION
-        // ============================================================================
-        
-        // Pan position (default: 0.0 = center)
-        // Range: -100.0 (left) to +100.0 (right)
-        region_data["pan"] = nb::float_(region->pan);
-        
-        // Stereo width (default: 100.0 = full stereo)
-        // Range: 0.0 (mono) to 100.0 (full stereo)
-        region_data["width"] = nb::float_(region->width);
-        
-        // Position in stereo field (default: 0.0 = center)
-        // Range: -100.0 (left) to +100.0 (right)
-        region_data["position"] = nb::float_(region->position);
-        
-        return region_data;
+    if (!options.stats) {
+        return audio;
+    }
+    return nb::make_tuple(audio, makeStatsDict(*output.stats(), output.gainDb()));
+}
+
+// Output of a render, in out when it is given: out must be float32,
+// C-contiguous and of the exact shape the render returns
+static pysfizz::RenderOutput makeOutput(const pysfizz::Engine& engine, double renderDur,
+                                        const pysfizz::RenderOptions& options, nb::handle out) {
+    if (!out.is_valid() || out.is_none()) {
+        return engine.makeOutput(renderDur, options);
+    }
+    OutArray array;
+    if (!nb::try_cast(out, array, false)) {
+        throw nb::type_error("out must be a C-contiguous float32 array");
+    }
+    pysfizz::checkRenderOptions(options);
+    const size_t numChannels = pysfizz::numChannelsFor(pysfizz::parseChannelLayout(options.channels));
+    const size_t numFrames = static_cast<size_t>(
+        std::max(0.0, pysfizz::outputSampleRate(options, engine.getSampleRate()) * renderDur));
+    const bool matches = (numChannels == 1)
+        ? (array.ndim() == 1 && array.shape(0) == numFrames)
+        : (array.ndim() == 2 && array.shape(0) == numChannels && array.shape(1) == numFrames);
+    if (!matches) {
+        throw nb::value_error("out does not have the shape of the rendered audio");
+    }
+    return engine.makeOutput(renderDur, options, array.data());
+}
+
+// === ENGINE LOCKING ===
+// Every call into an engine holds its mutex, blocking calls and queued
+// asyncio renders alike, so that threads sharing a synth take turns.
+// The GIL is released while waiting: the holder may need it for a
+// progress callback or a signal check.
+static std::unique_lock<std::mutex> lockEngine(const pysfizz::Engine& engine) {
+    std::unique_lock<std::mutex> lock(engine.mutex(), std::try_to_lock);
+    if (!lock.owns_lock()) {
+        nb::gil_scoped_release release;
+        lock.lock();
+    }
+    return lock;
+}
+
+// Engine method bound with its mutex held: &Locked<&Engine::method>::call
+template <auto method>
+struct Locked;
+
+template <class R, class... Args, R (pysfizz::Engine::*method)(Args...)>
+struct Locked<method> {
+    static R call(pysfizz::Engine& engine, Args... args) {
+        auto lock = lockEngine(engine);
+        return (engine.*method)(std::forward<Args>(args)...);
+    }
+};
+
+template <class R, class... Args, R (pysfizz::Engine::*method)(Args...) const>
+struct Locked<method> {
+    static R call(const pysfizz::Engine& engine, Args... args) {
+        auto lock = lockEngine(engine);
+        return (engine.*method)(std::forward<Args>(args)...);
+    }
+};
+
+// === SYNTH METHODS NEEDING PYTHON OBJECTS ===
+// The rest of the Synth class is pysfizz::Engine (engine.h), bound through Locked.
+
+// Get detailed region data for analysis
+// Based on sfizz Region.h and SynthPrivate.h region access
+static std::map<std::string, nb::object> getRegionData(const pysfizz::Engine& engine, int regionIndex) {
+    auto lock = lockEngine(engine);
+    if (regionIndex < 0 || regionIndex >= engine.getNumRegions()) {
+        throw nb::value_error("Region index out of range");
     }
     
-    // Get region indices that respond to a specific MIDI note
-    // Based on sfizz Synth.cpp note activation lists
-    std::vector<int> getRegionsForNote(int midiNote) const {
-        if (midiNote < 0 || midiNote > 127) {
-            throw nb::value_error("MIDI note must be between 0 and 127");
-        }
-        
-        std::vector<int> regions;
-        const int numRegions = synth_handle_->synth.getNumRegions();
-        for (int i = 0; i < numRegions; ++i) {
-            const auto* region = synth_handle_->synth.getRegionView(i);
-            if (region && region->keyRange.containsWithEnd(midiNote)) {
-                regions.push_back(i);
-            }
-        }
-        
-        return regions;
+    const auto* region = engine.synth().getRegionView(regionIndex);
+    if (!region) {
+        throw nb::value_error("Failed to access region");
     }
     
-    // === SYNTHESIS METHODS ===
+    std::map<std::string, nb::object> region_data;
     
-    // Send MIDI Note On event to trigger voices
-    // Based on sfizz Synth.cpp noteOn() method
-    void noteOn(int delay, int noteNumber, int velocity) {
-        if (noteNumber < 0 || noteNumber > 127) {
-            throw nb::value_error("Note number must be between 0 and 127");
-        }
-        if (velocity < 0 || velocity > 127) {
-            throw nb::value_error("Velocity must be between 0 and 127");
+    // ============================================================================
+    // BASIC REGION INFORMATION
+    // ============================================================================
+    
+    // Unique identifier for this region (0-based index)
+    region_data["id"] = nb::int_(region->getId().number());
+    
+    // Sample filename (e.g., "piano_C4.wav", "*sine", "*silence")
+    // Note: "*" prefix indicates generated samples (sine wave, silence, etc.)
+    region_data["sample_id"] = nb::str(region->sampleId->filename().c_str());
+    
+    // ============================================================================
+    // KEY MAPPING (MIDI Note Numbers: 0-127)
+    // ============================================================================
+    
+    // Lowest MIDI note number that triggers this region (default: 0)
+    // Range: 0-127, where 60 = middle C
+    region_data["lokey"] = nb::int_(region->keyRange.getStart());
+    
+    // Highest MIDI note number that triggers this region (default: 127)
+    // Range: 0-127, where 60 = middle C
+    region_data["hikey"] = nb::int_(region->keyRange.getEnd());
+    
+    // Pitch keycenter - the root note of the sample (default: 60 = middle C)
+    // This is the note that plays at the sample's original pitch
+    // Range: 0-127, where 60 = middle C
+    region_data["key"] = nb::int_(region->pitchKeycenter);
+    
+    // ============================================================================
+    // VELOCITY MAPPING (MIDI Velocity: 0-127)
+    // ============================================================================
+    
+    // Lowest velocity value that triggers this region (default: 0.0)
+    // Range: 0.0-1.0 (normalized MIDI velocity, 1.0 = MIDI velocity 127)
+    region_data["lovel"] = nb::float_(region->velocityRange.getStart());
+    
+    // Highest velocity value that triggers this region (default: 1.0)
+    // Range: 0.0-1.0 (normalized MIDI velocity, 1.0 = MIDI velocity 127)
+    region_data["hivel"] = nb::float_(region->velocityRange.getEnd());
+    
+    // ============================================================================
+    // PITCH INFORMATION
+    // ============================================================================
+    
+    // Pitch keycenter - same as "key" above (default: 60)
+    // This is the reference note for pitch calculations
+    region_data["pitch_keycenter"] = nb::int_(region->pitchKeycenter);
+    
+    // Pitch tracking per key - how much pitch changes per semitone (default: 100)
+    // 100 cents = 1 semitone, 1200 cents = 1 octave
+    // Positive values: higher keys = higher pitch
+    // Negative values: higher keys = lower pitch (rare)
+    region_data["pitch_keytrack"] = nb::float_(region->pitchKeytrack);
+
+    // Random pitch variation - adds natural pitch variation to each note (default: 0)
+    // Range: 0-12000 cents (0 = no variation, 100 = 1 semitone variation)
+    // Creates human-like pitch variation for more natural sound
+    region_data["pitch_random"] = nb::float_(region->pitchRandom);
+
+    // Pitch tracking per velocity - how much pitch changes with velocity (default: 0)
+    // Positive values: higher velocity = higher pitch
+    // Negative values: higher velocity = lower pitch
+    region_data["pitch_veltrack"] = nb::float_(region->pitchVeltrack);
+    
+    // Transpose - pitch shift in semitones (default: 0)
+    // Range: typically -12 to +12 semitones
+    // Positive values: pitch up, negative values: pitch down
+    region_data["transpose"] = nb::float_(region->transpose);
+    
+    // Fine tuning - pitch adjustment in cents (default: 0)
+    // Range: typically -100 to +100 cents
+    // Used for fine-tuning the sample's pitch
+    region_data["tune"] = nb::float_(region->pitch);
+    
+    // PITCH CALCULATION RELATIONSHIP (in cents):
+    // pitchVariationInCents = pitch_keytrack * (noteNumber - pitch_keycenter)  // note difference
+    //                       + tune                                             // sample tuning (region_data['tune'])
+    //                       + 100 * transpose                                  // transpose opcode (region_data['transpose'])
+    //                       + velocity * pitch_veltrack                        // velocity tracking (region_data['pitch_veltrack'])
+    //                       + random(0, pitch_random)                          // random pitch variation (region_data['pitch_random'])
+    // Where: noteNumber = MIDI note pressed (0-127)
+    
+    // ============================================================================
+    // SUSTAIN PEDAL INFORMATION
+    // ============================================================================
+    
+    // Whether this region responds to sustain pedal (default: true)
+    // true = region respects sustain pedal (CC 64 by default)
+    // false = region ignores sustain pedal completely
+    region_data["check_sustain"] = nb::bool_(region->checkSustain);
+    
+    // MIDI CC number for sustain control (default: 64)
+    // 64 = standard MIDI sustain pedal
+    // Can be set to any CC number (0-127) for custom sustain control
+    region_data["sustain_cc"] = nb::int_(region->sustainCC);
+    
+    // SUSTAIN BEHAVIOR:
+    // - When check_sustain=true: Notes continue playing after key release if sustain pedal is pressed
+    // - When check_sustain=false: Notes stop immediately when key is released (no pedal effect)
+    // - Natural sustain (from sample envelope/loops) works regardless of check_sustain setting
+    
+    // ============================================================================
+    // LOOP INFORMATION
+    // ============================================================================
+    
+    // Loop mode - how the sample plays back (default: "no_loop")
+    // Based on sfizz Defaults.cpp: loopMode { LoopMode::no_loop, ... }
+    // From sfizz Opcode.cpp: enum class LoopMode { no_loop = 0, one_shot, loop_continuous, loop_sustain }
+    std::string loopModeStr;
+    if (region->loopMode.has_value()) {
+        switch (region->loopMode.value()) {
+            case sfz::LoopMode::no_loop: loopModeStr = "no_loop"; break;
+            case sfz::LoopMode::one_shot: loopModeStr = "one_shot"; break;
+            case sfz::LoopMode::loop_continuous: loopModeStr = "loop_continuous"; break;
+            case sfz::LoopMode::loop_sustain: loopModeStr = "loop_sustain"; break;
         }
-        
-        synth_handle_->synth.noteOn(delay, noteNumber, velocity);
+    } else {
+        loopModeStr = "no_loop"; // Default when not specified (from Defaults.cpp line 210)
     }
+    region_data["loop_mode"] = nb::str(loopModeStr.c_str());
     
-    // Send MIDI Note Off event to release voices
-    // Based on sfizz Synth.cpp noteOff() method
-    void noteOff(int delay, int noteNumber, int velocity = 0) {
-        if (noteNumber < 0 || noteNumber > 127) {
-            throw nb::value_error("Note number must be between 0 and 127");
-        }
-        if (velocity < 0 || velocity > 127) {
-            throw nb::value_error("Velocity must be between 0 and 127");
-        }
-        
-        synth_handle_->synth.noteOff(delay, noteNumber, velocity);
-    }
-    
-    // Send MIDI Control Change event
-    // Based on sfizz Synth.cpp cc() method
-    // 
-    // IMPORTANT: Values are "held" until a new value is received!
-    // No interpolation happens between values - each value persists
-    // until the next timestamp.
-    //
-    // ADVANCED USAGE: Temporal automation requires custom implementation.
-    //
-    // Example timeline:
-    // synth.cc(0, 7, 64)     → Volume = 64 (held until 500ms)
-    // synth.cc(500, 7, 80)   → Volume = 80 (held until 1000ms)  
-    // synth.cc(1000, 7, 96)  → Volume = 96 (held until 1500ms)
-    //
-    // This creates "step automation" - values jump between timestamps.
-    // For smooth automation, users must implement their own
-    // interpolation algorithms (e.g., LFO, envelope generators, etc.)
-    //
-    void cc(int delay, int ccNumber, int value) {
-        if (ccNumber < 0 || ccNumber > 127) {
-            throw nb::value_error("CC number must be between 0 and 127");
-        }
-        if (value < 0 || value > 127) {
-            throw nb::value_error("CC value must be between 0 and 127");
-        }
-        
-        synth_handle_->synth.cc(delay, ccNumber, value);
-    }
-    
-    // Send MIDI Pitch Wheel event
-    // Based on sfizz Synth.cpp pitchWheel() method
-    // 
-    // IMPORTANT: Values are "held" until a new value is received!
-    // No interpolation happens between values - each value persists
-    // until the next timestamp.
-    //
-    // ADVANCED USAGE: Temporal automation requires custom implementation.
-    //
-    // Example timeline:
-    // synth.pitch_wheel(0, 0)      → Pitch = 0 (held until 500ms)
-    // synth.pitch_wheel(500, 1000) → Pitch = 1000 (held until 1000ms)
-    // synth.pitch_wheel(1000, 0)   → Pitch = 0 (held until 1500ms)
-    //
-    // This creates "step automation" - values jump between timestamps.
-    // For smooth automation, users must implement their own
-    // interpolation algorithms (e.g., LFO, envelope generators, etc.)
-    //
-    void pitchWheel(int delay, int pitch) {
-        if (pitch < -8192 || pitch > 8192) {
-            throw nb::value_error("Pitch wheel value must be between -8192 and +8192");
-        }
-        
-        synth_handle_->synth.pitchWheel(delay, pitch);
+    // LOOP MODE BEHAVIORS:
+    // - "no_loop": Sample plays from start to end OR until note-off, whichever comes first
+    // - "one_shot": Sample plays from start to end, completely ignoring note-off events (common for drums)
+    // - "loop_continuous": Sample loops continuously from loop_start to loop_end
+    // - "loop_sustain": Sample loops only while key is held down
+    
+    // ============================================================================
+    // TRIGGER INFORMATION (Mutually Exclusive)
+    // ============================================================================
+    
+    // Trigger type - when this region activates (default: "attack")
+    // Based on sfizz Defaults.cpp: trigger { Trigger::attack, ... }
+    // From sfizz Defaults.h: enum class Trigger { attack = 0, release, release_key, first, legato }
+    std::string triggerStr;
+    switch (region->trigger) {
+        case sfz::Trigger::attack: triggerStr = "attack"; break;
+        case sfz::Trigger::release: triggerStr = "release"; break;
+        case sfz::Trigger::release_key: triggerStr = "release_key"; break;
+        case sfz::Trigger::first: triggerStr = "first"; break;
+        case sfz::Trigger::legato: triggerStr = "legato"; break;
     }
+    region_data["trigger"] = nb::str(triggerStr.c_str());
     
-    // Render one audio block (stereo output)
-    // Based on sfizz Synth.cpp renderBlock() method
-    // Returns NumPy arrays
-    nb::tuple renderBlock() {
-        // Create AudioSpan for stereo rendering (from sfizz AudioSpan usage)
-        float* buffers[2] = { leftBuffer_.data(), rightBuffer_.data() };
-        sfz::AudioSpan<float> bufferSpan { buffers, 2, 0, static_cast<size_t>(blockSize_) };
-        
-        // Render audio block (clears buffer, processes voices, applies effects)
-        synth_handle_->synth.renderBlock(bufferSpan);
-        
-        // return NumPy array
-        auto left = nb::ndarray<nb::numpy, float>(leftBuffer_.data(), {leftBuffer_.size()});
-        auto right = nb::ndarray<nb::numpy, float>(rightBuffer_.data(), {rightBuffer_.size()});
-        return nb::make_tuple(left, right);
+    // TRIGGER BEHAVIORS (Only one can be active per region):
+    // - "attack": Triggers when note is pressed (normal playback)
+    // - "release": Triggers when note is released AND sustain pedal is pressed
+    // - "release_key": Triggers when note is released (regardless of sustain pedal)
+    // - "first": Triggers only on the first note when no other notes are playing
+    // - "legato": Triggers only on subsequent notes when other notes are already playing
+    
+    // ============================================================================
+    // SAMPLE PLAYBACK INFORMATION
+    // ============================================================================
+    
+    // Sample start offset in samples (default: 0)
+    // Range: 0 to sample length
+    region_data["offset"] = nb::int_(region->offset);
+    
+    // Sample end position in samples (default: end of file)
+    // Range: 0 to sample length, must be > offset
+    region_data["end"] = nb::int_(region->sampleEnd);
+    
+    // Sample count/length in samples (optional)
+    // When specified, overrides natural sample length
+    if (region->sampleCount.has_value()) {
+        region_data["count"] = nb::int_(region->sampleCount.value());
+    } else {
+        region_data["count"] = nb::none(); // No count specified
     }
-
-    // Clear all voices and reset audio state
-    // Based on sfizz Synth.cpp allSoundOff() method
-    void allSoundOff() {
-        synth_handle_->synth.allSoundOff();
+    
+    // Loop start position in samples (default: 0)
+    region_data["loop_start"] = nb::int_(region->loopRange.getStart());
+    
+    // Loop end position in samples (default: end of sample)
+    region_data["loop_end"] = nb::int_(region->loopRange.getEnd());
+    
+    // Loop count/length in samples (optional)
+    // When specified, limits number of loop iterations
+    if (region->loopCount.has_value()) {
+        region_data["loop_count"] = nb::int_(region->loopCount.value());
+    } else {
+        region_data["loop_count"] = nb::none(); // No loop count specified
     }
     
-    // === SYNTH CONFIGURATIONS ===
+    // ============================================================================
+    // AMPLITUDE/GAIN INFORMATION
+    // ============================================================================
+    
+    // Volume level in dB (default: 0.0)
+    // Range: typically -96.0 to +12.0 dB
+    region_data["volume"] = nb::float_(region->volume);
+    
+    // Amplitude level (default: 100.0)
+    // Range: typically 0.0 to 100.0
+    region_data["amplitude"] = nb::float_(region->amplitude);
+    
+    // Gain level in dB (default: 0.0)
+    // Range: typically -96.0 to +12.0 dB
+    region_data["gain"] = nb::float_(region->getBaseGain());
+    
+    // ============================================================================
+    // EFFECTS INFORMATION
+    // ============================================================================
+    
+    // Pan position (default: 0.0 = center)
+    // Range: -100.0 (left) to +100.0 (right)
+    region_data["pan"] = nb::float_(region->pan);
+    
+    // Stereo width (default: 100.0 = full stereo)
+    // Range: 0.0 (mono) to 100.0 (full stereo)
+    region_data["width"] = nb::float_(region->width);
+    
+    // Position in stereo field (default: 0.0 = center)
+    // Range: -100.0 (left) to +100.0 (right)
+    region_data["position"] = nb::float_(region->position);
+    
+    return region_data;
+}
 
-    // Get sample rate
-    int getSampleRate() const {
-        return sampleRate_;
-    }
+// Render one audio block (stereo output)
+// Based on sfizz Synth.cpp renderBlock() method
+// Returns NumPy arrays
+static nb::tuple renderBlock(pysfizz::Engine& engine) {
+    auto lock = lockEngine(engine);
+    engine.renderBlock();
     
-    // Set sample rate
-    // Based on sfizz Synth.cpp setSampleRate() method
-    void setSampleRate(int sampleRate) {
-        if (sampleRate <= 0) {
-            throw nb::value_error("Sample rate must be positive");
-        }
-        
-        sampleRate_ = sampleRate;
-        synth_.setSampleRate(sampleRate);
+    // return NumPy array
+    const size_t blockSize = static_cast<size_t>(engine.getBlockSize());
+    auto left = nb::ndarray<nb::numpy, float>(engine.leftBlock(), {blockSize});
+    auto right = nb::ndarray<nb::numpy, float>(engine.rightBlock(), {blockSize});
+    return nb::make_tuple(left, right);
+}
+
+// Load an instrument without the GIL, so that other threads can poll progress
+static bool loadSfzFile(pysfizz::Engine& engine, const std::string& path, pysfizz::Progress* progress) {
+    nb::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(engine.mutex());
+    return engine.loadSfzFile(path, progress);
+}
+
+static bool loadSfzFileCached(pysfizz::Engine& engine, const std::string& path, const std::string& cacheDir,
+                              pysfizz::Progress* progress) {
+    nb::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(engine.mutex());
+    return engine.loadSfzFileCached(path, cacheDir, progress);
+}
+
+static bool loadSfzString(pysfizz::Engine& engine, const std::string& text, const std::string& virtualPath,
+                          pysfizz::Progress* progress) {
+    nb::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(engine.mutex());
+    return engine.loadSfzString(text, virtualPath, progress);
+}
+
+static nb::dict reloadIfChanged(pysfizz::Engine& engine, pysfizz::Progress* progress) {
+    pysfizz::ReloadResult result;
+    {
+        nb::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(engine.mutex());
+        result = engine.reloadIfChanged(progress);
     }
-    
-    // Get block size
-    int getBlockSize() const {
-        return blockSize_;
+    nb::dict out;
+    out["reloaded"] = result.reloaded;
+    out["success"] = result.success;
+    out["text_changed"] = result.textChanged;
+    out["changed_samples"] = result.changedSamples;
+    return out;
+}
+
+static int64_t pruneRegions(pysfizz::Engine& engine, const std::vector<int>& regionIds) {
+    nb::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock(engine.mutex());
+    return engine.pruneRegions(regionIds);
+}
+
+static nb::dict getMemoryReport(const pysfizz::Engine& engine) {
+    const pysfizz::MemoryReport report = Locked<&pysfizz::Engine::getMemoryReport>::call(engine);
+    nb::dict samples;
+    for (const auto& file : report.samples) {
+        samples[file.first.c_str()] = file.second;
     }
+    nb::dict out;
+    out["samples"] = samples;
+    out["sample_bytes"] = report.sampleBytes;
+    out["block_buffer_bytes"] = report.blockBufferBytes;
+    out["voice_bytes"] = report.voiceBytes;
+    out["effect_buses"] = report.numEffectBuses;
+    out["effect_bus_bytes"] = report.effectBusBytes;
+    out["streaming_bytes"] = report.streamingBytes;
+    out["replicas"] = report.numReplicas;
+    out["replica_bytes"] = report.replicaBytes;
+    out["voices"] = report.numVoices;
+    out["active_voices"] = report.numActiveVoices;
+    out["total_bytes"] = report.totalBytes();
+    return out;
+}
 
-    // Set block size
-    // Based on sfizz Synth.cpp setSamplesPerBlock() method
-    void setBlockSize(int blockSize) {
-        if (blockSize <= 0) {
-            throw nb::value_error("Block size must be positive");
-        }
-        
-        blockSize_ = blockSize;
-        synth_.setSamplesPerBlock(blockSize);
-        
-        // Reallocate buffers
-        leftBuffer_.resize(blockSize);
-        rightBuffer_.resize(blockSize);
+// Progress with an optional Python callback, which takes the GIL to run
+static void initProgress(pysfizz::Progress* self, nb::object callback, double interval) {
+    if (interval < 0) {
+        throw std::invalid_argument("Progress interval must be non-negative");
     }
-    
-    // Set number of voices (polyphony limit).
-    void setNumVoices(int numVoices) {
-        if (numVoices <= 0) {
-            throw nb::value_error("Number of voices must be positive");
+    new (self) pysfizz::Progress();
+    if (callback.is_none()) {
+        return;
+    }
+    self->setCallback([callback](const pysfizz::Progress& progress) {
+        nb::gil_scoped_acquire acquire;
+        try {
+            callback(nb::find(progress));
+        } catch (nb::python_error& e) {
+            e.discard_as_unraisable("pysfizz progress callback");
         }
-        
-        synth_handle_->synth.setNumVoices(numVoices);
+    }, std::chrono::duration_cast<pysfizz::Progress::Clock::duration>(std::chrono::duration<double>(interval)));
+}
+
+// Exception types of stopped renders, created with the module
+static PyObject* renderCancelledType = nullptr;
+static PyObject* renderTimeoutType = nullptr;
+
+// Run a blocking render without the GIL, stoppable through the caller's
+// token, a timeout (0 for none) and pending Python signals: the calling
+// thread checks them every 100 ms, so Ctrl-C raises KeyboardInterrupt
+// out of the render instead of waiting for it to finish
+template <class Render>
+static void runStoppable(pysfizz::RenderOptions& options, const pysfizz::CancelToken* cancel, double timeout,
+                         Render&& render) {
+    pysfizz::CancelToken token(cancel);
+    if (timeout > 0) {
+        token.setTimeout(timeout);
     }
-    
-    // Get number of voices (polyphony limit).
-    int getNumVoices() const {
-        return synth_handle_->synth.getNumVoices();
+    token.setPoll([] {
+        nb::gil_scoped_acquire acquire;
+        return PyErr_CheckSignals() != 0;
+    }, std::chrono::milliseconds(100));
+    options.cancel = &token;
+    if (options.progress) {
+        options.progress->addJobsTotal(1);
     }
-
-    // Get number of active voices (currently playing or in release phase).
-    int getNumActiveVoices() const {
-        return synth_handle_->synth.getNumActiveVoices();
+    try {
+        nb::gil_scoped_release release;
+        render();
+        if (options.progress) {
+            options.progress->jobDone();
+            options.progress->notify(true);
+        }
+    } catch (const pysfizz::RenderCancelled& stop) {
+        options.cancel = nullptr;
+        if (stop.reason() == pysfizz::RenderCancelled::Reason::interrupted) {
+            // Raise what the signal handler raised, e.g. KeyboardInterrupt
+            throw nb::python_error();
+        }
+        throw;
     }
+    options.cancel = nullptr;
+}
+
+// Render a single note entirely in native code, with the GIL released
+// Same timeline as the Python render loop: note-on at frame 0, note-off
+// after noteOnDur seconds, output truncated to renderDur seconds
+// (counted at the output sample rate when resampling).
+// Returns a (2, num_samples) array, or (num_samples,) for single-channel
+// layouts, or (array, stats) when options.stats is set
+static nb::object renderNote(pysfizz::Engine& engine, int pitch, int vel, double noteOnDur, double renderDur,
+                             pysfizz::RenderOptions options, nb::object out, const pysfizz::CancelToken* cancel,
+                             double timeout, pysfizz::Progress* progress) {
+    auto lock = lockEngine(engine);
+    options.progress = progress;
+    pysfizz::RenderOutput output = makeOutput(engine, renderDur, options, out);
+    runStoppable(options, cancel, timeout, [&] { engine.renderNote(pitch, vel, noteOnDur, options, output); });
+    return makeRenderResult(output, options, out);
+}
 
-    // === OFFLINE ACCELERATION METHODS ===
+// Render a list of timed MIDI events entirely in native code
+// Events past renderDur are dropped, and all sound is cut at the end so
+// that notes still held do not leak into the next render
+static nb::object renderEvents(pysfizz::Engine& engine, EventArray events, double renderDur,
+                               pysfizz::RenderOptions options, nb::object out, const pysfizz::CancelToken* cancel,
+                               double timeout, pysfizz::Progress* progress) {
+    auto lock = lockEngine(engine);
+    const auto schedule = pysfizz::makeEvents(events.data(), events.shape(0), engine.getSampleRate());
+    options.progress = progress;
+    pysfizz::RenderOutput output = makeOutput(engine, renderDur, options, out);
+    runStoppable(options, cancel, timeout, [&] { engine.renderEvents(schedule, options, output); });
+    return makeRenderResult(output, options, out);
+}
 
-    // Check if freewheeling is enabled
-    bool isFreeWheeling() const {
-        const auto& synthConfig = synth_handle_->synth.getResources().getSynthConfig();
-        return synthConfig.freeWheeling;
+// Render one event list per track and mix them down
+// Returns the mix as Synth.render_events does, or (mix, stems) when stems
+// is set, the stems being the per-track outputs after gain and balance
+static nb::object renderEnsemble(pysfizz::Ensemble& ensemble, std::vector<EventArray> events, double renderDur,
+                                 pysfizz::RenderOptions options, bool stems, const pysfizz::CancelToken* cancel,
+                                 double timeout, pysfizz::Progress* progress) {
+    const int sampleRate = ensemble.getSampleRate();
+    std::vector<std::vector<pysfizz::Event>> schedules;
+    schedules.reserve(events.size());
+    for (auto& e : events) {
+        schedules.push_back(pysfizz::makeEvents(e.data(), e.shape(0), sampleRate));
     }
     
-    // Enable freewheeling mode for offline rendering
-    // Based on sfizz Synth.cpp enableFreeWheeling() method
-    void enableFreeWheeling() {
-        synth_handle_->synth.enableFreeWheeling();
-    }
+    std::unique_ptr<pysfizz::RenderOutput> mix;
+    std::vector<pysfizz::RenderOutput> stemOutputs;
+    options.progress = progress;
+    runStoppable(options, cancel, timeout, [&] {
+        mix.reset(new pysfizz::RenderOutput(
+            ensemble.render(schedules, renderDur, options, stems ? &stemOutputs : nullptr)));
+    });
     
-    // Disable freewheeling mode for real-time use
-    // Based on sfizz Synth.cpp disableFreeWheeling() method
-    void disableFreeWheeling() {
-        synth_handle_->synth.disableFreeWheeling();
+    nb::object result = makeRenderResult(*mix, options);
+    if (!stems) {
+        return result;
     }
-    
-    // Get sample quality
-    int getSampleQuality() const {
-        const auto& synthConfig = synth_handle_->synth.getResources().getSynthConfig();
-        return synthConfig.currentSampleQuality();
+    nb::list stemList;
+    for (auto& stem : stemOutputs) {
+        stemList.append(makeRenderResult(stem, pysfizz::RenderOptions()));
     }
-    
-    // Get oscillator quality
-    int getOscillatorQuality() const {
-        const auto& synthConfig = synth_handle_->synth.getResources().getSynthConfig();
-        return synthConfig.currentOscillatorQuality();
+    return nb::make_tuple(result, stemList);
+}
+
+// === ASYNC RENDERING ===
+// Renders submitted from asyncio run on a shared native pool, without the
+// GIL. Renders of one synth run one after the other, in submission order,
+// each holding the engine mutex; each completion takes the GIL only to
+// build the result and call back.
+
+// Python exception object for a C++ exception, mapped as the bindings do
+static nb::object pythonException(std::exception_ptr error) {
+    nb::object builtins = nb::module_::import_("builtins");
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::invalid_argument& e) {
+        return builtins.attr("ValueError")(e.what());
+    } catch (const std::out_of_range& e) {
+        return builtins.attr("IndexError")(e.what());
+    } catch (const pysfizz::RenderCancelled& e) {
+        nb::handle type(e.reason() == pysfizz::RenderCancelled::Reason::timeout ? renderTimeoutType
+                                                                                : renderCancelledType);
+        return type(e.what());
+    } catch (const std::exception& e) {
+        return builtins.attr("RuntimeError")(e.what());
+    } catch (...) {
+        return builtins.attr("RuntimeError")("Unknown error in native render");
     }
+}
+
+// One pending render, with the Python objects it keeps alive; created and
+// destroyed with the GIL held
+struct AsyncRender {
+    pysfizz::Engine* engine;
+    int sampleRate;    // that the output was sized for
+    nb::object synth;  // keeps the engine alive
+    nb::object out;
+    nb::object done;   // done(result, error)
+    nb::object cancel; // keeps the parent of token alive
+    nb::object progress;
+    std::unique_ptr<pysfizz::CancelToken> token;
+    pysfizz::RenderOptions options;
+    std::unique_ptr<pysfizz::RenderOutput> output;
+    std::function<void(pysfizz::RenderOutput&, const pysfizz::RenderOptions&)> render;
+
+    void run() {
+        std::exception_ptr error;
+        try {
+            std::lock_guard<std::mutex> lock(engine->mutex());
+            if (engine->getSampleRate() != sampleRate) {
+                throw std::invalid_argument("The sample rate of the synth changed while the render was queued");
+            }
+            render(*output, options);
+            if (options.progress) {
+                options.progress->jobDone();
+                options.progress->notify(true);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
 
-    // Set sample quality
-    void setSampleQuality(int quality) {
-        if (quality < 0 || quality > 10) {
-            throw nb::value_error("Sample quality must be between 0 and 10");
+        nb::gil_scoped_acquire acquire;
+        try {
+            if (error) {
+                done(nb::none(), pythonException(error));
+            } else {
+                done(makeRenderResult(*output, options, out), nb::none());
+            }
+        } catch (nb::python_error& e) {
+            e.discard_as_unraisable("pysfizz async render completion");
         }
-        
-        synth_handle_->synth.setSampleQuality(
-            isFreeWheeling() ? sfz::Synth::ProcessMode::ProcessFreewheeling : sfz::Synth::ProcessMode::ProcessLive,
-            quality
-        );
+        delete this;
+    }
+};
+
+class AsyncRenderer {
+public:
+    // Never destroyed: workers may still be waiting when the interpreter exits
+    static AsyncRenderer& instance() {
+        static AsyncRenderer* renderer = new AsyncRenderer();
+        return *renderer;
     }
 
-    // Set oscillator quality
-    void setOscillatorQuality(int quality) {
-        if (quality < 0 || quality > 3) {
-            throw nb::value_error("Oscillator quality must be between 0 and 3");
+    void submit(const pysfizz::Engine* engine, AsyncRender* job) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& queue = queues_[engine];
+        queue.push_back(job);
+        if (queue.size() == 1) {
+            pool_.submit([this, engine] { run(engine); });
+        }
+    }
+
+private:
+    void run(const pysfizz::Engine* engine) {
+        AsyncRender* job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job = queues_[engine].front();
+        }
+        job->run();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto queue = queues_.find(engine);
+        queue->second.pop_front();
+        if (queue->second.empty()) {
+            queues_.erase(queue);
+        } else {
+            pool_.submit([this, engine] { run(engine); });
         }
-        
-        synth_handle_->synth.setOscillatorQuality(
-            isFreeWheeling() ? sfz::Synth::ProcessMode::ProcessFreewheeling : sfz::Synth::ProcessMode::ProcessLive,
-            quality
-        );
     }
 
+    pysfizz::ThreadPool pool_;
+    std::mutex mutex_;
+    std::unordered_map<const pysfizz::Engine*, std::deque<AsyncRender*>> queues_;
 };
 
+// Check the arguments and queue the render; done(result, error) is called
+// from a pool thread once it has completed. The timeout counts from now.
+static void submitRender(pysfizz::Engine& engine, double renderDur, const pysfizz::RenderOptions& options,
+                         nb::object out, nb::object cancel, double timeout, nb::object progress, nb::object done,
+                         std::function<void(pysfizz::RenderOutput&, const pysfizz::RenderOptions&)> render) {
+    std::unique_ptr<AsyncRender> job(new AsyncRender());
+    job->engine = &engine;
+    job->sampleRate = engine.getSampleRate();
+    job->synth = nb::find(engine);
+    job->out = out;
+    job->done = done;
+    job->cancel = cancel;
+    job->token.reset(new pysfizz::CancelToken(
+        cancel.is_none() ? nullptr : nb::cast<const pysfizz::CancelToken*>(cancel)));
+    if (timeout > 0) {
+        job->token->setTimeout(timeout);
+    }
+    job->progress = progress;
+    job->options = options;
+    job->options.cancel = job->token.get();
+    job->options.progress = progress.is_none() ? nullptr : nb::cast<pysfizz::Progress*>(progress);
+    job->output.reset(new pysfizz::RenderOutput(makeOutput(engine, renderDur, job->options, out)));
+    if (job->options.progress) {
+        job->options.progress->addJobsTotal(1);
+    }
+    job->render = std::move(render);
+    AsyncRenderer::instance().submit(&engine, job.release());
+}
+
+static void renderNoteAsync(pysfizz::Engine& engine, int pitch, int vel, double noteOnDur, double renderDur,
+                            const pysfizz::RenderOptions& options, nb::object out, nb::object cancel,
+                            double timeout, nb::object progress, nb::object done) {
+    submitRender(engine, renderDur, options, out, cancel, timeout, progress, done,
+                 [&engine, pitch, vel, noteOnDur](pysfizz::RenderOutput& output, const pysfizz::RenderOptions& o) {
+                     engine.renderNote(pitch, vel, noteOnDur, o, output);
+                 });
+}
+
+static void renderEventsAsync(pysfizz::Engine& engine, EventArray events, double renderDur,
+                              const pysfizz::RenderOptions& options, nb::object out, nb::object cancel,
+                              double timeout, nb::object progress, nb::object done) {
+    auto schedule = pysfizz::makeEvents(events.data(), events.shape(0), engine.getSampleRate());
+    submitRender(engine, renderDur, options, out, cancel, timeout, progress, done,
+                 [&engine, schedule](pysfizz::RenderOutput& output, const pysfizz::RenderOptions& o) {
+                     engine.renderEvents(schedule, o, output);
+                 });
+}
+
 // === NANOBIND MODULE DEFINITION ===
 NB_MODULE(_sfizz, m) {
 
+    // Built with profile data, and how many profile files it came from
+#if defined(PYSFIZZ_PGO_BUILD)
+    m.attr("pgo") = true;
+    m.attr("pgo_profiles") = PYSFIZZ_PGO_PROFILES;
+#else
+    m.attr("pgo") = false;
+    m.attr("pgo_profiles") = 0;
+#endif
+
+    // SIMD kernel variant selected at import time
+    m.def("get_simd_path", []() { return std::string(pysfizz::kernels::active().name); });
+    m.def("get_simd_paths", &pysfizz::kernels::available);
+    m.def("set_simd_path", [](const std::string& name) {
+        if (!pysfizz::kernels::select(name)) {
+            throw nb::value_error(("SIMD path not available on this CPU: " + name).c_str());
+        }
+    });
+
+    // Stopped renders: RenderCancelled, or RenderTimeout (also a TimeoutError)
+    renderCancelledType = PyErr_NewException("pysfizz._sfizz.RenderCancelled", PyExc_Exception, nullptr);
+    nb::object timeoutBases = nb::make_tuple(nb::handle(renderCancelledType), nb::handle(PyExc_TimeoutError));
+    renderTimeoutType = PyErr_NewException("pysfizz._sfizz.RenderTimeout", timeoutBases.ptr(), nullptr);
+    m.attr("RenderCancelled") = nb::handle(renderCancelledType);
+    m.attr("RenderTimeout") = nb::handle(renderTimeoutType);
+    nb::register_exception_translator([](const std::exception_ptr& p, void*) {
+        try {
+            std::rethrow_exception(p);
+        } catch (const pysfizz::RenderCancelled& e) {
+            PyErr_SetString(e.reason() == pysfizz::RenderCancelled::Reason::timeout ? renderTimeoutType
+                                                                                   : renderCancelledType,
+                            e.what());
+        }
+    });
+
+    // Stop request for renders in flight, settable from any thread; a token
+    // with a parent also stops when the parent is cancelled
+    nb::class_<pysfizz::CancelToken>(m, "CancelToken")
+        .def(nb::init<>())
+        .def(nb::init<const pysfizz::CancelToken*>(), nb::arg("parent"), nb::keep_alive<1, 2>())
+        .def("cancel", &pysfizz::CancelToken::cancel)
+        .def("reset", &pysfizz::CancelToken::reset)
+        .def_prop_ro("cancelled", &pysfizz::CancelToken::cancelled);
+
+    // Counters of renders and loads in progress, readable from any thread
+    // while they run; callback(progress) is called at most every interval
+    // seconds, from the thread doing the work, and once more at the end
+    nb::class_<pysfizz::Progress>(m, "Progress")
+        .def("__init__", &initProgress, nb::arg("callback").none() = nb::none(), nb::arg("interval") = 0.1)
+        .def_prop_ro("frames_done", &pysfizz::Progress::framesDone)
+        .def_prop_ro("frames_total", &pysfizz::Progress::framesTotal)
+        .def_prop_ro("jobs_done", &pysfizz::Progress::jobsDone)
+        .def_prop_ro("jobs_total", &pysfizz::Progress::jobsTotal)
+        .def_prop_ro("bytes_loaded", &pysfizz::Progress::bytesLoaded)
+        .def_prop_ro("fraction", &pysfizz::Progress::fraction)
+        .def("reset", &pysfizz::Progress::reset);
+
+    // Options for the native render methods
+    nb::class_<pysfizz::RenderOptions>(m, "RenderOptions")
+        .def(nb::init<>())
+        .def_rw("channels", &pysfizz::RenderOptions::channels)
+        .def_rw("output_sample_rate", &pysfizz::RenderOptions::outputSampleRate)
+        .def_rw("resample_quality", &pysfizz::RenderOptions::resampleQuality)
+        .def_rw("stats", &pysfizz::RenderOptions::stats)
+        .def_rw("normalize", &pysfizz::RenderOptions::normalize)
+        .def_rw("target", &pysfizz::RenderOptions::target)
+        .def_rw("time_slices", &pysfizz::RenderOptions::timeSlices)
+        .def_rw("slice_margin", &pysfizz::RenderOptions::sliceMargin)
+        .def_rw("partial", &pysfizz::RenderOptions::partialOnCancel);
+
     // Bind the unified Synth class
-    nb::class_<Synth>(m, "Synth")
+    nb::class_<pysfizz::Engine>(m, "Synth")
         // Constructor
         .def(nb::init<int, int>(), nb::arg("sample_rate") = 48000, nb::arg("block_size") = 1024)
         
         // Parser methods
-        .def("load_sfz_file", &Synth::loadSfzFile)
-        .def("get_num_regions", &Synth::getNumRegions)
-        .def("get_region_data", &Synth::getRegionData)
-        .def("get_regions_for_note", &Synth::getRegionsForNote)
+        .def("load_sfz_file", &loadSfzFile, nb::arg("path"), nb::arg("progress").none() = nb::none())
+        .def("load_sfz_file_cached", &loadSfzFileCached, nb::arg("path"), nb::arg("cache_dir"),
+             nb::arg("progress").none() = nb::none())
+        .def("load_sfz_string", &loadSfzString, nb::arg("text"), nb::arg("virtual_path"),
+             nb::arg("progress").none() = nb::none())
+        .def("reload_if_changed", &reloadIfChanged, nb::arg("progress").none() = nb::none())
+        .def("files_changed", &Locked<&pysfizz::Engine::filesChanged>::call)
+        .def("prune_regions", &pruneRegions, nb::arg("region_ids"))
+        .def("get_sfz_text", &Locked<&pysfizz::Engine::getSfzText>::call)
+        .def("get_num_regions", &Locked<&pysfizz::Engine::getNumRegions>::call)
+        .def("get_sample_memory", &Locked<&pysfizz::Engine::getSampleMemory>::call)
+        .def("get_memory_report", &getMemoryReport)
+        .def("get_load_threads", &Locked<&pysfizz::Engine::getLoadThreads>::call)
+        .def("set_load_threads", &Locked<&pysfizz::Engine::setLoadThreads>::call)
+        .def("get_decode_cache_dir", &Locked<&pysfizz::Engine::getDecodeCacheDir>::call)
+        .def("set_decode_cache_dir", &Locked<&pysfizz::Engine::setDecodeCacheDir>::call)
+        .def("get_region_data", &getRegionData)
+        .def("get_regions_for_note", &Locked<&pysfizz::Engine::getRegionsForNote>::call)
         
         // MIDI input methods
-        .def("note_on", &Synth::noteOn)
-        .def("note_off", &Synth::noteOff)
-        .def("cc", &Synth::cc)
-        .def("pitch_wheel", &Synth::pitchWheel)
+        .def("note_on", &Locked<&pysfizz::Engine::noteOn>::call)
+        .def("note_off", &Locked<&pysfizz::Engine::noteOff>::call)
+        .def("cc", &Locked<&pysfizz::Engine::cc>::call)
+        .def("pitch_wheel", &Locked<&pysfizz::Engine::pitchWheel>::call)
+        .def("reset_all_controllers", &Locked<&pysfizz::Engine::resetAllControllers>::call)
+        .def("get_cc_values", &Locked<&pysfizz::Engine::getCCValues>::call)
+        .def("get_pitch_wheel_value", &Locked<&pysfizz::Engine::getPitchWheelValue>::call)
+        .def("set_controllers", &Locked<&pysfizz::Engine::setControllers>::call, nb::arg("cc_values"), nb::arg("pitch_wheel"))
         
         // Audio rendering
-        .def("render_block", &Synth::renderBlock)
-        .def("all_sound_off", &Synth::allSoundOff)
+        .def("render_block", &renderBlock)
+        .def("render_note", &renderNote,
+             nb::arg("pitch"), nb::arg("vel"), nb::arg("note_on_dur"), nb::arg("render_dur"),
+             nb::arg("options") = pysfizz::RenderOptions(), nb::arg("out") = nb::none(),
+             nb::arg("cancel").none() = nb::none(), nb::arg("timeout") = 0.0,
+             nb::arg("progress").none() = nb::none())
+        .def("render_events", &renderEvents,
+             nb::arg("events"), nb::arg("render_dur"),
+             nb::arg("options") = pysfizz::RenderOptions(), nb::arg("out") = nb::none(),
+             nb::arg("cancel").none() = nb::none(), nb::arg("timeout") = 0.0,
+             nb::arg("progress").none() = nb::none())
+        .def("render_note_async", &renderNoteAsync,
+             nb::arg("pitch"), nb::arg("vel"), nb::arg("note_on_dur"), nb::arg("render_dur"),
+             nb::arg("options"), nb::arg("out").none(), nb::arg("cancel").none(), nb::arg("timeout"),
+             nb::arg("progress").none(), nb::arg("done"))
+        .def("render_events_async", &renderEventsAsync,
+             nb::arg("events"), nb::arg("render_dur"),
+             nb::arg("options"), nb::arg("out").none(), nb::arg("cancel").none(), nb::arg("timeout"),
+             nb::arg("progress").none(), nb::arg("done"))
+        .def("all_sound_off", &Locked<&pysfizz::Engine::allSoundOff>::call)
         
         // Configuration methods
-        .def("get_sample_rate", &Synth::getSampleRate)
-        .def("set_sample_rate", &Synth::setSampleRate)
+        .def("get_sample_rate", &Locked<&pysfizz::Engine::getSampleRate>::call)
+        .def("set_sample_rate", &Locked<&pysfizz::Engine::setSampleRate>::call)
 
-        .def("get_block_size", &Synth::getBlockSize)
-        .def("set_block_size", &Synth::setBlockSize)
+        .def("get_block_size", &Locked<&pysfizz::Engine::getBlockSize>::call)
+        .def("set_block_size", &Locked<&pysfizz::Engine::setBlockSize>::call)
 
-        .def("get_num_voices", &Synth::getNumVoices)
-        .def("set_num_voices", &Synth::setNumVoices)
+        .def("get_num_voices", &Locked<&pysfizz::Engine::getNumVoices>::call)
+        .def("set_num_voices", &Locked<&pysfizz::Engine::setNumVoices>::call)
 
-        .def("get_num_active_voices", &Synth::getNumActiveVoices)
+        .def("get_num_active_voices", &Locked<&pysfizz::Engine::getNumActiveVoices>::call)
 
         // Offline acceleration methods
-        .def("is_freewheeling", &Synth::isFreeWheeling)
-        .def("enable_freewheeling", &Synth::enableFreeWheeling)
-        .def("disable_freewheeling", &Synth::disableFreeWheeling)
+        .def("is_freewheeling", &Locked<&pysfizz::Engine::isFreeWheeling>::call)
+        .def("enable_freewheeling", &Locked<&pysfizz::Engine::enableFreeWheeling>::call)
+        .def("disable_freewheeling", &Locked<&pysfizz::Engine::disableFreeWheeling>::call)
 
-        .def("get_sample_quality", &Synth::getSampleQuality)
-        .def("get_oscillator_quality", &Synth::getOscillatorQuality)
+        .def("get_sample_quality", &Locked<&pysfizz::Engine::getSampleQuality>::call)
+        .def("get_oscillator_quality", &Locked<&pysfizz::Engine::getOscillatorQuality>::call)
 
-        .def("set_sample_quality", &Synth::setSampleQuality)
-        .def("set_oscillator_quality", &Synth::setOscillatorQuality);
-}
+        .def("set_sample_quality", &Locked<&pysfizz::Engine::setSampleQuality>::call)
+        .def("set_oscillator_quality", &Locked<&pysfizz::Engine::setOscillatorQuality>::call)
+
+        .def("get_preload_size", &Locked<&pysfizz::Engine::getPreloadSize>::call)
+        .def("set_preload_size", &Locked<&pysfizz::Engine::setPreloadSize>::call);
+
+    // Multi-track renderer
+    nb::class_<pysfizz::Ensemble>(m, "Ensemble")
+        .def(nb::init<int>(), nb::arg("num_threads") = 0)
+        .def("add_track", &pysfizz::Ensemble::addTrack, nb::keep_alive<1, 2>(),
+             nb::arg("synth"), nb::arg("gain") = 1.0f, nb::arg("pan") = 0.0f)
+        .def("get_num_tracks", &pysfizz::Ensemble::getNumTracks)
+        .def("set_track_gain", &pysfizz::Ensemble::setTrackGain)
+        .def("set_track_pan", &pysfizz::Ensemble::setTrackPan)
+        .def("render", &renderEnsemble,
+             nb::arg("events"), nb::arg("render_dur"),
+             nb::arg("options") = pysfizz::RenderOptions(), nb::arg("stems") = false,
+             nb::arg("cancel").none() = nb::none(), nb::arg("timeout") = 0.0,
+             nb::arg("progress").none() = nb::none());
+}
\ No newline at end of file
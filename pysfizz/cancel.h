@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace pysfizz {
+
+// Thrown out of a render stopped through its CancelToken
+class RenderCancelled : public std::runtime_error {
+public:
+    enum class Reason {
+        cancelled,    // CancelToken::cancel()
+        timeout,      // past the deadline
+        interrupted,  // the poll hook asked to stop, e.g. on Ctrl-C
+    };
+
+    explicit RenderCancelled(Reason reason)
+        : std::runtime_error(reason == Reason::timeout       ? "Render timed out"
+                             : reason == Reason::interrupted ? "Render interrupted"
+                                                             : "Render cancelled"),
+          reason_(reason) {}
+
+    Reason reason() const { return reason_; }
+
+private:
+    Reason reason_;
+};
+
+// Stop request polled by the render loops at block boundaries, from every
+// thread taking part in a render. The render stops once the token or its
+// parent is cancelled, past the deadline, or when the poll hook returns
+// true; all its threads then throw RenderCancelled at their next check.
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancelToken() = default;
+    // Token that also stops when parent is cancelled, e.g. a per-call token
+    // carrying a timeout under a token shared by several calls
+    explicit CancelToken(const CancelToken* parent) : parent_(parent) {}
+
+    CancelToken(const CancelToken&) = delete;
+    CancelToken& operator=(const CancelToken&) = delete;
+
+    // Safe from any thread
+    void cancel() { state_.store(static_cast<int>(RenderCancelled::Reason::cancelled)); }
+    bool cancelled() const { return state_.load(std::memory_order_relaxed) >= 0 || (parent_ && parent_->cancelled()); }
+    void reset() { state_.store(kRunning); }
+
+    // Set up before the render starts
+    void setTimeout(double seconds) {
+        deadline_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        hasDeadline_ = true;
+    }
+
+    // Hook run by check() at most every interval, only on the thread that
+    // installs it (the one calling the render, which keeps checking while
+    // it waits for the threads of a parallel render)
+    void setPoll(std::function<bool()> poll, Clock::duration interval) {
+        poll_ = std::move(poll);
+        pollInterval_ = interval;
+        pollThread_ = std::this_thread::get_id();
+        lastPoll_ = Clock::now();
+    }
+
+    // Throw RenderCancelled if the render must stop
+    void check() {
+        int state = state_.load(std::memory_order_relaxed);
+        if (state < 0 && parent_ && parent_->cancelled())
+            state = static_cast<int>(RenderCancelled::Reason::cancelled);
+        if (state < 0 && (hasDeadline_ || poll_)) {
+            const auto now = Clock::now();
+            if (hasDeadline_ && now >= deadline_) {
+                state = static_cast<int>(RenderCancelled::Reason::timeout);
+            } else if (poll_ && std::this_thread::get_id() == pollThread_ && now - lastPoll_ >= pollInterval_) {
+                lastPoll_ = now;
+                if (poll_())
+                    state = static_cast<int>(RenderCancelled::Reason::interrupted);
+            }
+            // Stop the other threads of the render too
+            if (state >= 0)
+                state_.store(state);
+        }
+        if (state >= 0)
+            throw RenderCancelled(static_cast<RenderCancelled::Reason>(state));
+    }
+
+private:
+    static constexpr int kRunning = -1;
+
+    std::atomic<int> state_ { kRunning };
+    const CancelToken* parent_ = nullptr;
+
+    bool hasDeadline_ = false;
+    Clock::time_point deadline_;
+
+    std::function<bool()> poll_;
+    Clock::duration pollInterval_ {};
+    std::thread::id pollThread_;
+    Clock::time_point lastPoll_;
+};
+
+} // namespace pysfizz
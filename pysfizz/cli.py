@@ -0,0 +1,19 @@
+import os
+import subprocess
+import sys
+from pathlib import Path
+
+
+def main():
+    """Run the native pysfizz-render executable shipped with the package."""
+    exe = Path(__file__).parent / "bin" / ("pysfizz-render.exe" if os.name == "nt" else "pysfizz-render")
+    if not exe.exists():
+        sys.exit(f"pysfizz-render: native executable not found at {exe}")
+    args = [str(exe), *sys.argv[1:]]
+    if os.name == "nt":
+        sys.exit(subprocess.call(args))
+    os.execv(args[0], args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,304 @@
+import argparse
+import json
+import os
+import socket
+import socketserver
+import threading
+import weakref
+from multiprocessing import resource_tracker, shared_memory
+
+import numpy as np
+
+from .events import event_array
+from .synth import Synth
+
+# Render daemon: one process keeps the instruments loaded and renders for
+# any number of client processes over a Unix domain socket. Requests and
+# replies are JSON lines; the audio itself is rendered straight into a
+# POSIX shared-memory segment that the client maps, so it is never copied
+# or sent through the socket.
+#
+#   python -m pysfizz.daemon /tmp/pysfizz.sock --workers 8
+#
+#   client = RenderClient("/tmp/pysfizz.sock")
+#   audio = client.render_note("piano.sfz", 60, 100, 1.0, 2.0, channels="mono")
+#
+# A segment is unlinked by the client as soon as it is mapped (the mapping
+# stays valid), or by the server when the client goes away without doing so.
+#
+# Each loaded synth holds a full copy of its instrument, so the server keeps
+# at most engines_per_instrument of them per instrument and sample rate
+# (default 1); further requests for that instrument wait for one to be free.
+# Raise it to render one instrument concurrently at the cost of its memory.
+
+RENDER_KWARGS = ("channels", "output_sample_rate", "resample_quality", "stats", "normalize", "target")
+EVENT_KWARGS = RENDER_KWARGS + ("time_slices", "slice_margin")
+
+# exceptions passed from the server to the client by name
+_ERRORS = {cls.__name__: cls for cls in (ValueError, TypeError, KeyError, IndexError, FileNotFoundError, RuntimeError)}
+
+
+def _create_segment(size):
+    # a segment handed to a client outlives the server's handle, so it must be
+    # kept from the server's resource tracker, which would unlink it at exit;
+    # returns the segment and whether the tracker has it
+    try:
+        return shared_memory.SharedMemory(create=True, size=size, track=False), False
+    except TypeError:
+        return shared_memory.SharedMemory(create=True, size=size), True  # before Python 3.13
+
+
+def _hand_over(segment, tracked):
+    segment.close()
+    if tracked and os.name == "posix":
+        # registered under its POSIX name, which has a leading slash
+        resource_tracker.unregister("/" + segment.name, "shared_memory")
+
+
+def _unlink_segment(name):
+    try:
+        segment = shared_memory.SharedMemory(name=name)
+    except FileNotFoundError:
+        return
+    segment.close()
+    segment.unlink()
+
+
+# Engines of one instrument at one sample rate, created on demand up to
+# max_engines; requests beyond that wait for an engine to be released
+class _EnginePool:
+    def __init__(self, path, sample_rate, block_size, max_engines, load_lock):
+        self.path = path
+        self.sample_rate = sample_rate
+        self.block_size = block_size
+        self.max_engines = max_engines
+        self._load_lock = load_lock
+        self._idle = []
+        self._count = 0
+        self._cond = threading.Condition()
+
+    def acquire(self):
+        with self._cond:
+            while not self._idle and self._count >= self.max_engines:
+                self._cond.wait()
+            if self._idle:
+                return self._idle.pop()
+            self._count += 1
+        try:
+            synth = Synth(sample_rate=self.sample_rate, block_size=self.block_size)
+            # loads are serialized: load_sfz_file redirects the process stderr
+            with self._load_lock:
+                loaded = synth.load_sfz_file(self.path)
+            if not loaded:
+                raise RuntimeError(f"Failed to load {self.path}")
+            return synth
+        except BaseException:
+            with self._cond:
+                self._count -= 1
+                self._cond.notify()
+            raise
+
+    def release(self, synth):
+        with self._cond:
+            self._idle.append(synth)
+            self._cond.notify()
+
+
+class RenderServer:
+    def __init__(self, socket_path, workers=None, block_size=1024, engines_per_instrument=1):
+        self.socket_path = str(socket_path)
+        self.workers = workers or os.cpu_count() or 1
+        self.block_size = block_size
+        if engines_per_instrument < 1:
+            raise ValueError("engines_per_instrument must be at least 1")
+        self.engines_per_instrument = min(engines_per_instrument, self.workers)
+        self._pools = {}
+        self._pools_lock = threading.Lock()
+        self._load_lock = threading.Lock()
+        self._slots = threading.BoundedSemaphore(self.workers)
+        self._server = None
+
+    def pool(self, instrument, sample_rate):
+        key = (instrument, sample_rate)
+        with self._pools_lock:
+            pool = self._pools.get(key)
+            if pool is None:
+                pool = _EnginePool(instrument, sample_rate, self.block_size, self.engines_per_instrument,
+                                   self._load_lock)
+                self._pools[key] = pool
+            return pool
+
+    def handle(self, request):
+        # one request: returns the reply, and the segment name if one was created
+        op = request.get("op")
+        if op == "ping":
+            return {"ok": True, "workers": self.workers}, None
+        if op not in ("load", "render_note", "render_events"):
+            raise ValueError(f"Unknown op {op!r}")
+
+        pool = self.pool(request["instrument"], int(request.get("sample_rate", 48000)))
+        # wait for an engine of this instrument before taking a render slot,
+        # so that queued requests do not hold slots other instruments could use
+        synth = pool.acquire()
+        try:
+            if op == "load":
+                return {"ok": True}, None
+            kwargs = request.get("kwargs", {})
+            allowed = RENDER_KWARGS if op == "render_note" else EVENT_KWARGS
+            unknown = set(kwargs) - set(allowed)
+            if unknown:
+                raise TypeError(f"Unexpected arguments: {sorted(unknown)}")
+
+            shape = synth.output_shape(request["render_dur"], kwargs.get("channels", "stereo"),
+                                       kwargs.get("output_sample_rate"))
+            nbytes = int(np.prod(shape)) * 4
+            with self._slots:
+                segment, tracked = _create_segment(max(nbytes, 1))
+                out = result = None
+                try:
+                    out = np.ndarray(shape, dtype=np.float32, buffer=segment.buf)
+                    if op == "render_note":
+                        result = synth.render_note(request["pitch"], request["vel"], request["note_on_dur"],
+                                                   request["render_dur"], out=out, **kwargs)
+                    else:
+                        result = synth.render_events(np.array(request["events"], dtype=np.float64).reshape(-1, 4),
+                                                     request["render_dur"],
+                                                     out=out, **kwargs)
+                    stats = result[1] if isinstance(result, tuple) else None
+                except BaseException:
+                    out = result = None
+                    segment.close()
+                    segment.unlink()
+                    raise
+                out = result = None
+            _hand_over(segment, tracked)
+            return {"ok": True, "segment": segment.name, "shape": list(shape), "stats": stats}, segment.name
+        finally:
+            pool.release(synth)
+
+    def serve_forever(self):
+        server = self
+
+        class Handler(socketserver.StreamRequestHandler):
+            def handle(self):
+                # the segment of the last reply is the client's to unlink; if the
+                # client sends its next request or hangs up, it has mapped it or never will
+                pending = None
+                try:
+                    for line in self.rfile:
+                        if pending is not None:
+                            _unlink_segment(pending)
+                            pending = None
+                        try:
+                            reply, pending = server.handle(json.loads(line))
+                        except Exception as e:
+                            reply = {"ok": False, "error": type(e).__name__, "message": str(e)}
+                        self.wfile.write(json.dumps(reply).encode() + b"\n")
+                        self.wfile.flush()
+                finally:
+                    if pending is not None:
+                        _unlink_segment(pending)
+
+        if os.path.exists(self.socket_path):
+            os.unlink(self.socket_path)
+        self._server = socketserver.ThreadingUnixStreamServer(self.socket_path, Handler)
+        self._server.daemon_threads = True
+        try:
+            self._server.serve_forever()
+        finally:
+            self._server.server_close()
+            if os.path.exists(self.socket_path):
+                os.unlink(self.socket_path)
+
+    def shutdown(self):
+        if self._server is not None:
+            self._server.shutdown()
+
+
+def _map_segment(name, shape):
+    # the mapping stays valid after the segment is unlinked; the segment is
+    # closed once the array, and every view of it, is gone
+    segment = shared_memory.SharedMemory(name=name)
+    segment.unlink()
+    audio = np.ndarray(shape, dtype=np.float32, buffer=segment.buf)
+    weakref.finalize(audio, segment.close)
+    return audio
+
+
+# Client of a RenderServer, with the render methods of Synth. Instruments are
+# named by path, resolved here and loaded by the server on first use; one
+# connection per client, safe to share between threads.
+class RenderClient:
+    def __init__(self, socket_path):
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(str(socket_path))
+        self._file = self._socket.makefile("rwb")
+        self._lock = threading.Lock()
+
+    def close(self):
+        self._file.close()
+        self._socket.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _call(self, request):
+        with self._lock:
+            self._file.write(json.dumps(request).encode() + b"\n")
+            self._file.flush()
+            line = self._file.readline()
+            if not line:
+                raise ConnectionError("Render server closed the connection")
+            reply = json.loads(line)
+            if not reply["ok"]:
+                raise _ERRORS.get(reply["error"], RuntimeError)(reply["message"])
+            if "segment" not in reply:
+                return reply
+            # map (and unlink) the segment before the next request is sent
+            audio = _map_segment(reply["segment"], tuple(reply["shape"]))
+        return (audio, reply["stats"]) if reply["stats"] is not None else audio
+
+    def ping(self):
+        return self._call({"op": "ping"})
+
+    def load(self, instrument, sample_rate=48000):
+        # load an instrument ahead of the first render
+        self._call({"op": "load", "instrument": os.path.abspath(instrument), "sample_rate": sample_rate})
+
+    def render_note(self, instrument, pitch, vel, note_on_dur, render_dur, sample_rate=48000, **kwargs):
+        # same arguments and result as Synth.render_note, on the given instrument
+        return self._call({"op": "render_note", "instrument": os.path.abspath(instrument),
+                           "sample_rate": sample_rate, "pitch": pitch, "vel": vel,
+                           "note_on_dur": note_on_dur, "render_dur": render_dur, "kwargs": kwargs})
+
+    def render_events(self, instrument, events, render_dur, sample_rate=48000, **kwargs):
+        # same arguments and result as Synth.render_events, on the given instrument
+        return self._call({"op": "render_events", "instrument": os.path.abspath(instrument),
+                           "sample_rate": sample_rate, "events": event_array(events).tolist(),
+                           "render_dur": render_dur, "kwargs": kwargs})
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serve pysfizz renders over a Unix domain socket.")
+    parser.add_argument("socket", help="path of the socket to listen on")
+    parser.add_argument("--workers", type=int, default=None, help="concurrent renders (default: CPU count)")
+    parser.add_argument("--block-size", type=int, default=1024)
+    parser.add_argument("--engines-per-instrument", type=int, default=1,
+                        help="loaded copies of each instrument, for concurrent renders of it (default: 1)")
+    parser.add_argument("--preload", action="append", default=[], metavar="SFZ[@RATE]",
+                        help="instrument to load at startup, optionally at a sample rate")
+    args = parser.parse_args()
+
+    server = RenderServer(args.socket, workers=args.workers, block_size=args.block_size,
+                          engines_per_instrument=args.engines_per_instrument)
+    for item in args.preload:
+        path, _, rate = item.partition("@")
+        server.handle({"op": "load", "instrument": os.path.abspath(path), "sample_rate": int(rate or 48000)})
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
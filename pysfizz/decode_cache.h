@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "sample_prefetch.h"
+#include "sfz_cache.h"
+
+namespace pysfizz {
+
+// Compressed samples (FLAC, Ogg Vorbis, MP3, WavPack) decoded ahead of a
+// load into float WAV files kept in a cache directory. sfizz decodes the
+// samples of an instrument one after the other on the loading thread;
+// decoding the compressed ones first, on a pool of threads, leaves it
+// plain float data to copy, and later loads find them decoded already.
+// The loaded text names the decoded files instead of the originals.
+
+inline bool isCompressedSample(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".flac" || extension == ".ogg" || extension == ".mp3" || extension == ".wv";
+}
+
+// Decoded file of a sample in cacheDir, named after its absolute path,
+// size and modification time so that a changed sample is decoded again;
+// empty if the sample cannot be found
+inline std::string decodedSamplePath(const std::string& cacheDir, const std::string& file) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(file, error);
+    if (error)
+        return std::string();
+    const int64_t mtime = detail::fileMtime(file, error);
+    if (error)
+        return std::string();
+    const std::string absolute = std::filesystem::absolute(file).lexically_normal().string();
+    const std::string key = absolute + ":" + std::to_string(size) + ":" + std::to_string(mtime);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.wav", static_cast<unsigned long long>(detail::fnv1a(key)));
+    return (std::filesystem::path(cacheDir) / name).string();
+}
+
+// SFZ text (includes already inlined, as compileSfzFile gives it) whose
+// sample opcodes name complete paths: the replacement of the files found
+// in replacements, the absolute path of the others. default_path opcodes
+// are dropped, since sfizz would prefix them to the complete paths, and
+// #define variables are expanded on the lines that remain.
+inline std::string rewriteSamplePaths(const std::string& text, const std::filesystem::path& base,
+                                      const std::map<std::string, std::string>& replacements) {
+    std::istringstream in(text);
+    std::string raw;
+    std::string out;
+    std::map<std::string, std::string> defines;
+    std::string defaultPath;
+    bool inBlock = false;
+    while (std::getline(in, raw)) {
+        std::string line = detail::stripComments(raw, inBlock);
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first != std::string::npos && line.compare(first, 7, "#define") == 0) {
+            std::istringstream define(line.substr(first + 7));
+            std::string name, value;
+            define >> name;
+            std::getline(define >> std::ws, value);
+            while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+                value.pop_back();
+            if (!name.empty() && name[0] == '$')
+                defines[name] = value;
+            out += line;
+            out += '\n';
+            continue;
+        }
+        line = detail::expandDefines(line, defines);
+
+        // Spans are replaced from the end, so that earlier ones stay valid
+        const auto spans = detail::lineOpcodeSpans(line);
+        std::vector<std::pair<const detail::OpcodeSpan*, std::string>> edits;
+        for (const auto& span : spans) {
+            const std::string name = line.substr(span.name, span.equals - span.name);
+            std::string value = line.substr(span.equals + 1, span.valueEnd - span.equals - 1);
+            std::replace(value.begin(), value.end(), '\\', '/');
+            if (name == "default_path") {
+                defaultPath = value;
+                edits.emplace_back(&span, std::string());
+            } else if (name == "sample" && !value.empty() && value[0] != '*') {
+                const std::string file = (base / (defaultPath + value)).lexically_normal().string();
+                const auto replacement = replacements.find(file);
+                const std::string path = replacement != replacements.end()
+                    ? replacement->second
+                    : std::filesystem::absolute(file).lexically_normal().generic_string();
+                edits.emplace_back(&span, "sample=" + path);
+            }
+        }
+        for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit)
+            line.replace(edit->first->name, edit->first->valueEnd - edit->first->name, edit->second);
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace pysfizz
@@ -0,0 +1,1247 @@
+#include "engine.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sfizz/Synth.h>
+#include <sfizz/Config.h>
+#include <sfizz/Region.h>
+#include <sfizz/Defaults.h>
+#include <sfizz/sfizz_private.hpp>
+#include <sfizz/SynthConfig.h>
+#include <sfizz/FilePool.h>
+#include <sfizz/AudioReader.h>
+#include "decode_cache.h"
+#include "kernels.h"
+#include "sample_prefetch.h"
+#include "sfz_cache.h"
+#include "wav_writer.h"
+
+namespace pysfizz {
+
+// MIDI controller state that carries over between slices
+struct Engine::ControllerState {
+    std::array<float, 128> cc;
+    float pitchWheel;
+};
+
+// In the handler of a stopped render: rethrow, or keep what was rendered
+static void keepPartialOrRethrow(const RenderCancelled& stop, const RenderOptions& options, RenderOutput& output) {
+    if (!options.partialOnCancel || stop.reason() == RenderCancelled::Reason::interrupted) {
+        throw;
+    }
+    output.truncate();
+}
+
+Engine::Engine(int sampleRate, int blockSize)
+    : sampleRate_(sampleRate), blockSize_(blockSize) {
+    // Cache handle once in constructor
+    handle_ = sfizz_.handle();
+    if (!handle_) {
+        throw std::runtime_error("Failed to get synth handle");
+    }
+
+    // Configure synth audio settings (from Synth.cpp setSampleRate/setSamplesPerBlock)
+    sfizz_.setSampleRate(sampleRate);
+    sfizz_.setSamplesPerBlock(blockSize);
+
+    // Allocate stereo buffers for rendering
+    leftBuffer_.resize(blockSize);
+    rightBuffer_.resize(blockSize);
+}
+
+Engine::~Engine() = default;
+
+// === INSTRUMENT ===
+
+// Based on sfizz Synth.cpp loadSfzFile() method. The file and its includes
+// are only scanned for sample files, to read them ahead, and stamped; the
+// text is compiled when something needs it (see loadedText()), or up
+// front when the decode cache has to rename samples in it.
+bool Engine::loadSfzFile(const std::string& path, Progress* progress) {
+    if (!decodeCacheDir_.empty()) {
+        CompiledSfz compiled;
+        try {
+            compiled = compileSfzFile(path);
+        } catch (const std::runtime_error&) {
+            // Left to sfizz to fail on
+        }
+        const auto samples = scanSampleFiles(compiled.text, std::filesystem::path(path).parent_path());
+        return loadCompiled(path, std::string(), compiled, stampFiles(samples), samples, progress);
+    }
+
+    std::string text;
+    std::ifstream file(path, std::ios::binary);
+    if (file) {
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    }
+    std::vector<std::string> sources { path };
+    const auto samples = scanSampleFiles(text, std::filesystem::path(path).parent_path(), &sources);
+    FileStamps sourceStamps = stampFiles(sources);
+    FileStamps sampleStamps = stampFiles(samples);
+    readAheadSamples(samples);
+
+    const bool success = sfizz_.loadSfzFile(path);
+    fileLoaded(path, std::string(), std::string(), success, std::string(), std::move(sourceStamps),
+               std::move(sampleStamps));
+    if (success && progress) {
+        progress->addBytesLoaded(sampleBytes());
+    }
+    return success;
+}
+
+// Load through a copy of the file in cacheDir with its includes inlined,
+// (re)built when missing or out of date; the instrument is the same as
+// loadSfzFile()'s. sfizz still parses the whole text: what is saved is
+// opening and reading each include file, once per load here and once in
+// sfizz.
+bool Engine::loadSfzFileCached(const std::string& path, const std::string& cacheDir, Progress* progress) {
+    const std::string cacheFile = compiledSfzPath(cacheDir, path);
+    CompiledSfz compiled;
+    bool restamped = false;
+    if (!readCompiledSfz(cacheFile, compiled) || !compiledSfzUpToDate(compiled, restamped)) {
+        try {
+            compiled = compileSfzFile(path);
+        } catch (const std::runtime_error&) {
+            return loadSfzFile(path, progress);
+        }
+        writeCompiledSfz(cacheFile, compiled);
+    } else if (restamped) {
+        writeCompiledSfz(cacheFile, compiled);
+    }
+    const auto samples = scanSampleFiles(compiled.text, std::filesystem::path(path).parent_path());
+    return loadCompiled(path, cacheDir, compiled, stampFiles(samples), samples, progress);
+}
+
+// Load from the file itself, or from its compiled text when it went
+// through a cache or names decoded samples. The files of readAhead are
+// read ahead, or decoded first when they are compressed and a decode cache
+// is set.
+bool Engine::loadCompiled(const std::string& path, const std::string& cacheDir, const CompiledSfz& compiled,
+                          FileStamps samples, std::vector<std::string> readAhead, Progress* progress) {
+    std::string text = compiled.text;
+    bool fromText = !cacheDir.empty();
+    if (!decodeCacheDir_.empty()) {
+        std::vector<std::string> files;
+        for (const auto& sample : samples) {
+            files.push_back(sample.first);
+        }
+        const auto decoded = decodeSamples(files);
+        if (!decoded.empty()) {
+            text = rewriteSamplePaths(compiled.text, std::filesystem::path(path).parent_path(), decoded);
+            fromText = true;
+            readAhead.erase(std::remove_if(readAhead.begin(), readAhead.end(),
+                [&decoded](const std::string& file) { return decoded.count(file) > 0; }), readAhead.end());
+        }
+    }
+    readAheadSamples(readAhead);
+
+    const bool success = fromText ? sfizz_.loadSfzString(path, text) : sfizz_.loadSfzFile(path);
+    std::vector<std::string> sources { path };
+    for (const auto& dependency : compiled.dependencies) {
+        sources.push_back(dependency.path);
+    }
+    fileLoaded(path, cacheDir, fromText ? text : std::string(), success, compiled.text, stampFiles(sources),
+               std::move(samples));
+    if (success && progress) {
+        progress->addBytesLoaded(sampleBytes());
+    }
+    return success;
+}
+
+// Remember what a load from a file read, for reloadIfChanged() and
+// filesChanged(): the file, the cache directory it went through (empty
+// for none), the text sfizz loaded when not the file itself, the compiled
+// text when the load compiled it, and the stamps of the file with its
+// includes and of the sample files
+void Engine::fileLoaded(const std::string& path, const std::string& cacheDir, const std::string& text, bool success,
+                        std::string compiledText, FileStamps sources, FileStamps samples) {
+    sfzPath_ = success ? path : std::string();
+    sfzText_ = success ? text : std::string();
+    ++loadGeneration_;
+    reloadPath_ = success ? path : std::string();
+    reloadCacheDir_ = cacheDir;
+    loadedText_ = std::move(compiledText);
+    loadedSources_ = std::move(sources);
+    loadedSamples_ = std::move(samples);
+    carriedStateKnown_ = false;
+}
+
+// Based on sfizz Synth.cpp loadSfzString() method
+bool Engine::loadSfzString(const std::string& text, const std::string& virtualPath, Progress* progress) {
+    readAheadSamples(scanSampleFiles(text, std::filesystem::path(virtualPath).parent_path()));
+    const bool success = sfizz_.loadSfzString(virtualPath, text);
+    sfzPath_ = success ? virtualPath : std::string();
+    sfzText_ = success ? text : std::string();
+    ++loadGeneration_;
+    reloadPath_.clear();
+    loadedText_.clear();
+    loadedSources_.clear();
+    loadedSamples_.clear();
+    carriedStateKnown_ = false;
+    if (success && progress) {
+        progress->addBytesLoaded(sampleBytes());
+    }
+    return success;
+}
+
+// Compiled text of an instrument loaded from a file, compiled now when the
+// load did not; empty when the file or one of its includes changed since
+// the load, the text then being no longer the one loaded
+const std::string& Engine::loadedText() {
+    if (loadedText_.empty() && !reloadPath_.empty() && !stampsChanged(loadedSources_)) {
+        try {
+            loadedText_ = compileSfzFile(reloadPath_).text;
+        } catch (const std::runtime_error&) {
+            // Left empty
+        }
+    }
+    return loadedText_;
+}
+
+// Whether the instrument keeps state from note to note (see
+// hasCarriedState), looked into by the first sliced render after a load.
+// Text that cannot be known is rendered in one piece.
+bool Engine::carriesState() {
+    if (!carriedStateKnown_) {
+        const std::string text = !reloadPath_.empty() ? loadedText()
+            : compileSfzText(sfzText_, std::filesystem::path(sfzPath_).parent_path()).text;
+        carriedState_ = text.empty() || hasCarriedState(text);
+        carriedStateKnown_ = true;
+    }
+    return carriedState_;
+}
+
+ReloadResult Engine::reloadIfChanged(Progress* progress) {
+    if (reloadPath_.empty()) {
+        throw std::runtime_error("No instrument loaded from a file");
+    }
+    // Files keeping their size and time are not read again. The text is
+    // compiled again rather than read from the cache, which is only
+    // checked against the SFZ files and not the samples.
+    ReloadResult result;
+    if (!stampsChanged(loadedSources_) && !stampsChanged(loadedSamples_)) {
+        return result;
+    }
+    CompiledSfz compiled;
+    try {
+        compiled = compileSfzFile(reloadPath_);
+    } catch (const std::runtime_error&) {
+        // The file is gone: keep the current instrument
+        result.success = false;
+        return result;
+    }
+    const auto samples = scanSampleFiles(compiled.text, std::filesystem::path(reloadPath_).parent_path());
+    FileStamps stamps = stampFiles(samples);
+    // A load that did not compile the text cannot tell it apart
+    result.textChanged = loadedText_.empty() || compiled.text != loadedText_;
+    for (const auto& entry : stamps) {
+        const auto loaded = loadedSamples_.find(entry.first);
+        if (loaded == loadedSamples_.end() || loaded->second != entry.second) {
+            result.changedSamples.push_back(entry.first);
+        }
+    }
+    if (!result.textChanged && result.changedSamples.empty()) {
+        // Touched without being changed: remember the new stamps
+        std::vector<std::string> sources { reloadPath_ };
+        for (const auto& dependency : compiled.dependencies) {
+            sources.push_back(dependency.path);
+        }
+        loadedSources_ = stampFiles(sources);
+        loadedSamples_ = std::move(stamps);
+        return result;
+    }
+
+    result.reloaded = true;
+    const std::string path = reloadPath_;
+    const std::string cacheDir = reloadCacheDir_;
+    if (!cacheDir.empty()) {
+        writeCompiledSfz(compiledSfzPath(cacheDir, path), compiled);
+    }
+    result.success = loadCompiled(path, cacheDir, compiled, std::move(stamps), result.changedSamples, progress);
+    return result;
+}
+
+bool Engine::filesChanged() const {
+    return !reloadPath_.empty() && (stampsChanged(loadedSources_) || stampsChanged(loadedSamples_));
+}
+
+// sfizz cannot remove regions from a loaded instrument: the instrument
+// text is loaded again without them. Region ids number the <region>
+// headers in order, including regions sfizz dropped for a missing sample.
+int64_t Engine::pruneRegions(const std::vector<int>& regionIds) {
+    if (sfzPath_.empty()) {
+        throw std::runtime_error("No instrument loaded");
+    }
+    const std::string text = sfzText_.empty()
+        ? loadedText()
+        : compileSfzText(sfzText_, std::filesystem::path(sfzPath_).parent_path()).text;
+    if (text.empty()) {
+        // Region ids could not be matched with the text
+        throw std::runtime_error("The instrument files changed since the load, or cannot be read");
+    }
+    const std::set<int> ids(regionIds.begin(), regionIds.end());
+    int numHeaders = 0;
+    std::string pruned = removeRegions(text, ids, numHeaders);
+    for (int id : ids) {
+        if (id < 0 || id >= numHeaders) {
+            throw std::invalid_argument("Region id out of range");
+        }
+    }
+    const int numRegions = handle_->synth.getNumRegions();
+    for (int i = 0; i < numRegions; ++i) {
+        const auto* region = handle_->synth.getRegionView(i);
+        if (region && region->getId().number() >= numHeaders) {
+            throw std::runtime_error("Regions do not match the instrument text");
+        }
+    }
+
+    const int64_t before = getSampleMemory();
+    const std::string path = sfzPath_;
+    if (!loadSfzString(pruned, path)) {
+        throw std::runtime_error("Failed to load the pruned instrument");
+    }
+    return before - getSampleMemory();
+}
+
+// Decode the compressed files among files into the decode cache on the
+// load threads, unless a previous load did. Returns the decoded file of
+// each one that is ready; the others are left to sfizz, along with files
+// carrying loop or wavetable metadata, which a plain WAV would not keep.
+std::map<std::string, std::string> Engine::decodeSamples(const std::vector<std::string>& files) const {
+    std::vector<std::pair<std::string, std::string>> jobs;
+    for (const auto& file : files) {
+        if (isCompressedSample(file)) {
+            const std::string decoded = decodedSamplePath(decodeCacheDir_, file);
+            if (!decoded.empty()) {
+                jobs.emplace_back(file, decoded);
+            }
+        }
+    }
+    if (jobs.empty()) {
+        return {};
+    }
+    std::error_code error;
+    std::filesystem::create_directories(decodeCacheDir_, error);
+
+    std::vector<char> ready(jobs.size(), 0);
+    std::atomic<size_t> next { 0 };
+    auto decode = [&](size_t) {
+        for (size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+            ready[i] = decodeSample(jobs[i].first, jobs[i].second);
+        }
+    };
+    const size_t numThreads = std::min(jobs.size(), loadThreads_ > 0 ? static_cast<size_t>(loadThreads_)
+                                                                       : std::max(1u, std::thread::hardware_concurrency()));
+    if (numThreads <= 1) {
+        decode(0);
+    } else {
+        ThreadPool pool(numThreads - 1);
+        pool.parallelFor(numThreads, decode);
+    }
+
+    std::map<std::string, std::string> decoded;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (ready[i]) {
+            decoded.insert(jobs[i]);
+        }
+    }
+    return decoded;
+}
+
+// Decode one file with sfizz's own reader into a float WAV, written aside
+// and renamed so that concurrent loads see it whole or not at all
+bool Engine::decodeSample(const std::string& file, const std::string& decoded) {
+    std::error_code error;
+    if (std::filesystem::exists(decoded, error)) {
+        return true;
+    }
+    auto reader = sfz::createAudioReader(file, false, &error);
+    if (!reader || error) {
+        return false;
+    }
+    SF_INSTRUMENT instrument {};
+    sfz::WavetableInfo wavetable {};
+    if (reader->getInstrumentInfo(instrument) || reader->getWavetableInfo(wavetable)) {
+        return false;
+    }
+    const size_t numChannels = reader->channels();
+    const int64_t numFrames = reader->frames();
+    if (numChannels == 0 || numChannels > 2 || numFrames <= 0) {
+        return false;
+    }
+
+    // Planar, as writeWav takes it
+    std::vector<float> planar(numChannels * static_cast<size_t>(numFrames));
+    std::vector<float> block(4096 * numChannels);
+    int64_t frame = 0;
+    while (frame < numFrames) {
+        const size_t count = reader->readNextBlock(block.data(), std::min<size_t>(4096, static_cast<size_t>(numFrames - frame)));
+        if (count == 0) {
+            return false;
+        }
+        for (size_t c = 0; c < numChannels; ++c) {
+            float* channel = planar.data() + c * static_cast<size_t>(numFrames) + frame;
+            for (size_t i = 0; i < count; ++i) {
+                channel[i] = block[i * numChannels + c];
+            }
+        }
+        frame += static_cast<int64_t>(count);
+    }
+
+    const std::string temporary = decoded + ".tmp" + std::to_string(std::random_device()());
+    try {
+        writeWav(temporary, planar.data(), numChannels, static_cast<size_t>(numFrames),
+                 static_cast<int>(reader->sampleRate()), true);
+    } catch (const std::runtime_error&) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, decoded, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return std::filesystem::exists(decoded, error);
+    }
+    return true;
+}
+
+void Engine::setLoadThreads(int numThreads) {
+    if (numThreads < 0) {
+        throw std::invalid_argument("Load threads must be non-negative");
+    }
+    loadThreads_ = numThreads;
+}
+
+// sfizz decodes the samples serially on this thread; reading them ahead
+// in parallel lets it find them in the page cache. Only the part that
+// will be preloaded is read: at most 8 bytes per frame, plus headers.
+void Engine::readAheadSamples(const std::vector<std::string>& files) const {
+    const size_t numThreads = loadThreads_ > 0 ? static_cast<size_t>(loadThreads_)
+                                               : std::max(1u, std::thread::hardware_concurrency());
+    if (numThreads <= 1) {
+        return;
+    }
+    const size_t preload = static_cast<size_t>(getPreloadSize());
+    prefetchFiles(files, numThreads, preload > 0 ? preload * 8 + 65536 : 0);
+}
+
+// Size on disk of the sample files of the regions, each counted once;
+// sample paths are relative to the directory of the instrument
+int64_t Engine::sampleBytes() const {
+    namespace fs = std::filesystem;
+    const fs::path base = fs::path(sfzPath_).parent_path();
+    std::set<std::string> seen;
+    int64_t bytes = 0;
+    const int numRegions = handle_->synth.getNumRegions();
+    for (int i = 0; i < numRegions; ++i) {
+        const auto* region = handle_->synth.getRegionView(i);
+        if (!region || region->isGenerator()) {
+            continue;
+        }
+        const std::string file = region->sampleId->filename();
+        if (!seen.insert(file).second) {
+            continue;
+        }
+        std::error_code error;
+        const auto size = fs::file_size(base / file, error);
+        if (!error) {
+            bytes += static_cast<int64_t>(size);
+        }
+    }
+    return bytes;
+}
+
+// Based on sfizz Synth.cpp getNumRegions() method
+int Engine::getNumRegions() const {
+    return sfizz_.getNumRegions();
+}
+
+// Based on sfizz Synth.cpp note activation lists
+std::vector<int> Engine::getRegionsForNote(int midiNote) const {
+    if (midiNote < 0 || midiNote > 127) {
+        throw std::invalid_argument("MIDI note must be between 0 and 127");
+    }
+
+    std::vector<int> regions;
+    const int numRegions = handle_->synth.getNumRegions();
+    for (int i = 0; i < numRegions; ++i) {
+        const auto* region = handle_->synth.getRegionView(i);
+        if (region && region->keyRange.containsWithEnd(midiNote)) {
+            regions.push_back(i);
+        }
+    }
+    return regions;
+}
+
+sfz::Synth& Engine::synth() {
+    return handle_->synth;
+}
+
+const sfz::Synth& Engine::synth() const {
+    return handle_->synth;
+}
+
+// Based on sfizz FilePool.cpp preloadFile(): each sample file is decoded
+// to 32-bit floats once per synth, up to the preload size
+int64_t Engine::getSampleMemory() const {
+    int64_t bytes = 0;
+    for (const auto& file : sampleMemoryByFile()) {
+        bytes += file.second;
+    }
+    return bytes;
+}
+
+// Preloaded frames of each sample file, as float in every channel; the
+// frames past the preload size are added to streamingBytes
+std::vector<std::pair<std::string, int64_t>> Engine::sampleMemoryByFile(int64_t* streamingBytes) const {
+    const auto& filePool = handle_->synth.getResources().getFilePool();
+    const int64_t preload = getPreloadSize();
+    std::set<std::string> seen;
+    std::vector<std::pair<std::string, int64_t>> files;
+    const int numRegions = handle_->synth.getNumRegions();
+    for (int i = 0; i < numRegions; ++i) {
+        const auto* region = handle_->synth.getRegionView(i);
+        if (!region || region->isGenerator() || !seen.insert(region->sampleId->filename()).second) {
+            continue;
+        }
+        const auto info = filePool.getFileInformation(*region->sampleId);
+        if (!info) {
+            continue;
+        }
+        const int64_t frames = std::min<int64_t>(info->end + 1, preload);
+        if (streamingBytes) {
+            *streamingBytes += (info->end + 1 - frames) * info->numChannels * static_cast<int64_t>(sizeof(float));
+        }
+        files.emplace_back(region->sampleId->filename(), frames * info->numChannels * static_cast<int64_t>(sizeof(float)));
+    }
+    return files;
+}
+
+// Each synth renders voices into a pool of mono and stereo block buffers,
+// and has at most maxEffectBuses effect buses, as configured in sfizz
+static constexpr int64_t voiceMonoBuffers = sfz::config::bufferPoolSize;
+static constexpr int64_t voiceStereoBuffers = sfz::config::stereoBufferPoolSize;
+static constexpr int maxEffectBuses = sfz::config::maxEffectBuses;
+
+MemoryReport Engine::getMemoryReport() const {
+    MemoryReport report;
+    report.samples = sampleMemoryByFile(&report.streamingBytes);
+    for (const auto& file : report.samples) {
+        report.sampleBytes += file.second;
+    }
+    report.blockBufferBytes = static_cast<int64_t>((leftBuffer_.capacity() + rightBuffer_.capacity()) * sizeof(float));
+    for (const auto& r : replicas_) {
+        const MemoryReport replica = r->getMemoryReport();
+        report.replicaBytes += replica.totalBytes();
+    }
+    report.numReplicas = static_cast<int>(replicas_.size());
+    report.numVoices = getNumVoices();
+    report.numActiveVoices = getNumActiveVoices();
+
+    // A stereo block per voice, plus the shared render buffers
+    const int64_t blockBytes = static_cast<int64_t>(blockSize_) * sizeof(float);
+    report.voiceBytes = (2 * report.numVoices + voiceMonoBuffers + 2 * voiceStereoBuffers) * blockBytes;
+    for (int bus = 0; bus < maxEffectBuses; ++bus) {
+        if (handle_->synth.getEffectBusView(bus)) {
+            ++report.numEffectBuses;
+        }
+    }
+    report.effectBusBytes = report.numEffectBuses * 4 * blockBytes;
+    return report;
+}
+
+// === MIDI INPUT ===
+
+// Based on sfizz Synth.cpp noteOn() method
+void Engine::noteOn(int delay, int noteNumber, int velocity) {
+    if (noteNumber < 0 || noteNumber > 127) {
+        throw std::invalid_argument("Note number must be between 0 and 127");
+    }
+    if (velocity < 0 || velocity > 127) {
+        throw std::invalid_argument("Velocity must be between 0 and 127");
+    }
+    handle_->synth.noteOn(delay, noteNumber, velocity);
+}
+
+// Based on sfizz Synth.cpp noteOff() method
+void Engine::noteOff(int delay, int noteNumber, int velocity) {
+    if (noteNumber < 0 || noteNumber > 127) {
+        throw std::invalid_argument("Note number must be between 0 and 127");
+    }
+    if (velocity < 0 || velocity > 127) {
+        throw std::invalid_argument("Velocity must be between 0 and 127");
+    }
+    handle_->synth.noteOff(delay, noteNumber, velocity);
+}
+
+// Based on sfizz Synth.cpp cc() method
+void Engine::cc(int delay, int ccNumber, int value) {
+    if (ccNumber < 0 || ccNumber > 127) {
+        throw std::invalid_argument("CC number must be between 0 and 127");
+    }
+    if (value < 0 || value > 127) {
+        throw std::invalid_argument("CC value must be between 0 and 127");
+    }
+    handle_->synth.cc(delay, ccNumber, value);
+}
+
+// Based on sfizz Synth.cpp pitchWheel() method
+void Engine::pitchWheel(int delay, int pitch) {
+    if (pitch < -8192 || pitch > 8192) {
+        throw std::invalid_argument("Pitch wheel value must be between -8192 and +8192");
+    }
+    handle_->synth.pitchWheel(delay, pitch);
+}
+
+// Based on sfizz Synth.cpp allSoundOff() method
+void Engine::allSoundOff() {
+    handle_->synth.allSoundOff();
+}
+
+// Based on sfizz Synth.cpp resetAllControllers() method
+void Engine::resetAllControllers() {
+    handle_->synth.resetAllControllers(0);
+}
+
+std::vector<float> Engine::getCCValues() const {
+    const ControllerState state = getControllerState();
+    return std::vector<float>(state.cc.begin(), state.cc.end());
+}
+
+float Engine::getPitchWheelValue() const {
+    return getControllerState().pitchWheel;
+}
+
+void Engine::setControllers(const std::vector<float>& ccValues, float pitchWheel) {
+    if (ccValues.size() != 128) {
+        throw std::invalid_argument("Controller state needs 128 CC values");
+    }
+    ControllerState state;
+    for (int i = 0; i < 128; ++i) {
+        if (!(ccValues[i] >= 0.0f && ccValues[i] <= 1.0f)) {
+            throw std::invalid_argument("CC values must be between 0 and 1");
+        }
+        state.cc[i] = ccValues[i];
+    }
+    if (!(pitchWheel >= -1.0f && pitchWheel <= 1.0f)) {
+        throw std::invalid_argument("Pitch wheel must be between -1 and 1");
+    }
+    state.pitchWheel = pitchWheel;
+    setControllerState(state);
+}
+
+// === CONFIGURATION ===
+
+// Based on sfizz Synth.cpp setSampleRate() method
+void Engine::setSampleRate(int sampleRate) {
+    if (sampleRate <= 0) {
+        throw std::invalid_argument("Sample rate must be positive");
+    }
+    sampleRate_ = sampleRate;
+    sfizz_.setSampleRate(sampleRate);
+}
+
+// Based on sfizz Synth.cpp setSamplesPerBlock() method
+void Engine::setBlockSize(int blockSize) {
+    if (blockSize <= 0) {
+        throw std::invalid_argument("Block size must be positive");
+    }
+    blockSize_ = blockSize;
+    sfizz_.setSamplesPerBlock(blockSize);
+
+    // Reallocate buffers
+    leftBuffer_.resize(blockSize);
+    rightBuffer_.resize(blockSize);
+}
+
+int Engine::getNumVoices() const {
+    return handle_->synth.getNumVoices();
+}
+
+void Engine::setNumVoices(int numVoices) {
+    if (numVoices <= 0) {
+        throw std::invalid_argument("Number of voices must be positive");
+    }
+    handle_->synth.setNumVoices(numVoices);
+}
+
+// Voices currently playing or in release phase
+int Engine::getNumActiveVoices() const {
+    return handle_->synth.getNumActiveVoices();
+}
+
+bool Engine::isFreeWheeling() const {
+    return handle_->synth.getResources().getSynthConfig().freeWheeling;
+}
+
+// Based on sfizz Synth.cpp enableFreeWheeling() method
+void Engine::enableFreeWheeling() {
+    handle_->synth.enableFreeWheeling();
+}
+
+// Based on sfizz Synth.cpp disableFreeWheeling() method
+void Engine::disableFreeWheeling() {
+    handle_->synth.disableFreeWheeling();
+}
+
+int Engine::getSampleQuality() const {
+    return handle_->synth.getResources().getSynthConfig().currentSampleQuality();
+}
+
+void Engine::setSampleQuality(int quality) {
+    if (quality < 0 || quality > 10) {
+        throw std::invalid_argument("Sample quality must be between 0 and 10");
+    }
+    handle_->synth.setSampleQuality(
+        isFreeWheeling() ? sfz::Synth::ProcessMode::ProcessFreewheeling : sfz::Synth::ProcessMode::ProcessLive,
+        quality);
+}
+
+int Engine::getOscillatorQuality() const {
+    return handle_->synth.getResources().getSynthConfig().currentOscillatorQuality();
+}
+
+void Engine::setOscillatorQuality(int quality) {
+    if (quality < 0 || quality > 3) {
+        throw std::invalid_argument("Oscillator quality must be between 0 and 3");
+    }
+    handle_->synth.setOscillatorQuality(
+        isFreeWheeling() ? sfz::Synth::ProcessMode::ProcessFreewheeling : sfz::Synth::ProcessMode::ProcessLive,
+        quality);
+}
+
+int Engine::getPreloadSize() const {
+    return static_cast<int>(handle_->synth.getPreloadSize());
+}
+
+void Engine::setPreloadSize(int frames) {
+    if (frames < 0) {
+        throw std::invalid_argument("Preload size must be non-negative");
+    }
+    handle_->synth.setPreloadSize(static_cast<uint32_t>(frames));
+}
+
+// === RENDERING ===
+
+// Based on sfizz Synth.cpp renderBlock() method
+void Engine::renderBlock() {
+    // Create AudioSpan for stereo rendering (from sfizz AudioSpan usage)
+    float* buffers[2] = { leftBuffer_.data(), rightBuffer_.data() };
+    sfz::AudioSpan<float> bufferSpan { buffers, 2, 0, static_cast<size_t>(blockSize_) };
+
+    // Render audio block (clears buffer, processes voices, applies effects)
+    handle_->synth.renderBlock(bufferSpan);
+}
+
+RenderOutput Engine::makeOutput(double renderDur, const RenderOptions& options, float* buffer) const {
+    if (renderDur < 0) {
+        throw std::invalid_argument("Durations must be non-negative");
+    }
+    checkRenderOptions(options);
+    const int outputRate = outputSampleRate(options, sampleRate_);
+    return RenderOutput(static_cast<size_t>(outputRate * renderDur), sampleRate_, options, buffer);
+}
+
+void Engine::renderNote(int pitch, int vel, double noteOnDur, const RenderOptions& options, RenderOutput& output) {
+    if (pitch < 0 || pitch > 127) {
+        throw std::invalid_argument("Note number must be between 0 and 127");
+    }
+    if (vel < 0 || vel > 127) {
+        throw std::invalid_argument("Velocity must be between 0 and 127");
+    }
+    if (noteOnDur < 0) {
+        throw std::invalid_argument("Durations must be non-negative");
+    }
+    checkRenderOptions(options);
+
+    auto& synth = handle_->synth;
+    const int64_t noteOffFrame = static_cast<int64_t>(sampleRate_ * noteOnDur);
+    synth.noteOn(0, pitch, vel);
+    bool noteOffSent = false;
+    int64_t frame = 0;
+    try {
+        while (!output.full()) {
+            checkCancelled(options);
+            if (!noteOffSent && frame + blockSize_ > noteOffFrame) {
+                synth.noteOff(static_cast<int>(noteOffFrame - frame), pitch, 0);
+                noteOffSent = true;
+            }
+            renderBlock();
+            output.write(leftBuffer_.data(), rightBuffer_.data(), blockSize_);
+            frame += blockSize_;
+        }
+    } catch (const RenderCancelled& stop) {
+        // Leave the synth silent and reusable
+        if (!noteOffSent) {
+            synth.noteOff(0, pitch, 0);
+        }
+        synth.allSoundOff();
+        keepPartialOrRethrow(stop, options, output);
+        return;
+    }
+    if (!noteOffSent) {
+        synth.noteOff(0, pitch, 0);
+    }
+    synth.allSoundOff();
+
+    output.normalize(options.normalize, options.target);
+}
+
+RenderOutput Engine::renderNote(int pitch, int vel, double noteOnDur, double renderDur, const RenderOptions& options) {
+    RenderOutput output = makeOutput(renderDur, options);
+    renderNote(pitch, vel, noteOnDur, options, output);
+    return output;
+}
+
+void Engine::renderEvents(const std::vector<Event>& events, const RenderOptions& options, RenderOutput& output) {
+    checkRenderOptions(options);
+
+    try {
+        // Voices still sounding from earlier calls would only play in the
+        // first slice
+        if (options.timeSlices > 1 && getNumActiveVoices() == 0 && !carriesState()) {
+            renderTimeSlices(events, output, options);
+        } else {
+            size_t cursor = 0;
+            for (int64_t frame = 0; !output.full(); frame += blockSize_) {
+                checkCancelled(options);
+                dispatchEvents(events, cursor, frame);
+                renderBlock();
+                output.write(leftBuffer_.data(), rightBuffer_.data(), blockSize_);
+            }
+        }
+    } catch (const RenderCancelled& stop) {
+        // Leave this engine and its replicas silent and reusable
+        handle_->synth.allSoundOff();
+        for (auto& r : replicas_) {
+            r->allSoundOff();
+        }
+        keepPartialOrRethrow(stop, options, output);
+        return;
+    }
+    handle_->synth.allSoundOff();
+
+    output.normalize(options.normalize, options.target);
+}
+
+RenderOutput Engine::renderEvents(const std::vector<Event>& events, double renderDur, const RenderOptions& options) {
+    RenderOutput output = makeOutput(renderDur, options);
+    renderEvents(events, options, output);
+    return output;
+}
+
+void Engine::dispatchEvents(const std::vector<Event>& events, size_t& cursor, int64_t blockStart) {
+    auto& synth = handle_->synth;
+    const int64_t blockEnd = blockStart + blockSize_;
+    for (; cursor < events.size() && events[cursor].frame < blockEnd; ++cursor) {
+        const auto& event = events[cursor];
+        const int delay = static_cast<int>(std::max<int64_t>(0, event.frame - blockStart));
+        switch (event.type) {
+            case EventType::note_on: synth.noteOn(delay, event.data1, event.data2); break;
+            case EventType::note_off: synth.noteOff(delay, event.data1, event.data2); break;
+            case EventType::cc: synth.cc(delay, event.data1, event.data2); break;
+            case EventType::pitch_wheel: synth.pitchWheel(delay, event.data1); break;
+        }
+    }
+}
+
+// Sample lengths are converted from the file rate to the synth rate, and
+// releases are taken at their longest over velocity and CC modulation;
+// effect tails are not predicted and are covered by the slice margin
+// instead (instruments with effect buses are not sliced, see
+// hasCarriedState).
+NoteTail Engine::predictNoteTail(int note, int velocity) const {
+    NoteTail tail;
+    const float normVelocity = velocity / 127.0f;
+    const double maxFrames = 1e15;
+    const auto& filePool = handle_->synth.getResources().getFilePool();
+    const int numRegions = handle_->synth.getNumRegions();
+    for (int i = 0; i < numRegions; ++i) {
+        const auto* region = handle_->synth.getRegionView(i);
+        if (!region || !region->keyRange.containsWithEnd(note) || !region->velocityRange.containsWithEnd(normVelocity)) {
+            continue;
+        }
+        // Sample offsets count frames of the file, played at its own rate
+        double fileFrameLength = 1.0;
+        if (!region->isGenerator()) {
+            const auto info = filePool.getFileInformation(*region->sampleId);
+            if (info && info->sampleRate > 0) {
+                fileFrameLength = sampleRate_ / info->sampleRate;
+            }
+        }
+
+        const auto& eg = region->amplitudeEG;
+        double releaseSeconds = eg.release + std::max(0.0f, eg.vel2release * normVelocity);
+        for (const auto& mod : eg.ccRelease) {
+            releaseSeconds += std::max(0.0f, mod.data);
+        }
+        const double release = releaseSeconds * sampleRate_;
+        // Pitching down plays the sample slower, hence longer
+        const double cents = region->pitchKeytrack * (note - region->pitchKeycenter) + region->pitch + 100 * region->transpose;
+        const double speed = std::pow(2.0, std::min(cents, 0.0) / 1200.0);
+        const double sampleLength = static_cast<double>(std::max<int64_t>(0, region->sampleEnd - region->offset)) * fileFrameLength / speed;
+        const bool oneShot = region->loopMode.has_value() && region->loopMode.value() == sfz::LoopMode::one_shot;
+
+        switch (region->trigger) {
+            case sfz::Trigger::attack:
+            case sfz::Trigger::first:
+            case sfz::Trigger::legato:
+                if (oneShot) {
+                    tail.fromNoteOn = std::max(tail.fromNoteOn, static_cast<int64_t>(std::min(sampleLength + release, maxFrames)));
+                }
+                tail.fromNoteOff = std::max(tail.fromNoteOff, static_cast<int64_t>(std::min(release, maxFrames)));
+                break;
+            case sfz::Trigger::release:
+            case sfz::Trigger::release_key:
+                tail.fromNoteOff = std::max(tail.fromNoteOff, static_cast<int64_t>(std::min(sampleLength + release, maxFrames)));
+                break;
+        }
+    }
+    return tail;
+}
+
+// === PARALLEL RENDERING ===
+
+Engine::ControllerState Engine::getControllerState() const {
+    const auto& midiState = handle_->synth.getResources().getMidiState();
+    ControllerState state;
+    for (int i = 0; i < 128; ++i) {
+        state.cc[i] = midiState.getCCValue(i);
+    }
+    state.pitchWheel = midiState.getPitchBend();
+    return state;
+}
+
+// State after the events of the schedule before `frame`
+Engine::ControllerState Engine::advanceControllerState(ControllerState state, const std::vector<Event>& events,
+                                                       int64_t frame) {
+    for (const auto& event : events) {
+        if (event.frame >= frame) {
+            break;
+        }
+        if (event.type == EventType::cc) {
+            state.cc[event.data1] = event.data2 / 127.0f;
+        } else if (event.type == EventType::pitch_wheel) {
+            state.pitchWheel = event.data1 / 8191.0f;
+        }
+    }
+    return state;
+}
+
+// Send the controllers that differ from the wanted state
+void Engine::setControllerState(const ControllerState& state) {
+    auto& synth = handle_->synth;
+    const ControllerState current = getControllerState();
+    for (int i = 0; i < 128; ++i) {
+        if (current.cc[i] != state.cc[i]) {
+            synth.hdcc(0, i, state.cc[i]);
+        }
+    }
+    if (current.pitchWheel != state.pitchWheel) {
+        synth.hdPitchWheel(0, state.pitchWheel);
+    }
+}
+
+// Replica with the same instrument and configuration as this engine,
+// created on first use and kept in sync afterwards
+Engine& Engine::replica(size_t index) {
+    while (replicas_.size() <= index) {
+        replicas_.emplace_back(new Engine(sampleRate_, blockSize_));
+    }
+    Engine& r = *replicas_[index];
+    if (r.sampleRate_ != sampleRate_) {
+        r.setSampleRate(sampleRate_);
+    }
+    if (r.blockSize_ != blockSize_) {
+        r.setBlockSize(blockSize_);
+    }
+    if (r.getPreloadSize() != getPreloadSize()) {
+        r.setPreloadSize(getPreloadSize());
+    }
+    // This engine's load has already brought the samples into the page cache
+    r.loadThreads_ = 1;
+    if (r.loadGeneration_ != loadGeneration_) {
+        const bool loaded = sfzText_.empty() ? (sfzPath_.empty() || r.loadSfzFile(sfzPath_))
+                                             : r.loadSfzString(sfzText_, sfzPath_);
+        if (!loaded) {
+            throw std::runtime_error("Failed to load the instrument in a replica");
+        }
+        r.loadGeneration_ = loadGeneration_;
+    }
+    if (r.getNumVoices() != getNumVoices()) {
+        r.setNumVoices(getNumVoices());
+    }
+    if (r.isFreeWheeling() != isFreeWheeling()) {
+        isFreeWheeling() ? r.enableFreeWheeling() : r.disableFreeWheeling();
+    }
+    if (r.getSampleQuality() != getSampleQuality()) {
+        r.setSampleQuality(getSampleQuality());
+    }
+    if (r.getOscillatorQuality() != getOscillatorQuality()) {
+        r.setOscillatorQuality(getOscillatorQuality());
+    }
+    return r;
+}
+
+// Pool with enough workers to run numTasks tasks next to the calling thread
+ThreadPool& Engine::workers(size_t numTasks) {
+    if (!pool_ || pool_->size() + 1 < numTasks) {
+        pool_.reset(new ThreadPool(std::max<size_t>(1, numTasks - 1)));
+    }
+    return *pool_;
+}
+
+// Cut the timeline where nothing sounds, render the slices concurrently
+// (this engine takes the first one, replicas the others) and stitch them.
+// Each replica starts silent with the controller state the serial render
+// would have at its slice start, so the result matches the serial render
+// as long as every tail ends within its prediction plus the margin;
+// instruments with state a replica cannot pick up never get here (see
+// hasCarriedState).
+void Engine::renderTimeSlices(const std::vector<Event>& schedule, RenderOutput& output, const RenderOptions& options) {
+    // Synth-rate frames needed to fill the output, with resampler lookahead
+    const int outputRate = outputSampleRate(options, sampleRate_);
+    int64_t needed = static_cast<int64_t>(std::ceil(static_cast<double>(output.numFrames()) * sampleRate_ / outputRate));
+    if (outputRate != sampleRate_) {
+        needed += 64;
+    }
+    const int64_t totalFrames = (needed + blockSize_ - 1) / blockSize_ * blockSize_;
+
+    const auto starts = planTimeSlices(
+        schedule, [this](int note, int velocity) { return predictNoteTail(note, velocity); },
+        static_cast<int64_t>(options.sliceMargin * sampleRate_), blockSize_, totalFrames,
+        static_cast<size_t>(options.timeSlices));
+    const size_t numSlices = starts.size();
+
+    const ControllerState initialState = getControllerState();
+    std::vector<Engine*> engines { this };
+    for (size_t k = 1; k < numSlices; ++k) {
+        Engine& r = replica(k - 1);
+        r.allSoundOff();
+        r.setControllerState(advanceControllerState(initialState, schedule, starts[k]));
+        engines.push_back(&r);
+    }
+
+    // The slices reach the output only once all are done: report their
+    // frames as they render, up to the output size, and leave those out
+    // when stitching so that the count never goes back
+    const double outputFramesPerBlock = static_cast<double>(blockSize_) * outputRate / sampleRate_;
+    const auto outputFrames = static_cast<int64_t>(output.numFrames() - output.framesWritten());
+    auto reportedAfter = [&](int64_t blocks) {
+        return std::min(outputFrames, static_cast<int64_t>(blocks * outputFramesPerBlock));
+    };
+    std::atomic<int64_t> blocksReported { 0 };
+
+    std::vector<std::vector<float>> left(numSlices), right(numSlices);
+    workers(numSlices).parallelFor(numSlices, [&](size_t k) {
+        Engine& engine = *engines[k];
+        const int64_t begin = starts[k];
+        const int64_t end = (k + 1 < numSlices) ? starts[k + 1] : totalFrames;
+        left[k].resize(static_cast<size_t>(end - begin));
+        right[k].resize(static_cast<size_t>(end - begin));
+
+        size_t cursor = std::lower_bound(schedule.begin(), schedule.end(), begin,
+            [](const Event& e, int64_t f) { return e.frame < f; }) - schedule.begin();
+        for (int64_t frame = begin; frame < end; frame += blockSize_) {
+            checkCancelled(options);
+            engine.dispatchEvents(schedule, cursor, frame);
+            engine.renderBlock();
+            std::copy_n(engine.leftBlock(), engine.getBlockSize(), left[k].data() + (frame - begin));
+            std::copy_n(engine.rightBlock(), engine.getBlockSize(), right[k].data() + (frame - begin));
+            if (options.progress) {
+                const int64_t blocks = blocksReported.fetch_add(1) + 1;
+                const int64_t frames = reportedAfter(blocks) - reportedAfter(blocks - 1);
+                if (frames > 0) {
+                    options.progress->addFrames(frames);
+                }
+            }
+        }
+    }, [&] { checkCancelled(options); });
+
+    output.reportedAhead(static_cast<size_t>(reportedAfter(blocksReported.load())));
+    for (size_t k = 0; k < numSlices; ++k) {
+        output.write(left[k].data(), right[k].data(), left[k].size());
+    }
+
+    // Leave this engine as the serial render would: silent replicas, and
+    // the controller state at the end of the timeline
+    for (size_t k = 1; k < numSlices; ++k) {
+        engines[k]->allSoundOff();
+    }
+    setControllerState(advanceControllerState(initialState, schedule, totalFrames));
+}
+
+// === ENSEMBLE ===
+
+static void checkPan(float pan) {
+    if (pan < -1.0f || pan > 1.0f) {
+        throw std::invalid_argument("Pan must be between -1 and 1");
+    }
+}
+
+Ensemble::Ensemble(int numThreads)
+    : pool_(static_cast<size_t>(std::max(0, numThreads))) {}
+
+int Ensemble::addTrack(Engine& engine, float gain, float pan) {
+    for (const auto& track : tracks_) {
+        if (track.engine == &engine) {
+            throw std::invalid_argument("Synth is already used by another track");
+        }
+    }
+    checkPan(pan);
+    tracks_.push_back({ &engine, gain, pan });
+    return static_cast<int>(tracks_.size()) - 1;
+}
+
+void Ensemble::setTrackGain(int index, float gain) {
+    track(index).gain = gain;
+}
+
+void Ensemble::setTrackPan(int index, float pan) {
+    checkPan(pan);
+    track(index).pan = pan;
+}
+
+int Ensemble::getSampleRate() const {
+    if (tracks_.empty()) {
+        throw std::invalid_argument("Ensemble has no tracks");
+    }
+    return tracks_[0].engine->getSampleRate();
+}
+
+RenderOutput Ensemble::render(const std::vector<std::vector<Event>>& events, double renderDur,
+                              const RenderOptions& options, std::vector<RenderOutput>* stems) {
+    const size_t numTracks = tracks_.size();
+    if (numTracks == 0) {
+        throw std::invalid_argument("Ensemble has no tracks");
+    }
+    if (events.size() != numTracks) {
+        throw std::invalid_argument("Expected one event list per track");
+    }
+    if (renderDur < 0) {
+        throw std::invalid_argument("Durations must be non-negative");
+    }
+    checkRenderOptions(options);
+
+    // Hold every track engine for the whole render, locked in address order
+    // so that two ensembles sharing engines cannot deadlock
+    std::vector<Engine*> engines;
+    for (const auto& t : tracks_) {
+        engines.push_back(t.engine);
+    }
+    std::sort(engines.begin(), engines.end());
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (Engine* engine : engines) {
+        locks.emplace_back(engine->mutex());
+    }
+
+    const int sampleRate = tracks_[0].engine->getSampleRate();
+    const int blockSize = tracks_[0].engine->getBlockSize();
+    for (const auto& t : tracks_) {
+        if (t.engine->getSampleRate() != sampleRate || t.engine->getBlockSize() != blockSize) {
+            throw std::invalid_argument("All tracks must share the same sample rate and block size");
+        }
+    }
+
+    const size_t numFrames = static_cast<size_t>(outputSampleRate(options, sampleRate) * renderDur);
+    RenderOutput mix(numFrames, sampleRate, options);
+
+    // Stems only share the layout and rate of the mix
+    if (stems) {
+        RenderOptions stemOptions;
+        stemOptions.channels = options.channels;
+        stemOptions.outputSampleRate = options.outputSampleRate;
+        stemOptions.resampleQuality = options.resampleQuality;
+        stems->clear();
+        for (size_t i = 0; i < numTracks; ++i) {
+            stems->emplace_back(numFrames, sampleRate, stemOptions);
+        }
+    }
+
+    try {
+        renderChunks(events, options, mix, stems);
+    } catch (const RenderCancelled& stop) {
+        for (auto& t : tracks_) {
+            t.engine->allSoundOff();
+        }
+        keepPartialOrRethrow(stop, options, mix);
+        if (stems) {
+            for (auto& stem : *stems) {
+                stem.truncate();
+            }
+        }
+        return mix;
+    }
+
+    for (auto& t : tracks_) {
+        t.engine->allSoundOff();
+    }
+
+    mix.normalize(options.normalize, options.target);
+    return mix;
+}
+
+// Render all tracks a chunk of blocks at a time and mix them into mix
+void Ensemble::renderChunks(const std::vector<std::vector<Event>>& events, const RenderOptions& options,
+                            RenderOutput& mix, std::vector<RenderOutput>* stems) {
+    const size_t numTracks = tracks_.size();
+    const int blockSize = tracks_[0].engine->getBlockSize();
+    const size_t chunkFrames = static_cast<size_t>(chunkBlocks_) * blockSize;
+    std::vector<std::vector<float>> trackLeft(numTracks, std::vector<float>(chunkFrames));
+    std::vector<std::vector<float>> trackRight(numTracks, std::vector<float>(chunkFrames));
+    std::vector<float> mixLeft(chunkFrames), mixRight(chunkFrames);
+    std::vector<size_t> cursors(numTracks, 0);
+
+    for (int64_t frame = 0; !mix.full(); frame += chunkFrames) {
+        pool_.parallelFor(numTracks, [&](size_t i) {
+            Engine& engine = *tracks_[i].engine;
+            for (int b = 0; b < chunkBlocks_; ++b) {
+                checkCancelled(options);
+                const size_t offset = static_cast<size_t>(b) * blockSize;
+                engine.dispatchEvents(events[i], cursors[i], frame + offset);
+                engine.renderBlock();
+                std::copy_n(engine.leftBlock(), blockSize, trackLeft[i].data() + offset);
+                std::copy_n(engine.rightBlock(), blockSize, trackRight[i].data() + offset);
+            }
+
+            // Balance: the opposite side is attenuated, the center is unity
+            const float pan = tracks_[i].pan;
+            kernels::applyGain(trackLeft[i].data(), chunkFrames, tracks_[i].gain * std::min(1.0f, 1.0f - pan));
+            kernels::applyGain(trackRight[i].data(), chunkFrames, tracks_[i].gain * std::min(1.0f, 1.0f + pan));
+        }, [&] { checkCancelled(options); });
+
+        std::copy(trackLeft[0].begin(), trackLeft[0].end(), mixLeft.begin());
+        std::copy(trackRight[0].begin(), trackRight[0].end(), mixRight.begin());
+        for (size_t i = 1; i < numTracks; ++i) {
+            kernels::add(mixLeft.data(), trackLeft[i].data(), chunkFrames);
+            kernels::add(mixRight.data(), trackRight[i].data(), chunkFrames);
+        }
+
+        mix.write(mixLeft.data(), mixRight.data(), chunkFrames);
+        if (stems) {
+            for (size_t i = 0; i < numTracks; ++i) {
+                (*stems)[i].write(trackLeft[i].data(), trackRight[i].data(), chunkFrames);
+            }
+        }
+    }
+}
+
+Ensemble::Track& Ensemble::track(int index) {
+    if (index < 0 || index >= static_cast<int>(tracks_.size())) {
+        throw std::out_of_range("Track index out of range");
+    }
+    return tracks_[static_cast<size_t>(index)];
+}
+
+} // namespace pysfizz
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sfizz.hpp>
+#include "events.h"
+#include "render_output.h"
+#include "sfz_cache.h"
+#include "thread_pool.h"
+#include "time_slices.h"
+
+namespace sfz { class Synth; }
+
+// Render core of pysfizz, usable from C++ without Python.
+// Link against the pysfizz_core CMake target. Invalid arguments throw
+// std::invalid_argument, out-of-range track indices std::out_of_range.
+namespace pysfizz {
+
+// Outcome of Engine::reloadIfChanged()
+struct ReloadResult {
+    bool reloaded = false;      // false when nothing changed since the last load
+    bool success = true;        // false when the instrument could not be loaded again
+    bool textChanged = false;   // the SFZ file or one of its includes
+    std::vector<std::string> changedSamples;  // new or modified sample files
+};
+
+// Memory held by an engine, by Engine::getMemoryReport(). Sample data is
+// estimated from the file information as getSampleMemory() does, and the
+// buffers private to sfizz from its voice count and block size; the state
+// of filters, envelopes and effect processors is not visible from here.
+struct MemoryReport {
+    // Preloaded sample data by sample file
+    std::vector<std::pair<std::string, int64_t>> samples;
+    int64_t sampleBytes = 0;
+    // Render block buffers
+    int64_t blockBufferBytes = 0;
+    // sfizz voices and the buffers they render into, and effect buses with
+    // their stereo input and output blocks (estimates)
+    int64_t voiceBytes = 0;
+    int numEffectBuses = 0;
+    int64_t effectBusBytes = 0;
+    // Sample data past the preload size, which sfizz reads into memory
+    // while voices play it: at most this much, not part of the total
+    int64_t streamingBytes = 0;
+    // Replicas rendering time slices, each holding its
+    // own copy of the instrument: their samples and block buffers
+    int numReplicas = 0;
+    int64_t replicaBytes = 0;
+    int numVoices = 0;
+    int numActiveVoices = 0;
+
+    int64_t totalBytes() const { return sampleBytes + blockBufferBytes + voiceBytes + effectBusBytes + replicaBytes; }
+};
+
+// One sfizz synth with the offline render paths of the Python bindings:
+// block rendering, whole notes and event lists rendered natively, time
+// slices. Not thread-safe by itself: callers sharing an engine between
+// threads hold mutex() around each call, as the Python bindings do.
+class Engine {
+public:
+    // Based on sfizz Config.h: defaultSampleRate=48000, defaultSamplesPerBlock=1024
+    explicit Engine(int sampleRate = 48000, int blockSize = 1024);
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    // Held by whoever calls the engine, for the length of the call
+    std::mutex& mutex() const { return mutex_; }
+
+    // === INSTRUMENT ===
+
+    // A successful load adds the size of the sample files to progress
+    bool loadSfzFile(const std::string& path, Progress* progress = nullptr);
+    // Same, keeping a compiled copy of the file (includes resolved) in
+    // cacheDir for later loads, checked against the files it came from.
+    // Only these loads, and loads with a decode cache, compile the text
+    // up front; plain loads leave that to the first call needing it.
+    bool loadSfzFileCached(const std::string& path, const std::string& cacheDir, Progress* progress = nullptr);
+    // SFZ text, with sample paths relative to the directory of virtualPath
+    bool loadSfzString(const std::string& text, const std::string& virtualPath, Progress* progress = nullptr);
+    // Load the instrument file again, the same way, if it, one of its
+    // includes or one of its sample files changed since it was loaded
+    // (nothing is read when their sizes and times are the same).
+    // A reload is a full load: sfizz parses the whole file and decodes
+    // every sample again, whatever changed. Throws std::runtime_error when
+    // the instrument was not loaded from a file.
+    ReloadResult reloadIfChanged(Progress* progress = nullptr);
+    // Whether the instrument file, one of its includes or one of its sample
+    // files has a new size or modification time since the load, without
+    // reading them; false for instruments not loaded from a file
+    bool filesChanged() const;
+    // Drop the regions with the given ids (those of the region views) and
+    // load the rest again from text, which releases the sample data only
+    // they used; the instrument is then a string one (see getSfzText()).
+    // Returns the bytes of sample memory freed, by getSampleMemory().
+    // Throws std::runtime_error when the text loaded is no longer known:
+    // its files changed since a load that did not compile it, or cannot be
+    // read. The instrument is then no longer reloadIfChanged()'s to reload.
+    int64_t pruneRegions(const std::vector<int>& regionIds);
+    // SFZ text of an instrument loaded from text, empty for one loaded from a file
+    const std::string& getSfzText() const { return sfzText_; }
+    int getNumRegions() const;
+    // Region indices whose key range contains the note
+    std::vector<int> getRegionsForNote(int midiNote) const;
+
+    // Threads reading the sample files ahead of a load, 0 for one per
+    // hardware thread and 1 to leave the load serial. The loaded instrument
+    // is the same either way: sfizz still decodes every sample itself.
+    int getLoadThreads() const { return loadThreads_; }
+    void setLoadThreads(int numThreads);
+    // Directory where loads from a file decode compressed samples (FLAC,
+    // Ogg, MP3, WavPack) on the load threads before sfizz preloads them,
+    // as float WAV files reused by later loads; empty, the default, leaves
+    // decoding to sfizz. Regions then name the decoded files.
+    const std::string& getDecodeCacheDir() const { return decodeCacheDir_; }
+    void setDecodeCacheDir(const std::string& directory) { decodeCacheDir_ = directory; }
+
+    // Estimated bytes of sample data decoded in memory for the instrument
+    int64_t getSampleMemory() const;
+    // Breakdown of the memory held by the engine and its replicas
+    MemoryReport getMemoryReport() const;
+
+    // Underlying sfizz synth, for region inspection
+    sfz::Synth& synth();
+    const sfz::Synth& synth() const;
+
+    // === MIDI INPUT (delay in frames into the next block) ===
+
+    void noteOn(int delay, int noteNumber, int velocity);
+    void noteOff(int delay, int noteNumber, int velocity = 0);
+    void cc(int delay, int ccNumber, int value);
+    void pitchWheel(int delay, int pitch);
+    void allSoundOff();
+    // Controllers and pitch wheel back to their defaults
+    void resetAllControllers();
+
+    // Controller state: 128 CC values in [0, 1], pitch wheel in [-1, 1]
+    std::vector<float> getCCValues() const;
+    float getPitchWheelValue() const;
+    void setControllers(const std::vector<float>& ccValues, float pitchWheel);
+
+    // === CONFIGURATION ===
+
+    int getSampleRate() const { return sampleRate_; }
+    void setSampleRate(int sampleRate);
+    int getBlockSize() const { return blockSize_; }
+    void setBlockSize(int blockSize);
+    int getNumVoices() const;
+    void setNumVoices(int numVoices);
+    int getNumActiveVoices() const;
+
+    bool isFreeWheeling() const;
+    void enableFreeWheeling();
+    void disableFreeWheeling();
+    int getSampleQuality() const;
+    void setSampleQuality(int quality);
+    int getOscillatorQuality() const;
+    void setOscillatorQuality(int quality);
+    // Frames of each sample kept in memory; the rest is read from the file
+    // when a voice plays it
+    int getPreloadSize() const;
+    void setPreloadSize(int frames);
+
+    // === RENDERING ===
+
+    // Render one block of getBlockSize() frames into leftBlock()/rightBlock()
+    void renderBlock();
+    float* leftBlock() { return leftBuffer_.data(); }
+    float* rightBlock() { return rightBuffer_.data(); }
+    const float* leftBlock() const { return leftBuffer_.data(); }
+    const float* rightBlock() const { return rightBuffer_.data(); }
+
+    // Output sized for renderDur seconds at the output rate of the options,
+    // in caller-owned memory when buffer is given (see RenderOutput)
+    RenderOutput makeOutput(double renderDur, const RenderOptions& options, float* buffer = nullptr) const;
+
+    // Note-on at frame 0, note-off after noteOnDur seconds, until the
+    // output is full; normalized as the options ask. All sound is cut at
+    // the end, as in renderEvents
+    void renderNote(int pitch, int vel, double noteOnDur, const RenderOptions& options, RenderOutput& output);
+    RenderOutput renderNote(int pitch, int vel, double noteOnDur, double renderDur, const RenderOptions& options);
+
+    // Timed events until the output is full; events past its end are
+    // dropped and all sound is cut at the end, so that notes still held
+    // do not leak into the next render
+    void renderEvents(const std::vector<Event>& events, const RenderOptions& options, RenderOutput& output);
+    RenderOutput renderEvents(const std::vector<Event>& events, double renderDur, const RenderOptions& options);
+
+    // Send the events starting within the block at blockStart, advancing cursor
+    void dispatchEvents(const std::vector<Event>& events, size_t& cursor, int64_t blockStart);
+
+    // Predicted voice lengths of a note, from the regions it triggers
+    NoteTail predictNoteTail(int note, int velocity) const;
+
+private:
+    struct ControllerState;
+
+    int64_t sampleBytes() const;
+    std::vector<std::pair<std::string, int64_t>> sampleMemoryByFile(int64_t* streamingBytes = nullptr) const;
+    void readAheadSamples(const std::vector<std::string>& files) const;
+    std::map<std::string, std::string> decodeSamples(const std::vector<std::string>& files) const;
+    static bool decodeSample(const std::string& file, const std::string& decoded);
+    bool loadCompiled(const std::string& path, const std::string& cacheDir, const CompiledSfz& compiled,
+                      FileStamps samples, std::vector<std::string> readAhead, Progress* progress);
+    void fileLoaded(const std::string& path, const std::string& cacheDir, const std::string& text, bool success,
+                    std::string compiledText, FileStamps sources, FileStamps samples);
+    const std::string& loadedText();
+    bool carriesState();
+    ControllerState getControllerState() const;
+    static ControllerState advanceControllerState(ControllerState state, const std::vector<Event>& events,
+                                                  int64_t frame);
+    void setControllerState(const ControllerState& state);
+    Engine& replica(size_t index);
+    ThreadPool& workers(size_t numTasks);
+    void renderTimeSlices(const std::vector<Event>& schedule, RenderOutput& output, const RenderOptions& options);
+
+    sfz::Sfizz sfizz_;
+    sfizz_synth_t* handle_;
+    std::vector<float> leftBuffer_;
+    std::vector<float> rightBuffer_;
+    // Atomic since asyncio submissions size their output without the mutex
+    std::atomic<int> sampleRate_;
+    std::atomic<int> blockSize_;
+
+    // Instrument source, so that replicas can load the same one: a file, or
+    // SFZ text (sfzText_ not empty) with sfzPath_ as its virtual path
+    std::string sfzPath_;
+    std::string sfzText_;
+    int loadGeneration_ = 0;
+    // What a load from a file read, for reloadIfChanged(): the file, the cache
+    // directory it went through (empty for none), its compiled text (empty
+    // until compiled), the file with its includes and the sample files it names
+    std::string reloadPath_;
+    std::string reloadCacheDir_;
+    std::string loadedText_;
+    FileStamps loadedSources_;
+    FileStamps loadedSamples_;
+    // The instrument keeps state from note to note, so time slices are
+    // rendered serially; found out on the first sliced render after a load
+    bool carriedState_ = false;
+    bool carriedStateKnown_ = false;
+    int loadThreads_ = 0;
+    std::string decodeCacheDir_;
+
+    // Engines rendering time slices in parallel
+    std::vector<std::unique_ptr<Engine>> replicas_;
+    std::unique_ptr<ThreadPool> pool_;
+    mutable std::mutex mutex_;
+};
+
+// Several engines played together, one per track, mixed into a single output.
+// Tracks render concurrently on a native thread pool, a chunk of blocks at a
+// time, and are summed after per-track gain and balance.
+class Ensemble {
+public:
+    // 0 threads means one per hardware thread
+    explicit Ensemble(int numThreads = 0);
+
+    // Add a track playing the given engine, which must outlive the ensemble;
+    // gain is linear, pan is a balance in [-1, 1] (unity at the center).
+    // Returns the track index.
+    int addTrack(Engine& engine, float gain = 1.0f, float pan = 0.0f);
+    int getNumTracks() const { return static_cast<int>(tracks_.size()); }
+    void setTrackGain(int index, float gain);
+    void setTrackPan(int index, float pan);
+
+    // Render one event list per track and mix them down. When stems is not
+    // null it receives the per-track outputs after gain and balance, in the
+    // layout and rate of the mix but without statistics or normalization.
+    RenderOutput render(const std::vector<std::vector<Event>>& events, double renderDur,
+                        const RenderOptions& options, std::vector<RenderOutput>* stems = nullptr);
+
+    // Sample rate shared by all tracks (that of the first one)
+    int getSampleRate() const;
+
+private:
+    struct Track {
+        Engine* engine;
+        float gain;
+        float pan;
+    };
+
+    // Blocks rendered per track between two mixing steps
+    static constexpr int chunkBlocks_ = 16;
+
+    Track& track(int index);
+    void renderChunks(const std::vector<std::vector<Event>>& events, const RenderOptions& options,
+                      RenderOutput& mix, std::vector<RenderOutput>* stems);
+
+    std::vector<Track> tracks_;
+    ThreadPool pool_;
+};
+
+} // namespace pysfizz
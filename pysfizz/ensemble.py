@@ -0,0 +1,40 @@
+from . import _sfizz
+from .events import event_array
+from .synth import _render_options
+
+# Several Synths rendered together, one per track, mixed into one output.
+# Tracks render concurrently on native threads in a single GIL-free call.
+class Ensemble:
+    def __init__(self, num_threads=0):
+        self._ensemble = _sfizz.Ensemble(num_threads)
+        self.synths = []
+
+    def add_track(self, synth, gain=1.0, pan=0.0):
+        # gain is linear, pan is a balance in [-1, 1]
+        # every track needs its own Synth, with the same sample rate and block size
+        index = self._ensemble.add_track(synth._synth, gain, pan)
+        self.synths.append(synth)
+        return index
+
+    @property
+    def num_tracks(self):
+        return self._ensemble.get_num_tracks()
+
+    def set_track_gain(self, index, gain):
+        self._ensemble.set_track_gain(index, gain)
+
+    def set_track_pan(self, index, pan):
+        self._ensemble.set_track_pan(index, pan)
+
+    def render(self, events, render_dur, stems=False, channels="stereo",
+               output_sample_rate=None, resample_quality="medium",
+               stats=False, normalize=None, target=None,
+               cancel=None, timeout=None, partial=False, progress=None):
+        # events: one event list per track, see pysfizz.events.event_array
+        # returns the mix, or (mix, [stem, ...]) when stems=True
+        # cancel, timeout, partial, progress: as for Synth.render_events
+        options = _render_options(channels=channels, output_sample_rate=output_sample_rate,
+                                  resample_quality=resample_quality,
+                                  stats=stats, normalize=normalize, target=target, partial=partial)
+        arrays = [event_array(track_events) for track_events in events]
+        return self._ensemble.render(arrays, render_dur, options, stems, cancel, timeout or 0.0, progress)
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pysfizz {
+
+// Event type codes, as stored in the second column of an event array
+enum class EventType : int {
+    note_on = 0,      // data1 = note number, data2 = velocity
+    note_off = 1,     // data1 = note number, data2 = velocity
+    cc = 2,           // data1 = CC number, data2 = value
+    pitch_wheel = 3,  // data1 = pitch wheel value, data2 unused
+};
+
+// MIDI event scheduled at an absolute frame of the synth's timeline
+struct Event {
+    int64_t frame;
+    EventType type;
+    int data1;
+    int data2;
+};
+
+// Convert rows of (time in seconds, type, data1, data2) into events sorted
+// by frame. Events with the same time keep their order.
+inline std::vector<Event> makeEvents(const double* rows, size_t count, int sampleRate) {
+    std::vector<Event> events;
+    events.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const double* row = rows + 4 * i;
+        if (!(row[0] >= 0.0))
+            throw std::invalid_argument("Event times must be non-negative");
+
+        Event event;
+        event.frame = static_cast<int64_t>(row[0] * sampleRate);
+        event.data1 = static_cast<int>(row[2]);
+        event.data2 = static_cast<int>(row[3]);
+
+        const int type = static_cast<int>(row[1]);
+        switch (type) {
+        case static_cast<int>(EventType::note_on):
+        case static_cast<int>(EventType::note_off):
+            if (event.data1 < 0 || event.data1 > 127)
+                throw std::invalid_argument("Note number must be between 0 and 127");
+            if (event.data2 < 0 || event.data2 > 127)
+                throw std::invalid_argument("Velocity must be between 0 and 127");
+            break;
+        case static_cast<int>(EventType::cc):
+            if (event.data1 < 0 || event.data1 > 127)
+                throw std::invalid_argument("CC number must be between 0 and 127");
+            if (event.data2 < 0 || event.data2 > 127)
+                throw std::invalid_argument("CC value must be between 0 and 127");
+            break;
+        case static_cast<int>(EventType::pitch_wheel):
+            if (event.data1 < -8192 || event.data1 > 8192)
+                throw std::invalid_argument("Pitch wheel value must be between -8192 and +8192");
+            break;
+        default:
+            throw std::invalid_argument("Unknown event type " + std::to_string(type));
+        }
+        event.type = static_cast<EventType>(type);
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+        [](const Event& a, const Event& b) { return a.frame < b.frame; });
+    return events;
+}
+
+} // namespace pysfizz
@@ -0,0 +1,33 @@
+import numpy as np
+
+# event type codes understood by the native render methods
+EVENT_TYPES = {
+    "note_on": 0,
+    "note_off": 1,
+    "cc": 2,
+    "pitch_wheel": 3,
+}
+
+def event_array(events):
+    """Convert events to the (N, 4) float64 array used by the native renderers.
+
+    `events` is either such an array already, with rows of
+    (time, type code, data1, data2), or an iterable of tuples
+    (time, type, data1[, data2]) where time is in seconds and type is one of
+    EVENT_TYPES, e.g. (0.0, "note_on", 60, 100) or (0.5, "pitch_wheel", 2048).
+    """
+    if isinstance(events, np.ndarray):
+        array = np.ascontiguousarray(events, dtype=np.float64)
+        if array.ndim != 2 or array.shape[1] != 4:
+            raise ValueError(f"Event array must have shape (N, 4), got {array.shape}")
+        return array
+    rows = []
+    for event in events:
+        if len(event) not in (3, 4):
+            raise ValueError(f"Events must be (time, type, data1[, data2]), got {event!r}")
+        time, kind, data1 = event[:3]
+        data2 = event[3] if len(event) == 4 else 0
+        if kind not in EVENT_TYPES:
+            raise ValueError(f"Event type must be one of {list(EVENT_TYPES)}, got {kind!r}")
+        rows.append((time, EVENT_TYPES[kind], data1, data2))
+    return np.array(rows, dtype=np.float64).reshape(-1, 4)
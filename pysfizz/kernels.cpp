@@ -0,0 +1,127 @@
+#include "kernels.h"
+#include <atomic>
+#include <cstdlib>
+
+#if defined(PYSFIZZ_HAVE_AVX2) || defined(PYSFIZZ_HAVE_AVX512)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace pysfizz {
+namespace kernels {
+
+namespace baseline { const Table& table(); }
+#if defined(PYSFIZZ_HAVE_AVX2)
+namespace avx2 { const Table& table(); }
+#endif
+#if defined(PYSFIZZ_HAVE_AVX512)
+namespace avx512 { const Table& table(); }
+#endif
+#if defined(PYSFIZZ_HAVE_NEON)
+namespace neon { const Table& table(); }
+#endif
+
+namespace {
+
+#if defined(PYSFIZZ_HAVE_AVX2) || defined(PYSFIZZ_HAVE_AVX512)
+enum class Feature { avx2, avx512 };
+
+bool cpuSupports(Feature feature) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // The OS must save the AVX (and AVX-512) register state
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave)
+        return false;
+    const unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+    switch (feature) {
+    case Feature::avx2:
+        return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    case Feature::avx512:
+        return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+    }
+    return false;
+#else
+    __builtin_cpu_init();
+    switch (feature) {
+    case Feature::avx2:
+        return __builtin_cpu_supports("avx2");
+    case Feature::avx512:
+        return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#endif
+}
+#endif
+
+// Compiled-in variants the CPU can run, slowest first
+std::vector<const Table*> supportedTables() {
+    std::vector<const Table*> tables { &baseline::table() };
+#if defined(PYSFIZZ_HAVE_NEON)
+    // Part of every arm64 CPU
+    tables.push_back(&neon::table());
+#endif
+#if defined(PYSFIZZ_HAVE_AVX2)
+    if (cpuSupports(Feature::avx2))
+        tables.push_back(&avx2::table());
+#endif
+#if defined(PYSFIZZ_HAVE_AVX512)
+    if (cpuSupports(Feature::avx512))
+        tables.push_back(&avx512::table());
+#endif
+    return tables;
+}
+
+const Table* findTable(const std::string& name) {
+    for (const Table* table : supportedTables()) {
+        if (name == table->name)
+            return table;
+    }
+    return nullptr;
+}
+
+const Table* detect() {
+    if (const char* requested = std::getenv("PYSFIZZ_SIMD")) {
+        if (const Table* table = findTable(requested))
+            return table;
+    }
+    return supportedTables().back();
+}
+
+std::atomic<const Table*>& current() {
+    static std::atomic<const Table*> table { detect() };
+    return table;
+}
+
+} // namespace
+
+const Table& active() {
+    return *current().load(std::memory_order_relaxed);
+}
+
+std::vector<std::string> available() {
+    std::vector<std::string> names;
+    for (const Table* table : supportedTables())
+        names.emplace_back(table->name);
+    return names;
+}
+
+bool select(const std::string& name) {
+    const Table* table = findTable(name);
+    if (!table)
+        return false;
+    current().store(table, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace kernels
+} // namespace pysfizz
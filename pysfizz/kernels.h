@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hot per-sample loops used by the native render paths.
+// Each loop is compiled once per instruction set (see kernels_impl.h, and
+// kernels_neon.cpp for arm64) and the best variant supported by the CPU is
+// picked on first use, so wheels built for the baseline architecture still
+// run AVX2/AVX-512 code. sfizz's own loops are not dispatched here.
+namespace pysfizz {
+namespace kernels {
+
+// One compiled variant of every kernel
+struct Table {
+    const char* name;
+    float (*peakAbs)(const float* input, size_t size);
+    double (*sumSquares)(const float* input, size_t size);
+    float (*dot)(const float* a, const float* b, size_t size);
+    void (*applyGain)(float* data, size_t size, float gain);
+    void (*add)(float* output, const float* input, size_t size);
+    void (*downmixMono)(float* output, const float* left, const float* right, size_t size);
+    void (*encodeMidSide)(float* mid, float* side, const float* left, const float* right, size_t size);
+    void (*floatToInt16)(int16_t* output, const float* input, size_t size);
+};
+
+// Variant in use. It is the best one the CPU supports, unless the
+// PYSFIZZ_SIMD environment variable or select() asked for another one.
+const Table& active();
+
+// Variants compiled in and supported by this CPU, slowest first
+std::vector<std::string> available();
+
+// Switch to a variant by name; returns false if it is not available
+bool select(const std::string& name);
+
+// Largest absolute sample value
+inline float peakAbs(const float* input, size_t size) {
+    return active().peakAbs(input, size);
+}
+
+// Sum of squared sample values, accumulated in double
+inline double sumSquares(const float* input, size_t size) {
+    return active().sumSquares(input, size);
+}
+
+// Dot product (polyphase resampler taps)
+inline float dot(const float* a, const float* b, size_t size) {
+    return active().dot(a, b, size);
+}
+
+// In-place multiplication by a constant gain
+inline void applyGain(float* data, size_t size, float gain) {
+    active().applyGain(data, size, gain);
+}
+
+// Accumulate: output += input
+inline void add(float* output, const float* input, size_t size) {
+    active().add(output, input, size);
+}
+
+// Mono downmix: output = (left + right) / 2
+inline void downmixMono(float* output, const float* left, const float* right, size_t size) {
+    active().downmixMono(output, left, right, size);
+}
+
+// Mid/side encoding: mid = (left + right) / 2, side = (left - right) / 2
+inline void encodeMidSide(float* mid, float* side, const float* left, const float* right, size_t size) {
+    active().encodeMidSide(mid, side, left, right, size);
+}
+
+// Float to 16-bit PCM, clipped to [-1, 1] and rounded to nearest
+inline void floatToInt16(int16_t* output, const float* input, size_t size) {
+    active().floatToInt16(output, input, size);
+}
+
+} // namespace kernels
+} // namespace pysfizz
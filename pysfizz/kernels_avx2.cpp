@@ -0,0 +1,4 @@
+// AVX2 kernels, compiled with -mavx2 (/arch:AVX2)
+#define PYSFIZZ_KERNELS_NAME "avx2"
+#define PYSFIZZ_KERNELS_VARIANT avx2
+#include "kernels_impl.h"
@@ -0,0 +1,4 @@
+// AVX-512 kernels, compiled with -mavx512f (/arch:AVX512)
+#define PYSFIZZ_KERNELS_NAME "avx512"
+#define PYSFIZZ_KERNELS_VARIANT avx512
+#include "kernels_impl.h"
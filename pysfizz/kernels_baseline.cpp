@@ -0,0 +1,9 @@
+// Baseline kernels: SSE2 on x86-64, plain C++ elsewhere (arm64 has its
+// NEON variant in kernels_neon.cpp)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PYSFIZZ_KERNELS_NAME "sse2"
+#else
+#define PYSFIZZ_KERNELS_NAME "generic"
+#endif
+#define PYSFIZZ_KERNELS_VARIANT baseline
+#include "kernels_impl.h"
@@ -0,0 +1,129 @@
+// Kernel loops, included once per instruction set by kernels_<isa>.cpp.
+// The including file defines PYSFIZZ_KERNELS_VARIANT (a namespace name) and
+// PYSFIZZ_KERNELS_NAME (a string) and is compiled with the matching flags.
+// Everything is in an unnamed namespace so that the variants can never be
+// merged by the linker.
+//
+// Loops are plain counted loops that the compiler vectorizes for the target.
+// Reductions keep `lanes` independent partial results, which vectorizes
+// without reassociating floating point math, so every variant returns
+// exactly the same values.
+
+#include <cstddef>
+#include <cstdint>
+#include "kernels.h"
+
+#if !defined(PYSFIZZ_KERNELS_VARIANT) || !defined(PYSFIZZ_KERNELS_NAME)
+#error "Define PYSFIZZ_KERNELS_VARIANT and PYSFIZZ_KERNELS_NAME before including kernels_impl.h"
+#endif
+
+namespace pysfizz {
+namespace kernels {
+namespace PYSFIZZ_KERNELS_VARIANT {
+namespace {
+
+constexpr size_t lanes = 16;
+
+float peakAbs(const float* input, size_t size) {
+    float partial[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j) {
+            const float value = input[i + j] < 0.0f ? -input[i + j] : input[i + j];
+            partial[j] = value > partial[j] ? value : partial[j];
+        }
+    }
+    float peak = 0.0f;
+    for (size_t j = 0; j < lanes; ++j)
+        peak = partial[j] > peak ? partial[j] : peak;
+    for (; i < size; ++i) {
+        const float value = input[i] < 0.0f ? -input[i] : input[i];
+        peak = value > peak ? value : peak;
+    }
+    return peak;
+}
+
+double sumSquares(const float* input, size_t size) {
+    double partial[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j) {
+            const double value = input[i + j];
+            partial[j] += value * value;
+        }
+    }
+    double sum = 0.0;
+    for (size_t j = 0; j < lanes; ++j)
+        sum += partial[j];
+    for (; i < size; ++i)
+        sum += static_cast<double>(input[i]) * input[i];
+    return sum;
+}
+
+float dot(const float* a, const float* b, size_t size) {
+    float partial[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j)
+            partial[j] += a[i + j] * b[i + j];
+    }
+    float sum = 0.0f;
+    for (size_t j = 0; j < lanes; ++j)
+        sum += partial[j];
+    for (; i < size; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+void applyGain(float* data, size_t size, float gain) {
+    for (size_t i = 0; i < size; ++i)
+        data[i] *= gain;
+}
+
+void add(float* output, const float* input, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        output[i] += input[i];
+}
+
+void downmixMono(float* output, const float* left, const float* right, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        output[i] = 0.5f * (left[i] + right[i]);
+}
+
+void encodeMidSide(float* mid, float* side, const float* left, const float* right, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        mid[i] = 0.5f * (left[i] + right[i]);
+        side[i] = 0.5f * (left[i] - right[i]);
+    }
+}
+
+void floatToInt16(int16_t* output, const float* input, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        float value = input[i] * 32767.0f;
+        value = value > 32767.0f ? 32767.0f : value;
+        value = value < -32767.0f ? -32767.0f : value;
+        value += value < 0.0f ? -0.5f : 0.5f;
+        output[i] = static_cast<int16_t>(static_cast<int32_t>(value));
+    }
+}
+
+} // namespace
+
+const Table& table() {
+    static const Table variant {
+        PYSFIZZ_KERNELS_NAME,
+        &peakAbs,
+        &sumSquares,
+        &dot,
+        &applyGain,
+        &add,
+        &downmixMono,
+        &encodeMidSide,
+        &floatToInt16,
+    };
+    return variant;
+}
+
+} // namespace PYSFIZZ_KERNELS_VARIANT
+} // namespace kernels
+} // namespace pysfizz
@@ -0,0 +1,170 @@
+// NEON kernels for arm64, written with intrinsics.
+// They follow kernels_impl.h step by step: the same 16 partial results for
+// reductions (four 4-lane registers), the same comparisons and the same
+// operation order without fused multiply-add, so they return exactly what
+// the generic variant returns. Tails shorter than a vector run the scalar
+// loop of the generic variant.
+
+#include <arm_neon.h>
+#include <cstddef>
+#include <cstdint>
+#include "kernels.h"
+
+namespace pysfizz {
+namespace kernels {
+namespace neon {
+namespace {
+
+constexpr size_t lanes = 16;
+
+float peakAbs(const float* input, size_t size) {
+    float32x4_t partial[4] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t k = 0; k < 4; ++k) {
+            const float32x4_t value = vabsq_f32(vld1q_f32(input + i + 4 * k));
+            partial[k] = vbslq_f32(vcgtq_f32(value, partial[k]), value, partial[k]);
+        }
+    }
+    float lane[lanes];
+    for (size_t k = 0; k < 4; ++k)
+        vst1q_f32(lane + 4 * k, partial[k]);
+    float peak = 0.0f;
+    for (size_t j = 0; j < lanes; ++j)
+        peak = lane[j] > peak ? lane[j] : peak;
+    for (; i < size; ++i) {
+        const float value = input[i] < 0.0f ? -input[i] : input[i];
+        peak = value > peak ? value : peak;
+    }
+    return peak;
+}
+
+double sumSquares(const float* input, size_t size) {
+    float64x2_t partial[8];
+    for (auto& p : partial)
+        p = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t k = 0; k < 4; ++k) {
+            const float32x4_t value = vld1q_f32(input + i + 4 * k);
+            const float64x2_t low = vcvt_f64_f32(vget_low_f32(value));
+            const float64x2_t high = vcvt_high_f64_f32(value);
+            partial[2 * k] = vaddq_f64(partial[2 * k], vmulq_f64(low, low));
+            partial[2 * k + 1] = vaddq_f64(partial[2 * k + 1], vmulq_f64(high, high));
+        }
+    }
+    double lane[lanes];
+    for (size_t k = 0; k < 8; ++k)
+        vst1q_f64(lane + 2 * k, partial[k]);
+    double sum = 0.0;
+    for (size_t j = 0; j < lanes; ++j)
+        sum += lane[j];
+    for (; i < size; ++i)
+        sum += static_cast<double>(input[i]) * input[i];
+    return sum;
+}
+
+float dot(const float* a, const float* b, size_t size) {
+    float32x4_t partial[4] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t k = 0; k < 4; ++k)
+            partial[k] = vaddq_f32(partial[k], vmulq_f32(vld1q_f32(a + i + 4 * k), vld1q_f32(b + i + 4 * k)));
+    }
+    float lane[lanes];
+    for (size_t k = 0; k < 4; ++k)
+        vst1q_f32(lane + 4 * k, partial[k]);
+    float sum = 0.0f;
+    for (size_t j = 0; j < lanes; ++j)
+        sum += lane[j];
+    for (; i < size; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+void applyGain(float* data, size_t size, float gain) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_f32(data + i, vmulq_n_f32(vld1q_f32(data + i), gain));
+    for (; i < size; ++i)
+        data[i] *= gain;
+}
+
+void add(float* output, const float* input, size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_f32(output + i, vaddq_f32(vld1q_f32(output + i), vld1q_f32(input + i)));
+    for (; i < size; ++i)
+        output[i] += input[i];
+}
+
+void downmixMono(float* output, const float* left, const float* right, size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_f32(output + i, vmulq_n_f32(vaddq_f32(vld1q_f32(left + i), vld1q_f32(right + i)), 0.5f));
+    for (; i < size; ++i)
+        output[i] = 0.5f * (left[i] + right[i]);
+}
+
+void encodeMidSide(float* mid, float* side, const float* left, const float* right, size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const float32x4_t l = vld1q_f32(left + i);
+        const float32x4_t r = vld1q_f32(right + i);
+        vst1q_f32(mid + i, vmulq_n_f32(vaddq_f32(l, r), 0.5f));
+        vst1q_f32(side + i, vmulq_n_f32(vsubq_f32(l, r), 0.5f));
+    }
+    for (; i < size; ++i) {
+        mid[i] = 0.5f * (left[i] + right[i]);
+        side[i] = 0.5f * (left[i] - right[i]);
+    }
+}
+
+// Clipped and rounded half away from zero, then truncated like the cast
+// of the generic variant
+int32x4_t toInt16Range(float32x4_t input) {
+    const float32x4_t max = vdupq_n_f32(32767.0f);
+    const float32x4_t min = vdupq_n_f32(-32767.0f);
+    float32x4_t value = vmulq_n_f32(input, 32767.0f);
+    value = vbslq_f32(vcgtq_f32(value, max), max, value);
+    value = vbslq_f32(vcltq_f32(value, min), min, value);
+    const float32x4_t half = vbslq_f32(vcltq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(value, half));
+}
+
+void floatToInt16(int16_t* output, const float* input, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const int16x4_t low = vmovn_s32(toInt16Range(vld1q_f32(input + i)));
+        const int16x4_t high = vmovn_s32(toInt16Range(vld1q_f32(input + i + 4)));
+        vst1q_s16(output + i, vcombine_s16(low, high));
+    }
+    for (; i < size; ++i) {
+        float value = input[i] * 32767.0f;
+        value = value > 32767.0f ? 32767.0f : value;
+        value = value < -32767.0f ? -32767.0f : value;
+        value += value < 0.0f ? -0.5f : 0.5f;
+        output[i] = static_cast<int16_t>(static_cast<int32_t>(value));
+    }
+}
+
+} // namespace
+
+const Table& table() {
+    static const Table variant {
+        "neon",
+        &peakAbs,
+        &sumSquares,
+        &dot,
+        &applyGain,
+        &add,
+        &downmixMono,
+        &encodeMidSide,
+        &floatToInt16,
+    };
+    return variant;
+}
+
+} // namespace neon
+} // namespace kernels
+} // namespace pysfizz
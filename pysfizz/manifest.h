@@ -0,0 +1,473 @@
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "render_output.h"
+
+namespace pysfizz {
+
+// Minimal JSON value, enough for job manifests
+struct JsonValue {
+    enum class Type { null, boolean, number, string, array, object };
+
+    Type type = Type::null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& member : object) {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+// Recursive descent parser for one JSON document
+class JsonParser {
+public:
+    static JsonValue parse(const std::string& text) {
+        JsonParser parser(text);
+        JsonValue value = parser.parseValue();
+        parser.skipSpace();
+        if (parser.pos_ != text.size())
+            parser.fail("unexpected trailing characters");
+        return value;
+    }
+
+private:
+    explicit JsonParser(const std::string& text) : text_(text) {}
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::invalid_argument("Invalid JSON at column " + std::to_string(pos_ + 1) + ": " + what);
+    }
+
+    void skipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+            ++pos_;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c))
+            fail(std::string("expected '") + c + "'");
+    }
+
+    bool consumeWord(const char* word) {
+        const size_t length = std::char_traits<char>::length(word);
+        if (text_.compare(pos_, length, word) != 0)
+            return false;
+        pos_ += length;
+        return true;
+    }
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos_ >= text_.size())
+            fail("unexpected end of input");
+
+        JsonValue value;
+        const char c = text_[pos_];
+        if (c == '{') {
+            ++pos_;
+            value.type = JsonValue::Type::object;
+            if (consume('}'))
+                return value;
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.object.emplace_back(std::move(key), parseValue());
+            } while (consume(','));
+            expect('}');
+        } else if (c == '[') {
+            ++pos_;
+            value.type = JsonValue::Type::array;
+            if (consume(']'))
+                return value;
+            do {
+                value.array.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        } else if (c == '"') {
+            value.type = JsonValue::Type::string;
+            value.string = parseString();
+        } else if (consumeWord("true")) {
+            value.type = JsonValue::Type::boolean;
+            value.boolean = true;
+        } else if (consumeWord("false")) {
+            value.type = JsonValue::Type::boolean;
+        } else if (consumeWord("null")) {
+            value.type = JsonValue::Type::null;
+        } else {
+            const char* begin = text_.c_str() + pos_;
+            char* end = nullptr;
+            value.type = JsonValue::Type::number;
+            value.number = std::strtod(begin, &end);
+            if (end == begin)
+                fail("unexpected character");
+            pos_ += static_cast<size_t>(end - begin);
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (pos_ >= text_.size() || text_[pos_] != '"')
+            fail("expected a string");
+        ++pos_;
+
+        std::string result;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (pos_ >= text_.size())
+                break;
+            c = text_[pos_++];
+            switch (c) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'u': {
+                if (pos_ + 4 > text_.size())
+                    fail("truncated escape");
+                const unsigned code = static_cast<unsigned>(std::stoul(text_.substr(pos_, 4), nullptr, 16));
+                pos_ += 4;
+                // UTF-8 encoding of the basic multilingual plane
+                if (code < 0x80) {
+                    result += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    result += static_cast<char>(0xc0 | (code >> 6));
+                    result += static_cast<char>(0x80 | (code & 0x3f));
+                } else {
+                    result += static_cast<char>(0xe0 | (code >> 12));
+                    result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                    result += static_cast<char>(0x80 | (code & 0x3f));
+                }
+                break;
+            }
+            default: result += c; break;
+            }
+        }
+        if (pos_ >= text_.size())
+            fail("unterminated string");
+        ++pos_;
+        return result;
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+
+// One note of a job: pitch, velocity, start and duration in seconds
+struct NoteSpec {
+    int pitch = 60;
+    int velocity = 100;
+    double start = 0.0;
+    double duration = 1.0;
+};
+
+// One render of a batch manifest
+struct Job {
+    size_t line = 0;           // manifest line, for messages
+    std::string instrument;    // SFZ file
+    std::string output;        // WAV file
+    std::string midiFile;      // Standard MIDI File to play, instead of notes
+    std::vector<NoteSpec> notes;
+    std::vector<std::pair<int, int>> ccState;  // (CC number, value) sent at time 0
+    double renderDur = -1.0;   // negative: end of the notes or MIDI file plus tail
+    double tail = 2.0;
+    int sampleRate = 0;        // 0: the renderer's default
+    bool float32 = false;      // 32-bit float WAV instead of 16-bit PCM
+    RenderOptions options;
+};
+
+namespace manifest_detail {
+
+inline std::string toString(const JsonValue& value, const char* field) {
+    if (value.type == JsonValue::Type::string)
+        return value.string;
+    if (value.type == JsonValue::Type::number) {
+        std::ostringstream out;
+        out << value.number;
+        return out.str();
+    }
+    throw std::invalid_argument(std::string("'") + field + "' must be a string");
+}
+
+// Numbers may come as strings from CSV cells
+inline double toNumber(const JsonValue& value, const char* field) {
+    if (value.type == JsonValue::Type::number)
+        return value.number;
+    if (value.type == JsonValue::Type::string) {
+        char* end = nullptr;
+        const double number = std::strtod(value.string.c_str(), &end);
+        if (end != value.string.c_str() && *end == '\0')
+            return number;
+    }
+    throw std::invalid_argument(std::string("'") + field + "' must be a number");
+}
+
+inline std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::string part;
+    std::istringstream in(text);
+    while (std::getline(in, part, separator)) {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+// [[pitch, velocity, start, duration], ...] or "pitch:velocity:start:duration;..."
+inline std::vector<NoteSpec> toNotes(const JsonValue& value) {
+    std::vector<std::vector<double>> rows;
+    if (value.type == JsonValue::Type::array) {
+        for (const auto& item : value.array) {
+            if (item.type != JsonValue::Type::array)
+                throw std::invalid_argument("'notes' must be a list of [pitch, velocity, start, duration]");
+            std::vector<double> row;
+            for (const auto& number : item.array)
+                row.push_back(toNumber(number, "notes"));
+            rows.push_back(row);
+        }
+    } else if (value.type == JsonValue::Type::string) {
+        for (const auto& note : split(value.string, ';')) {
+            std::vector<double> row;
+            for (const auto& number : split(note, ':')) {
+                JsonValue cell;
+                cell.type = JsonValue::Type::string;
+                cell.string = number;
+                row.push_back(toNumber(cell, "notes"));
+            }
+            rows.push_back(row);
+        }
+    } else {
+        throw std::invalid_argument("'notes' must be a list or a string");
+    }
+
+    std::vector<NoteSpec> notes;
+    for (const auto& row : rows) {
+        if (row.size() != 4)
+            throw std::invalid_argument("Each note needs pitch, velocity, start and duration");
+        NoteSpec note;
+        note.pitch = static_cast<int>(row[0]);
+        note.velocity = static_cast<int>(row[1]);
+        note.start = row[2];
+        note.duration = row[3];
+        notes.push_back(note);
+    }
+    return notes;
+}
+
+// {"64": 127, ...} or "64=127;7=100"
+inline std::vector<std::pair<int, int>> toCCState(const JsonValue& value) {
+    std::vector<std::pair<int, int>> state;
+    auto add = [&state](const std::string& number, double ccValue) {
+        char* end = nullptr;
+        const long cc = std::strtol(number.c_str(), &end, 10);
+        if (end == number.c_str() || *end != '\0' || cc < 0 || cc > 127)
+            throw std::invalid_argument("CC numbers must be between 0 and 127");
+        if (ccValue < 0 || ccValue > 127)
+            throw std::invalid_argument("CC values must be between 0 and 127");
+        state.emplace_back(static_cast<int>(cc), static_cast<int>(ccValue));
+    };
+    if (value.type == JsonValue::Type::object) {
+        for (const auto& member : value.object)
+            add(member.first, toNumber(member.second, "cc"));
+    } else if (value.type == JsonValue::Type::string) {
+        for (const auto& pair : split(value.string, ';')) {
+            const size_t equal = pair.find('=');
+            if (equal == std::string::npos)
+                throw std::invalid_argument("'cc' entries must be number=value");
+            JsonValue cell;
+            cell.type = JsonValue::Type::string;
+            cell.string = pair.substr(equal + 1);
+            add(pair.substr(0, equal), toNumber(cell, "cc"));
+        }
+    } else {
+        throw std::invalid_argument("'cc' must be an object or a string");
+    }
+    return state;
+}
+
+} // namespace manifest_detail
+
+// Build a job from the fields of a JSON object or CSV row.
+// Recognized fields: instrument, output (required); midi, or notes, or
+// pitch/velocity/note_on_dur; cc, render_dur, tail, sample_rate,
+// channels, output_sample_rate, resample_quality, normalize, target,
+// format ("int16" or "float32").
+inline Job makeJob(const JsonValue& fields, size_t line) {
+    using namespace manifest_detail;
+    if (fields.type != JsonValue::Type::object)
+        throw std::invalid_argument("Each job must be an object");
+
+    Job job;
+    job.line = line;
+    NoteSpec single;
+    bool hasSingle = false;
+
+    for (const auto& member : fields.object) {
+        const std::string& key = member.first;
+        const JsonValue& value = member.second;
+        if (key == "instrument")
+            job.instrument = toString(value, "instrument");
+        else if (key == "output")
+            job.output = toString(value, "output");
+        else if (key == "midi")
+            job.midiFile = toString(value, "midi");
+        else if (key == "notes")
+            job.notes = toNotes(value);
+        else if (key == "pitch" || key == "velocity" || key == "note_on_dur") {
+            const double number = toNumber(value, key.c_str());
+            if (key == "pitch")
+                single.pitch = static_cast<int>(number);
+            else if (key == "velocity")
+                single.velocity = static_cast<int>(number);
+            else
+                single.duration = number;
+            hasSingle = true;
+        } else if (key == "cc")
+            job.ccState = toCCState(value);
+        else if (key == "render_dur")
+            job.renderDur = toNumber(value, "render_dur");
+        else if (key == "tail")
+            job.tail = toNumber(value, "tail");
+        else if (key == "sample_rate")
+            job.sampleRate = static_cast<int>(toNumber(value, "sample_rate"));
+        else if (key == "channels")
+            job.options.channels = toString(value, "channels");
+        else if (key == "output_sample_rate")
+            job.options.outputSampleRate = static_cast<int>(toNumber(value, "output_sample_rate"));
+        else if (key == "resample_quality")
+            job.options.resampleQuality = toString(value, "resample_quality");
+        else if (key == "normalize")
+            job.options.normalize = (value.type == JsonValue::Type::null) ? "" : toString(value, "normalize");
+        else if (key == "target")
+            job.options.target = toNumber(value, "target");
+        else if (key == "format") {
+            const std::string format = toString(value, "format");
+            if (format != "int16" && format != "float32")
+                throw std::invalid_argument("'format' must be 'int16' or 'float32'");
+            job.float32 = (format == "float32");
+        } else
+            throw std::invalid_argument("Unknown field '" + key + "'");
+    }
+
+    if (job.instrument.empty())
+        throw std::invalid_argument("Missing 'instrument'");
+    if (job.output.empty())
+        throw std::invalid_argument("Missing 'output'");
+    if (!job.midiFile.empty() && (!job.notes.empty() || hasSingle))
+        throw std::invalid_argument("Give either 'midi' or notes, not both");
+    if (hasSingle)
+        job.notes.push_back(single);
+    if (job.midiFile.empty() && job.notes.empty())
+        throw std::invalid_argument("Missing 'notes', 'pitch' or 'midi'");
+    if (job.options.normalize == "peak" && fields.find("target") == nullptr)
+        job.options.target = -1.0;
+    else if (job.options.normalize == "loudness" && fields.find("target") == nullptr)
+        job.options.target = -23.0;
+    checkRenderOptions(job.options);
+    return job;
+}
+
+// Split one CSV record, with "quoted" fields and "" escapes
+inline std::vector<std::string> splitCsvRecord(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+// Read a manifest: CSV with a header row when the path ends in .csv,
+// JSON Lines (one object per line) otherwise. Blank lines and lines
+// starting with '#' are skipped. Errors mention the manifest line.
+inline std::vector<Job> readManifest(const std::string& path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open manifest " + path);
+
+    const bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    std::vector<std::string> header;
+    std::vector<Job> jobs;
+    std::string text;
+    for (size_t line = 1; std::getline(in, text); ++line) {
+        const size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#')
+            continue;
+        try {
+            if (!csv) {
+                jobs.push_back(makeJob(JsonParser::parse(text), line));
+                continue;
+            }
+            const auto cells = splitCsvRecord(text);
+            if (header.empty()) {
+                header = cells;
+                continue;
+            }
+            if (cells.size() > header.size())
+                throw std::invalid_argument("More cells than header columns");
+            JsonValue fields;
+            fields.type = JsonValue::Type::object;
+            for (size_t i = 0; i < cells.size(); ++i) {
+                if (cells[i].empty())
+                    continue;
+                JsonValue cell;
+                cell.type = JsonValue::Type::string;
+                cell.string = cells[i];
+                fields.object.emplace_back(header[i], cell);
+            }
+            jobs.push_back(makeJob(fields, line));
+        } catch (const std::exception& e) {
+            throw std::invalid_argument(path + ":" + std::to_string(line) + ": " + e.what());
+        }
+    }
+    return jobs;
+}
+
+} // namespace pysfizz
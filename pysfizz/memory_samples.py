@@ -0,0 +1,125 @@
+import os
+import re
+import shutil
+import struct
+import tempfile
+import threading
+from pathlib import Path
+
+import numpy as np
+
+from .shared_samples import shared_root
+
+# Samples made in Python, played by SFZ text loaded with load_sfz_string.
+# sfizz only reads samples through file paths, so this is not zero-copy:
+# each array is written once as a float WAV file into shared_root() (a
+# C-contiguous little-endian float32 array as it is, anything else
+# converted first), and sfizz decodes that file into its own buffers like
+# any other sample. On Linux the directory is on tmpfs (/dev/shm), so the
+# files cost memory rather than disk I/O until the bank is closed;
+# elsewhere it is under the temporary directory, usually on disk. SFZ text
+# names the samples by the names they were added under:
+#
+#   bank = pysfizz.SampleBank()
+#   bank.add("tone.wav", audio, sample_rate=48000)   # (frames,) or (frames, 2)
+#   synth.load_sfz_string("<region> sample=tone.wav", samples=bank)
+#
+# A synth keeps the bank it loaded from alive, since sfizz reads past the
+# preloaded part of a sample while a voice plays it.
+
+_NAME = re.compile(r"[A-Za-z0-9_.\- ]+(/[A-Za-z0-9_.\- ]+)*")
+
+# WAVE_FORMAT_IEEE_FLOAT
+_FLOAT_FORMAT = 3
+
+
+def _wav_header(num_frames, num_channels, sample_rate):
+    data_bytes = num_frames * num_channels * 4
+    return b"".join([
+        b"RIFF", struct.pack("<I", 4 + 26 + 12 + 8 + data_bytes), b"WAVE",
+        # fmt chunk with the cbSize field of non-PCM formats
+        b"fmt ", struct.pack("<IHHIIHHH", 18, _FLOAT_FORMAT, num_channels, sample_rate,
+                             sample_rate * num_channels * 4, num_channels * 4, 32, 0),
+        b"fact", struct.pack("<II", 4, num_frames),
+        b"data", struct.pack("<I", data_bytes),
+    ])
+
+
+class SampleBank:
+    def __init__(self, root=None):
+        root = Path(root) if root is not None else shared_root()
+        root.mkdir(parents=True, exist_ok=True)
+        self.directory = Path(tempfile.mkdtemp(prefix="samples-", dir=root))
+        self._samples = {}  # name -> (frames, channels, sample rate)
+        self._lock = threading.Lock()
+
+    def add(self, name, audio, sample_rate):
+        # float samples in [-1, 1], shaped (frames,) or (frames, channels)
+        # with one or two channels; a C-contiguous little-endian float32 array is written
+        # as it is, anything else is converted first. Adding a name again
+        # replaces its sample for later loads.
+        if not _NAME.fullmatch(name) or ".." in name.split("/"):
+            raise ValueError(f"Invalid sample name: {name!r}")
+        audio = np.ascontiguousarray(audio, dtype="<f4")
+        if audio.ndim not in (1, 2) or (audio.ndim == 2 and audio.shape[1] not in (1, 2)):
+            raise ValueError("Samples must be shaped (frames,) or (frames, channels) with 1 or 2 channels")
+        if sample_rate <= 0:
+            raise ValueError("Sample rate must be positive")
+        num_frames = audio.shape[0]
+        num_channels = 1 if audio.ndim == 1 else audio.shape[1]
+
+        path = self.directory / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        # written aside and renamed, so that a synth loading meanwhile
+        # sees either sample in full
+        fd, temporary = tempfile.mkstemp(dir=path.parent, prefix=".add-")
+        try:
+            with os.fdopen(fd, "wb") as f:
+                f.write(_wav_header(num_frames, num_channels, int(sample_rate)))
+                f.write(audio.data)
+            os.replace(temporary, path)
+        except BaseException:
+            os.unlink(temporary)
+            raise
+        with self._lock:
+            self._samples[name] = (num_frames, num_channels, int(sample_rate))
+        return str(path)
+
+    def remove(self, name):
+        with self._lock:
+            del self._samples[name]
+        (self.directory / name).unlink()
+
+    def nbytes(self):
+        # bytes of the sample files, headers included
+        with self._lock:
+            return sum(len(_wav_header(*info)) + info[0] * info[1] * 4 for info in self._samples.values())
+
+    def names(self):
+        with self._lock:
+            return sorted(self._samples)
+
+    def __contains__(self, name):
+        with self._lock:
+            return name in self._samples
+
+    def info(self, name):
+        # frames, channels and sample rate of a sample
+        with self._lock:
+            return self._samples[name]
+
+    def close(self):
+        # delete the sample files; synths loaded from the bank must not play anymore
+        with self._lock:
+            self._samples.clear()
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+    def __del__(self):
+        if hasattr(self, "directory"):
+            shutil.rmtree(self.directory, ignore_errors=True)
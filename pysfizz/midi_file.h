@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "events.h"
+
+namespace pysfizz {
+
+// Events of a Standard MIDI File, and the time of its last event
+struct MidiFile {
+    std::vector<Event> events;
+    double duration = 0.0;
+};
+
+// Read a Standard MIDI File (format 0 or 1) into events at sampleRate.
+// All tracks and channels are merged onto one synth; notes, CCs and pitch
+// wheel are kept, everything else is dropped. Tempo changes apply to every
+// track, as the format requires.
+inline MidiFile readMidiFile(const std::string& path, int sampleRate) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open MIDI file " + path);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    auto fail = [&path](const std::string& what) {
+        throw std::invalid_argument("Invalid MIDI file " + path + ": " + what);
+    };
+    auto need = [&](size_t count) {
+        if (pos + count > data.size())
+            fail("truncated");
+    };
+    auto readU32 = [&]() {
+        need(4);
+        const uint32_t value = (uint32_t(data[pos]) << 24) | (uint32_t(data[pos + 1]) << 16)
+                             | (uint32_t(data[pos + 2]) << 8) | uint32_t(data[pos + 3]);
+        pos += 4;
+        return value;
+    };
+    auto readU16 = [&]() {
+        need(2);
+        const uint16_t value = static_cast<uint16_t>((data[pos] << 8) | data[pos + 1]);
+        pos += 2;
+        return value;
+    };
+    auto readVarLen = [&]() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            need(1);
+            const uint8_t byte = data[pos++];
+            value = (value << 7) | (byte & 0x7f);
+            if (!(byte & 0x80))
+                return value;
+        }
+        fail("bad variable-length quantity");
+        return value;
+    };
+
+    need(4);
+    if (std::string(data.begin(), data.begin() + 4) != "MThd")
+        fail("missing MThd header");
+    pos += 4;
+    const uint32_t headerLength = readU32();
+    const size_t headerEnd = pos + headerLength;
+    const uint16_t format = readU16();
+    const uint16_t numTracks = readU16();
+    const uint16_t division = readU16();
+    if (format > 1)
+        fail("only formats 0 and 1 are supported");
+    pos = headerEnd;
+
+    struct RawEvent {
+        uint64_t tick;
+        EventType type;
+        int data1;
+        int data2;
+    };
+    struct Tempo {
+        uint64_t tick;
+        uint32_t microsPerQuarter;
+    };
+    std::vector<RawEvent> raw;
+    std::vector<Tempo> tempos;
+
+    for (uint16_t track = 0; track < numTracks; ++track) {
+        need(8);
+        const bool isTrack = std::string(data.begin() + pos, data.begin() + pos + 4) == "MTrk";
+        pos += 4;
+        const uint32_t length = readU32();
+        need(length);
+        const size_t trackEnd = pos + length;
+        if (!isTrack) {
+            pos = trackEnd;
+            continue;
+        }
+
+        uint64_t tick = 0;
+        uint8_t status = 0;
+        while (pos < trackEnd) {
+            tick += readVarLen();
+            need(1);
+
+            // Meta and system exclusive events leave the running status alone
+            if (data[pos] == 0xff) {
+                ++pos;
+                need(1);
+                const uint8_t type = data[pos++];
+                const uint32_t size = readVarLen();
+                need(size);
+                if (type == 0x51 && size == 3)
+                    tempos.push_back({ tick, (uint32_t(data[pos]) << 16) | (uint32_t(data[pos + 1]) << 8) | data[pos + 2] });
+                pos += size;
+                if (type == 0x2f)
+                    break;
+                continue;
+            }
+            if (data[pos] == 0xf0 || data[pos] == 0xf7) {
+                ++pos;
+                const uint32_t size = readVarLen();
+                need(size);
+                pos += size;
+                continue;
+            }
+
+            if (data[pos] & 0x80)
+                status = data[pos++];
+            else if (status == 0)
+                fail("running status without a status byte");
+
+            const uint8_t kind = status & 0xf0;
+            const size_t size = (kind == 0xc0 || kind == 0xd0) ? 1 : 2;
+            need(size);
+            const int data1 = data[pos];
+            const int data2 = (size == 2) ? data[pos + 1] : 0;
+            pos += size;
+            switch (kind) {
+            case 0x80: raw.push_back({ tick, EventType::note_off, data1, data2 }); break;
+            case 0x90:
+                raw.push_back({ tick, data2 > 0 ? EventType::note_on : EventType::note_off, data1, data2 });
+                break;
+            case 0xb0: raw.push_back({ tick, EventType::cc, data1, data2 }); break;
+            case 0xe0: raw.push_back({ tick, EventType::pitch_wheel, ((data2 << 7) | data1) - 8192, 0 }); break;
+            default: break;
+            }
+        }
+        pos = trackEnd;
+    }
+
+    // Tick to seconds, through the tempo map or the SMPTE rate
+    std::stable_sort(raw.begin(), raw.end(), [](const RawEvent& a, const RawEvent& b) { return a.tick < b.tick; });
+    std::stable_sort(tempos.begin(), tempos.end(), [](const Tempo& a, const Tempo& b) { return a.tick < b.tick; });
+
+    double secondsPerTick;
+    const bool smpte = (division & 0x8000) != 0;
+    if (smpte) {
+        const int framesPerSecond = -static_cast<int8_t>(division >> 8);
+        const int ticksPerFrame = division & 0xff;
+        if (framesPerSecond <= 0 || ticksPerFrame == 0)
+            fail("bad SMPTE division");
+        secondsPerTick = 1.0 / (framesPerSecond * ticksPerFrame);
+    } else {
+        if (division == 0)
+            fail("zero ticks per quarter note");
+        secondsPerTick = 500000e-6 / division;
+    }
+
+    MidiFile result;
+    result.events.reserve(raw.size());
+    size_t nextTempo = 0;
+    uint64_t lastTick = 0;
+    double seconds = 0.0;
+    for (const auto& event : raw) {
+        // Walk the tempo changes up to this event
+        while (!smpte && nextTempo < tempos.size() && tempos[nextTempo].tick <= event.tick) {
+            seconds += (tempos[nextTempo].tick - lastTick) * secondsPerTick;
+            lastTick = tempos[nextTempo].tick;
+            secondsPerTick = tempos[nextTempo].microsPerQuarter * 1e-6 / division;
+            ++nextTempo;
+        }
+        seconds += (event.tick - lastTick) * secondsPerTick;
+        lastTick = event.tick;
+        result.events.push_back({ static_cast<int64_t>(seconds * sampleRate), event.type, event.data1, event.data2 });
+        result.duration = seconds;
+    }
+    return result;
+}
+
+} // namespace pysfizz
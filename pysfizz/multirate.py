@@ -0,0 +1,86 @@
+from pathlib import Path
+
+from .packs import PACK_SUFFIXES
+from .synth import Synth
+
+# Convenience wrapper holding one Synth per sample rate, created on first
+# use and kept for the lifetime of the handle. Switching rates routes to the
+# matching Synth instead of calling set_sample_rate, so mixed-rate job
+# queues never pay for reconfiguring or reloading an engine more than once
+# per rate. No engine is loaded before a rate is asked for. Each Synth loads
+# the instrument on its own: nothing (regions, samples) is shared between
+# rates.
+class MultiRateSynth:
+    def __init__(self, block_size=1024, num_voices=None, sample_quality=None, oscillator_quality=None):
+        self.block_size = block_size
+        self.num_voices = num_voices
+        self.sample_quality = sample_quality
+        self.oscillator_quality = oscillator_quality
+        self.path = None
+        self._engines = {}
+
+    def load_sfz_file(self, path, quiet=True):
+        # reload every engine that already exists so they all play the same
+        # instrument; with none yet, only the file is checked here, and the
+        # first engine() call loads it
+        path = Path(path)
+        if not path.is_file():
+            raise FileNotFoundError(f"File not found: {path}")
+        if path.suffix.lower() not in (".sfz",) + PACK_SUFFIXES:
+            raise ValueError(f"File is not a SFZ file: {path}")
+        engines = self._engines
+        self._engines = {}
+        self.path = None
+        for sample_rate in engines:
+            if not self._create_engine(sample_rate, path, quiet):
+                self._engines = {}
+                return False
+        self.path = str(path)
+        return True
+
+    @property
+    def sample_rates(self):
+        return sorted(self._engines)
+
+    @property
+    def playable_keys(self):
+        # from an engine already loaded, else one loaded at 48000 Hz
+        if self.path is None:
+            raise ValueError("No SFZ file loaded")
+        if not self._engines:
+            return self.engine(48000).playable_keys
+        return next(iter(self._engines.values())).playable_keys
+
+    def engine(self, sample_rate):
+        if self.path is None:
+            raise ValueError("No SFZ file loaded")
+        synth = self._engines.get(sample_rate)
+        if synth is None:
+            if not self._create_engine(sample_rate, self.path, True):
+                raise RuntimeError(f"Failed to load {self.path} at {sample_rate} Hz")
+            synth = self._engines[sample_rate]
+        return synth
+
+    def release(self, sample_rate):
+        self._engines.pop(sample_rate, None)
+
+    def render_note(self, sample_rate, pitch, vel, note_on_dur, render_dur, **kwargs):
+        return self.engine(sample_rate).render_note(pitch, vel, note_on_dur, render_dur, **kwargs)
+
+    def render_events(self, sample_rate, events, render_dur, **kwargs):
+        return self.engine(sample_rate).render_events(events, render_dur, **kwargs)
+
+    def _create_engine(self, sample_rate, path, quiet):
+        if sample_rate <= 0:
+            raise ValueError("Sample rate must be positive")
+        synth = Synth(sample_rate=sample_rate, block_size=self.block_size)
+        if self.num_voices is not None:
+            synth.set_num_voices(self.num_voices)
+        if self.sample_quality is not None:
+            synth.set_sample_quality(self.sample_quality)
+        if self.oscillator_quality is not None:
+            synth.set_oscillator_quality(self.oscillator_quality)
+        if not synth.load_sfz_file(path, quiet=quiet):
+            return False
+        self._engines[sample_rate] = synth
+        return True
@@ -0,0 +1,288 @@
+import io
+import json
+import mmap
+import os
+import shutil
+import struct
+import tarfile
+import tempfile
+import zipfile
+from pathlib import Path, PurePosixPath
+
+from .shared_samples import _instrument_files, _key, shared_root
+
+try:
+    import fcntl
+except ImportError:
+    fcntl = None
+
+# Instruments shipped as a single uncompressed archive (tar, or zip with
+# stored members), for libraries of many small files on filesystems where
+# opening each one is slow. sfizz opens samples by path, so a pack is not
+# read in place: it is unpacked once per node into shared_root() (/dev/shm
+# on Linux; elsewhere a directory under the temporary directory, which is
+# usually on disk), with one open of the pack and its members copied
+# straight out of a memory map, and synths load the instrument from there.
+#
+#   pysfizz.pack_instrument("piano/piano.sfz", "piano.tar")
+#   synth.load_sfz_file("piano.tar")
+#
+# The unpacked copy is a second copy of the pack in memory. Synths hold a
+# lease on the copy they play (a shared flock on its .pack marker), and each
+# unpack collects the copies nobody holds whose pack changed or vanished,
+# then the least recently used ones beyond pack_budget(). Where flock is
+# missing, copies stay until remove_unpacked.
+
+_MARKER = ".pack"
+
+PACK_SUFFIXES = (".tar", ".zip")
+
+# Local file header of a zip member: signature and fields up to the name
+# and extra field lengths, which end it
+_ZIP_LOCAL_HEADER = struct.Struct("<IHHHHHIIIHH")
+
+
+def pack_instrument(path, pack_path=None):
+    """Write an instrument (SFZ file, includes and samples) to an uncompressed tar.
+
+    The pack defaults to the SFZ path with a .tar suffix. It names the SFZ
+    file it was made from, so that load_sfz_file can take the pack itself.
+    """
+    sfz_path = Path(path).resolve()
+    if not sfz_path.is_file():
+        raise FileNotFoundError(f"File not found: {sfz_path}")
+    pack_path = Path(pack_path) if pack_path is not None else sfz_path.with_suffix(".tar")
+    files = sorted(_instrument_files(sfz_path))
+    base = Path(os.path.commonpath([str(f.parent) for f in files]))
+
+    staging = pack_path.with_name(f".{pack_path.name}.tmp{os.getpid()}")
+    try:
+        with tarfile.open(staging, "w:", format=tarfile.PAX_FORMAT) as tar:
+            marker = sfz_path.relative_to(base).as_posix().encode()
+            info = tarfile.TarInfo(".instrument")
+            info.size = len(marker)
+            tar.addfile(info, io.BytesIO(marker))
+            for file in files:
+                tar.add(file, arcname=file.relative_to(base).as_posix(), recursive=False)
+        os.replace(staging, pack_path)
+    finally:
+        if staging.exists():
+            staging.unlink()
+    return str(pack_path)
+
+
+def _member_name(name):
+    # refuse member names that would leave the unpacked directory
+    member = PurePosixPath(name)
+    if member.is_absolute() or ".." in member.parts:
+        raise ValueError(f"Unsafe member name in pack: {name}")
+    return member
+
+
+def _member_path(directory, name):
+    dest = directory / _member_name(name)
+    dest.parent.mkdir(parents=True, exist_ok=True)
+    return dest
+
+
+def _extract(pack, directory):
+    if pack.stat().st_size == 0:
+        raise ValueError(f"Not a tar or zip archive: {pack}")
+    with open(pack, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as data, memoryview(data) as view:
+        if zipfile.is_zipfile(f):
+            with zipfile.ZipFile(f) as archive:
+                for info in archive.infolist():
+                    if info.is_dir():
+                        continue
+                    dest = _member_path(directory, info.filename)
+                    if info.compress_type != zipfile.ZIP_STORED:
+                        with archive.open(info) as src, open(dest, "wb") as dst:
+                            shutil.copyfileobj(src, dst)
+                        continue
+                    header = _ZIP_LOCAL_HEADER.unpack_from(view, info.header_offset)
+                    start = info.header_offset + _ZIP_LOCAL_HEADER.size + header[9] + header[10]
+                    with open(dest, "wb") as dst:
+                        dst.write(view[start:start + info.file_size])
+            return
+        f.seek(0)
+        try:
+            # "r:" only: member offsets in a compressed tar are not file offsets
+            archive = tarfile.open(fileobj=f, mode="r:")
+        except tarfile.ReadError:
+            raise ValueError(f"Not an uncompressed tar or zip archive: {pack}") from None
+        with archive:
+            for member in archive:
+                if not member.isfile():
+                    continue  # directories are made on the way, links are skipped
+                dest = _member_path(directory, member.name)
+                with open(dest, "wb") as dst:
+                    dst.write(view[member.offset_data:member.offset_data + member.size])
+
+
+def pack_budget(root=None):
+    # bytes of unpacked copies kept in root: PYSFIZZ_PACK_BUDGET, else half
+    # the size of the filesystem holding it
+    budget = os.environ.get("PYSFIZZ_PACK_BUDGET")
+    if budget:
+        return int(budget)
+    root = Path(root) if root is not None else shared_root()
+    root.mkdir(parents=True, exist_ok=True)
+    stat = os.statvfs(root) if hasattr(os, "statvfs") else None
+    return stat.f_blocks * stat.f_frsize // 2 if stat else None
+
+
+def _lease(directory):
+    # Shared lock on the marker of an unpacked copy, held by the synths
+    # playing it so that no collection removes it from under them. Returns
+    # None when the copy was removed meanwhile.
+    try:
+        f = open(directory / _MARKER, "rb")
+    except FileNotFoundError:
+        return None
+    if fcntl is not None:
+        fcntl.flock(f, fcntl.LOCK_SH)
+        try:
+            # a collection may have moved the copy away while we waited
+            if not os.path.samestat(os.fstat(f.fileno()), os.stat(directory / _MARKER)):
+                raise FileNotFoundError
+        except FileNotFoundError:
+            f.close()
+            return None
+    try:
+        os.utime(directory / _MARKER)  # last use, for the budget
+    except PermissionError:
+        pass  # unpacked by another user
+    return f
+
+
+def _remove(directory):
+    # move aside first, so that no process finds a half-removed copy
+    trash = directory.with_name(f".{directory.name}.removed{os.getpid()}")
+    try:
+        os.rename(directory, trash)
+    except OSError:
+        return
+    shutil.rmtree(trash, ignore_errors=True)
+
+
+def _collect(root, keep):
+    # Remove the unpacked copies nobody plays whose pack is gone or changed,
+    # then the least recently used ones while the copies exceed the budget.
+    # Copies leased by a synth, in this process or another, are left alone.
+    if fcntl is None:
+        return  # no leases to tell copies in use: remove_unpacked only
+    copies = []
+    for directory in root.iterdir():
+        marker = directory / _MARKER
+        try:
+            pack, size = json.loads(marker.read_text())
+            stat = marker.stat()
+        except (OSError, ValueError):
+            continue  # not an unpacked pack, or being removed
+        try:
+            current = directory.name == _key(Path(pack))
+        except OSError:
+            current = False
+        copies.append((stat.st_mtime_ns, directory, size, current))
+
+    budget = pack_budget(root)
+    total = sum(size for _, _, size, _ in copies)
+    # stale copies first, then the oldest
+    for _, directory, size, current in sorted(copies, key=lambda c: (c[3], c[0])):
+        if directory == keep or (current and (budget is None or total <= budget)):
+            continue
+        try:
+            f = open(directory / _MARKER, "rb")
+        except OSError:
+            continue  # removed meanwhile
+        with f:
+            try:
+                fcntl.flock(f, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            except OSError:
+                continue  # leased
+            _remove(directory)
+        total -= size
+
+
+def _unpack(pack, root):
+    # unpacked copy of a pack and a lease on it
+    final = root / _key(pack)
+    while True:
+        if not final.exists():
+            root.mkdir(parents=True, exist_ok=True)
+            staging = Path(tempfile.mkdtemp(prefix=f".{final.name}.", dir=root))
+            try:
+                os.chmod(staging, 0o755)
+                _extract(pack, staging)
+                size = sum(f.stat().st_size for f in staging.rglob("*") if f.is_file())
+                (staging / _MARKER).write_text(json.dumps([str(pack), size]))
+                try:
+                    # atomic publish; losing a race to another process is fine
+                    os.rename(staging, final)
+                except OSError:
+                    if not final.exists():
+                        raise
+            finally:
+                if staging.exists():
+                    shutil.rmtree(staging)
+        lease = _lease(final)
+        if lease is not None:
+            _collect(root, final)
+            return final, lease
+
+
+def lease_size(lease):
+    # bytes of the unpacked copy a lease holds, as recorded when unpacking
+    return json.loads(Path(lease.name).read_text())[1]
+
+
+def _instrument_member(pack, directory, member):
+    if member is None:
+        marker = directory / ".instrument"
+        if marker.is_file():
+            member = marker.read_text()
+        else:
+            candidates = sorted(p.relative_to(directory).as_posix() for p in directory.rglob("*.sfz"))
+            if len(candidates) != 1:
+                raise ValueError(f"Pack {pack} has {len(candidates)} SFZ files: pass the member to load")
+            member = candidates[0]
+    sfz_path = directory / _member_name(member)
+    if not sfz_path.is_file():
+        raise FileNotFoundError(f"No {member} in pack {pack}")
+    return sfz_path
+
+
+def open_instrument(path, member=None, root=None):
+    # SFZ path of an unpacked pack and the lease that keeps the copy from
+    # being collected, to close once the instrument is no longer played
+    pack = Path(path).resolve()
+    if not pack.is_file():
+        raise FileNotFoundError(f"File not found: {pack}")
+    root = Path(root) if root is not None else shared_root()
+    directory, lease = _unpack(pack, root)
+    try:
+        return str(_instrument_member(pack, directory, member)), lease
+    except BaseException:
+        lease.close()
+        raise
+
+
+def unpack_instrument(path, member=None, root=None):
+    """Return the path of an SFZ file of a pack unpacked in shared memory, unpacking it if needed.
+
+    member is the SFZ file within the pack; by default the one the pack was
+    made from, or its only SFZ file. The copy is keyed by the pack path, size
+    and modification time, and any number of processes may call this at once.
+    The copy is not leased: a later unpack may collect it once no synth
+    plays it (see open_instrument).
+    """
+    sfz_path, lease = open_instrument(path, member, root)
+    lease.close()
+    return sfz_path
+
+
+def remove_unpacked(path, root=None):
+    # remove the unpacked copy of a pack, once no synth plays it anymore
+    pack = Path(path).resolve()
+    root = Path(root) if root is not None else shared_root()
+    _remove(root / _key(pack))
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace pysfizz {
+
+// Progress of native renders and loads. The counters are relaxed atomics
+// updated by the threads doing the work, so any other thread can read them
+// at any time without locking; they only ever describe a recent state.
+// One object may follow several renders at once: totals then add up.
+class Progress {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(const Progress&)>;
+
+    Progress() = default;
+    Progress(const Progress&) = delete;
+    Progress& operator=(const Progress&) = delete;
+
+    // Output frames written, and those of every render started
+    int64_t framesDone() const { return framesDone_.load(std::memory_order_relaxed); }
+    int64_t framesTotal() const { return framesTotal_.load(std::memory_order_relaxed); }
+    // Renders (or batch jobs) completed, and started
+    int64_t jobsDone() const { return jobsDone_.load(std::memory_order_relaxed); }
+    int64_t jobsTotal() const { return jobsTotal_.load(std::memory_order_relaxed); }
+    // Sample data of the instruments loaded, in bytes on disk
+    int64_t bytesLoaded() const { return bytesLoaded_.load(std::memory_order_relaxed); }
+
+    // Frames done over frames total, 0 before any render starts
+    double fraction() const {
+        const int64_t total = framesTotal();
+        return total > 0 ? static_cast<double>(framesDone()) / static_cast<double>(total) : 0.0;
+    }
+
+    void addFrames(int64_t frames) {
+        framesDone_.fetch_add(frames, std::memory_order_relaxed);
+        notify();
+    }
+    void addFramesTotal(int64_t frames) { framesTotal_.fetch_add(frames, std::memory_order_relaxed); }
+    void addJobsTotal(int64_t jobs) { jobsTotal_.fetch_add(jobs, std::memory_order_relaxed); }
+    void jobDone() {
+        jobsDone_.fetch_add(1, std::memory_order_relaxed);
+        notify();
+    }
+    void addBytesLoaded(int64_t bytes) {
+        bytesLoaded_.fetch_add(bytes, std::memory_order_relaxed);
+        notify();
+    }
+
+    void reset() {
+        framesDone_.store(0);
+        framesTotal_.store(0);
+        jobsDone_.store(0);
+        jobsTotal_.store(0);
+        bytesLoaded_.store(0);
+    }
+
+    // Callback run by the updates at most once per interval, on whichever
+    // thread makes the update; set it before the work starts
+    void setCallback(Callback callback, Clock::duration interval) {
+        callback_ = std::move(callback);
+        interval_ = interval.count();
+    }
+
+    // Run the callback if it is due, or right away when forced (e.g. once
+    // the work is over, so that it sees the final counts)
+    void notify(bool force = false) {
+        if (!callback_)
+            return;
+        const Clock::rep now = Clock::now().time_since_epoch().count();
+        Clock::rep due = nextDue_.load(std::memory_order_relaxed);
+        if (force) {
+            nextDue_.store(now + interval_);
+        } else if (now < due || !nextDue_.compare_exchange_strong(due, now + interval_)) {
+            return;  // not due, or another thread reports
+        }
+        callback_(*this);
+    }
+
+private:
+    std::atomic<int64_t> framesDone_ { 0 };
+    std::atomic<int64_t> framesTotal_ { 0 };
+    std::atomic<int64_t> jobsDone_ { 0 };
+    std::atomic<int64_t> jobsTotal_ { 0 };
+    std::atomic<int64_t> bytesLoaded_ { 0 };
+
+    Callback callback_;
+    Clock::rep interval_ = 0;
+    std::atomic<Clock::rep> nextDue_ { 0 };
+};
+
+} // namespace pysfizz
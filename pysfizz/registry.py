@@ -0,0 +1,199 @@
+import os
+import threading
+import time
+from collections import OrderedDict
+from contextlib import contextmanager
+from pathlib import Path
+
+from .synth import Synth
+
+# Process-wide cache of loaded instruments, for workers cycling through many
+# of them. sfizz keeps an instrument inside the synth that loaded it, so the
+# registry keeps loaded synths: borrow() hands one out for exclusive use and
+# takes it back afterwards, loading the instrument only when no idle synth
+# already plays it. Once the synths take more than the byte budget, idle
+# ones are dropped, least recently used first; synths in use are never
+# dropped but count toward the budget.
+#
+#   registry = pysfizz.instrument_registry()
+#   with registry.borrow("piano.sfz", sample_rate=44100) as synth:
+#       audio = synth.render_note(60, 100, 1.0, 2.0)
+
+# budget of the process-wide registry, overridden by PYSFIZZ_REGISTRY_BUDGET (bytes)
+DEFAULT_BUDGET = 2 << 30
+
+
+def _config(synth):
+    # what a borrower may have changed that makes a synth differ from a fresh
+    # load under its key
+    return (synth.get_sample_rate(), synth.get_block_size(), synth.get_num_voices(),
+            synth.get_sample_quality(), synth.get_oscillator_quality(), synth.get_preload_size(),
+            synth._synth.is_freewheeling())
+
+
+class _Instrument:
+    # counters of one instrument (path, sample rate, block size, streaming)
+    def __init__(self, key):
+        self.key = key
+        self.mtime = None
+        self.loads = 0
+        self.hits = 0
+        self.in_use = 0
+        self.last_used = 0.0
+
+
+class InstrumentRegistry:
+    def __init__(self, budget=DEFAULT_BUDGET):
+        if budget < 0:
+            raise ValueError("budget must be non-negative")
+        self.budget = budget
+        self._instruments = {}
+        # idle synths, least recently used first: id(synth) -> (key, synth)
+        self._idle = OrderedDict()
+        # every synth held, idle or in use: id(synth) -> (key, bytes)
+        self._held = {}
+        self._lock = threading.Lock()
+        # loads are serialized: load_sfz_file redirects the process stderr
+        self._load_lock = threading.Lock()
+
+    @contextmanager
+    def borrow(self, path, sample_rate=48000, block_size=1024, streaming=False):
+        # a synth playing the instrument, for the calling thread only until the
+        # block exits; it comes with the controllers reset and all sound off
+        synth = self.acquire(path, sample_rate, block_size, streaming)
+        try:
+            yield synth
+        finally:
+            self.release(synth)
+
+    def acquire(self, path, sample_rate=48000, block_size=1024, streaming=False):
+        # as borrow(), pairing with release(synth)
+        path = Path(path).resolve()
+        if not path.is_file():
+            raise FileNotFoundError(f"File not found: {path}")
+        key = (str(path), int(sample_rate), int(block_size), bool(streaming))
+        mtime = path.stat().st_mtime_ns
+
+        with self._lock:
+            instrument = self._instruments.get(key)
+            if instrument is None:
+                instrument = self._instruments[key] = _Instrument(key)
+            if instrument.mtime != mtime:
+                # the SFZ file (or pack) changed: its loaded copies are stale
+                self._drop(lambda k: k == key)
+                instrument.mtime = mtime
+            instrument.in_use += 1
+            instrument.last_used = time.monotonic()
+            for synth_id, (idle_key, synth) in reversed(list(self._idle.items())):
+                if idle_key != key:
+                    continue
+                del self._idle[synth_id]
+                if synth._synth.files_changed():
+                    # an include or a sample changed since this copy was loaded
+                    del self._held[synth_id]
+                    continue
+                instrument.hits += 1
+                return synth
+
+        try:
+            synth = Synth(sample_rate=sample_rate, block_size=block_size)
+            with self._load_lock:
+                loaded = synth.load_sfz_file(path, streaming=streaming)
+            if not loaded:
+                raise RuntimeError(f"Failed to load {path}")
+        except BaseException:
+            with self._lock:
+                instrument.in_use -= 1
+            raise
+        synth._registry_key = key
+        synth._registry_mtime = mtime
+        synth._registry_source = synth._source
+        synth._registry_config = _config(synth)
+        with self._lock:
+            instrument.loads += 1
+            self._held[id(synth)] = (key, synth.get_sample_memory())
+            self._evict()
+        return synth
+
+    def release(self, synth):
+        synth._synth.all_sound_off()
+        synth._synth.reset_all_controllers()
+        with self._lock:
+            key = synth._registry_key
+            instrument = self._instruments[key]
+            instrument.in_use -= 1
+            instrument.last_used = time.monotonic()
+            if (synth._source is not synth._registry_source or synth._registry_mtime != instrument.mtime
+                    or _config(synth) != synth._registry_config or synth._synth.files_changed()):
+                # loaded with something else meanwhile, reconfigured, stale or cleared
+                self._held.pop(id(synth), None)
+                return
+            self._idle[id(synth)] = (key, synth)
+            self._evict()
+
+    def clear(self):
+        # drop every idle synth; synths in use are dropped when released
+        with self._lock:
+            self._drop(lambda key: True)
+            for instrument in self._instruments.values():
+                instrument.mtime = None
+
+    def memory(self):
+        # bytes of sample data held by the registry's synths, idle or in use
+        with self._lock:
+            return sum(nbytes for _, nbytes in self._held.values())
+
+    def report(self):
+        # one entry per instrument the registry holds or has held,
+        # most recently used first
+        with self._lock:
+            held = {}
+            for key, nbytes in self._held.values():
+                count, total = held.get(key, (0, 0))
+                held[key] = (count + 1, total + nbytes)
+            idle = {}
+            for key, _ in self._idle.values():
+                idle[key] = idle.get(key, 0) + 1
+            entries = []
+            for key, instrument in self._instruments.items():
+                synths, nbytes = held.get(key, (0, 0))
+                entries.append({
+                    "path": key[0],
+                    "sample_rate": key[1],
+                    "block_size": key[2],
+                    "streaming": key[3],
+                    "synths": synths,
+                    "idle": idle.get(key, 0),
+                    "in_use": instrument.in_use,
+                    "bytes": nbytes,
+                    "loads": instrument.loads,
+                    "hits": instrument.hits,
+                    "last_used": instrument.last_used,
+                })
+        entries.sort(key=lambda entry: entry["last_used"], reverse=True)
+        return entries
+
+    def _drop(self, match):
+        for synth_id, (key, _) in list(self._idle.items()):
+            if match(key):
+                del self._idle[synth_id]
+                del self._held[synth_id]
+
+    def _evict(self):
+        total = sum(nbytes for _, nbytes in self._held.values())
+        while total > self.budget and self._idle:
+            synth_id, _ = self._idle.popitem(last=False)
+            total -= self._held.pop(synth_id)[1]
+
+
+_registry = None
+_registry_lock = threading.Lock()
+
+
+def instrument_registry():
+    # the process-wide registry, created on first use
+    global _registry
+    with _registry_lock:
+        if _registry is None:
+            _registry = InstrumentRegistry(int(os.environ.get("PYSFIZZ_REGISTRY_BUDGET", DEFAULT_BUDGET)))
+        return _registry
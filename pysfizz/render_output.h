@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cancel.h"
+#include "kernels.h"
+#include "progress.h"
+#include "render_stats.h"
+#include "resampler.h"
+
+namespace pysfizz {
+
+// Channel layout of a native render output
+enum class ChannelLayout {
+    stereo,    // left, right
+    mono,      // (left + right) / 2
+    mid_side,  // (left + right) / 2, (left - right) / 2
+    left,      // left channel only
+};
+
+inline ChannelLayout parseChannelLayout(const std::string& name) {
+    if (name == "stereo")
+        return ChannelLayout::stereo;
+    if (name == "mono")
+        return ChannelLayout::mono;
+    if (name == "mid_side")
+        return ChannelLayout::mid_side;
+    if (name == "left")
+        return ChannelLayout::left;
+    throw std::invalid_argument("Channel layout must be 'stereo', 'mono', 'mid_side' or 'left'");
+}
+
+inline size_t numChannelsFor(ChannelLayout layout) {
+    return (layout == ChannelLayout::mono || layout == ChannelLayout::left) ? 1 : 2;
+}
+
+// Options shared by the native render methods
+struct RenderOptions {
+    // Output channel layout, see parseChannelLayout()
+    std::string channels = "stereo";
+
+    // Rate of the returned audio; 0 delivers the synth's own sample rate,
+    // anything else goes through the streaming resampler
+    int outputSampleRate = 0;
+    // Resampler preset, see parseResampleQuality()
+    std::string resampleQuality = "medium";
+
+    // Accumulate peak/RMS/loudness statistics while rendering
+    bool stats = false;
+
+    // In-place normalization applied before returning:
+    // "" (none), "peak" (target in dBFS) or "loudness" (target in LUFS)
+    std::string normalize;
+    double target = 0.0;
+
+    // Event renders only: split the timeline at silent points into at most
+    // this many slices rendered concurrently (1 renders serially), keeping
+    // sliceMargin seconds after the predicted end of every tail
+    int timeSlices = 1;
+    double sliceMargin = 0.5;
+
+    // Stop request polled at block boundaries, not owned. A stopped render
+    // throws RenderCancelled, or with partialOnCancel returns the frames
+    // rendered so far, unnormalized; interruptions always throw.
+    CancelToken* cancel = nullptr;
+    bool partialOnCancel = false;
+
+    // Counters updated as the output fills up, not owned
+    Progress* progress = nullptr;
+};
+
+inline void checkRenderOptions(const RenderOptions& options) {
+    if (!options.normalize.empty() && options.normalize != "peak" && options.normalize != "loudness")
+        throw std::invalid_argument("Normalization must be 'peak' or 'loudness'");
+    if (options.outputSampleRate < 0)
+        throw std::invalid_argument("Output sample rate must be positive");
+}
+
+// Throw RenderCancelled if the render of these options must stop
+inline void checkCancelled(const RenderOptions& options) {
+    if (options.cancel)
+        options.cancel->check();
+}
+
+// Sample rate of the audio delivered for a synth running at sampleRate
+inline int outputSampleRate(const RenderOptions& options, int sampleRate) {
+    return options.outputSampleRate > 0 ? options.outputSampleRate : sampleRate;
+}
+
+// Planar float output of a native render, filled one block at a time.
+// The buffer is laid out as (channels, frames), C-contiguous, so it can be
+// handed over to NumPy without a copy. The channel layout conversion is
+// done while copying each block out, so a mono output is never stored
+// as stereo first; resampling, when requested, runs on the converted
+// channels right after.
+class RenderOutput {
+public:
+    // numFrames is counted at the output sample rate
+    RenderOutput(size_t numFrames, int sampleRate, const RenderOptions& options)
+        : RenderOutput(numFrames, sampleRate, options, nullptr) {}
+
+    // Render into caller-owned memory of numChannelsFor(layout) * numFrames
+    // floats, which must outlive this object; nullptr allocates a buffer
+    RenderOutput(size_t numFrames, int sampleRate, const RenderOptions& options, float* buffer)
+        : layout_(parseChannelLayout(options.channels)),
+          numChannels_(numChannelsFor(layout_)), numFrames_(numFrames), progress_(options.progress) {
+        if (buffer) {
+            std::fill_n(buffer, numChannels_ * numFrames, 0.0f);
+            data_ = buffer;
+        } else {
+            owned_.reset(new float[numChannels_ * numFrames]());
+            data_ = owned_.get();
+        }
+        const int outputRate = outputSampleRate(options, sampleRate);
+        if (outputRate != sampleRate) {
+            resampler_.reset(new Resampler(sampleRate, outputRate, numChannels_,
+                parseResampleQuality(options.resampleQuality)));
+            scratch_.resize(numChannels_);
+        }
+        if (options.stats || !options.normalize.empty())
+            stats_.reset(new RenderStats(outputRate, static_cast<int>(numChannels_)));
+        if (progress_)
+            progress_->addFramesTotal(static_cast<int64_t>(numFrames));
+    }
+
+    size_t numChannels() const { return numChannels_; }
+    size_t numFrames() const { return numFrames_; }
+    size_t framesWritten() const { return position_; }
+    bool full() const { return position_ >= numFrames_; }
+
+    float* channel(size_t index) { return data_ + index * numFrames_; }
+
+    // Copy out one stereo block rendered by sfizz, truncated to the space left
+    void write(const float* left, const float* right, size_t frames) {
+        if (full())
+            return;
+
+        float* dest[2] = { channel(0) + position_, nullptr };
+        if (numChannels_ > 1)
+            dest[1] = channel(1) + position_;
+
+        size_t written;
+        if (!resampler_) {
+            written = std::min(frames, numFrames_ - position_);
+            convertLayout(dest, left, right, written);
+        } else {
+            float* converted[2] = { nullptr, nullptr };
+            for (size_t c = 0; c < numChannels_; ++c) {
+                scratch_[c].resize(frames);
+                converted[c] = scratch_[c].data();
+            }
+            convertLayout(converted, left, right, frames);
+            written = resampler_->process(converted, frames, dest, numFrames_ - position_);
+        }
+
+        if (stats_ && written > 0)
+            stats_->process(dest, written);
+        position_ += written;
+        if (progress_) {
+            const size_t ahead = std::min(written, reportedAhead_);
+            reportedAhead_ -= ahead;
+            if (written > ahead)
+                progress_->addFrames(static_cast<int64_t>(written - ahead));
+        }
+    }
+
+    // Frames already reported to the progress by the caller, e.g. while
+    // rendering ahead of the output; the writes that follow leave them out
+    void reportedAhead(size_t frames) { reportedAhead_ += frames; }
+
+    // Scale the whole output so that its peak or integrated loudness hits
+    // the target. Returns the applied gain in dB (0 when the output is silent).
+    double normalize(const std::string& mode, double target) {
+        if (mode.empty() || !stats_)
+            return gainDb_;
+
+        double measured;
+        if (mode == "peak")
+            measured = RenderStats::toDecibels(stats_->peak());
+        else if (mode == "loudness")
+            measured = stats_->integratedLoudness();
+        else
+            throw std::invalid_argument("Unknown normalization mode: " + mode);
+
+        if (!std::isfinite(measured))
+            return gainDb_;
+
+        gainDb_ = target - measured;
+        kernels::applyGain(data_, numChannels_ * numFrames_,
+            static_cast<float>(std::pow(10.0, gainDb_ / 20.0)));
+        return gainDb_;
+    }
+
+    // Keep only the frames written so far, after a stopped render. Owned
+    // buffers are compacted so that the channels stay contiguous; caller
+    // memory keeps its layout, silent past the written frames.
+    void truncate() {
+        if (!owned_ || position_ >= numFrames_)
+            return;
+        for (size_t c = 1; c < numChannels_; ++c)
+            std::memmove(data_ + c * position_, data_ + c * numFrames_, position_ * sizeof(float));
+        numFrames_ = position_;
+    }
+
+    // Gain applied by the last normalize() in dB, 0 if none
+    double gainDb() const { return gainDb_; }
+
+    const RenderStats* stats() const { return stats_.get(); }
+
+    // Give up ownership of the sample buffer (nullptr for caller-owned memory)
+    float* release() { return owned_.release(); }
+
+private:
+    void convertLayout(float* const* dest, const float* left, const float* right, size_t frames) {
+        switch (layout_) {
+        case ChannelLayout::stereo:
+            std::memcpy(dest[0], left, frames * sizeof(float));
+            std::memcpy(dest[1], right, frames * sizeof(float));
+            break;
+        case ChannelLayout::mono:
+            kernels::downmixMono(dest[0], left, right, frames);
+            break;
+        case ChannelLayout::mid_side:
+            kernels::encodeMidSide(dest[0], dest[1], left, right, frames);
+            break;
+        case ChannelLayout::left:
+            std::memcpy(dest[0], left, frames * sizeof(float));
+            break;
+        }
+    }
+
+    ChannelLayout layout_;
+    size_t numChannels_;
+    size_t numFrames_;
+    size_t position_ = 0;
+    size_t reportedAhead_ = 0;
+    double gainDb_ = 0.0;
+    float* data_ = nullptr;
+    std::unique_ptr<float[]> owned_;
+    std::unique_ptr<Resampler> resampler_;
+    std::vector<std::vector<float>> scratch_;
+    std::unique_ptr<RenderStats> stats_;
+    Progress* progress_;
+};
+
+} // namespace pysfizz
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "kernels.h"
+
+namespace pysfizz {
+
+// EBU R128 / ITU-R BS.1770-4 integrated loudness, computed block-by-block.
+// K-weighting is a high shelf followed by a high pass, designed for the
+// actual sample rate (same coefficient formulas as libebur128).
+// Energies are collected per 100 ms step; gating blocks are 4 steps (400 ms,
+// 75% overlap) and are only evaluated when the integrated value is queried.
+class LoudnessMeter {
+public:
+    LoudnessMeter(int sampleRate, int numChannels)
+        : stepFrames_(static_cast<size_t>(sampleRate / 10)),
+          filters_(static_cast<size_t>(numChannels)) {
+        const double pi = 3.14159265358979323846;
+
+        // Stage 1: high shelf (+4 dB above ~1.7 kHz)
+        {
+            const double f0 = 1681.974450955533;
+            const double G = 3.999843853973347;
+            const double Q = 0.7071752369554196;
+            const double K = std::tan(pi * f0 / sampleRate);
+            const double Vh = std::pow(10.0, G / 20.0);
+            const double Vb = std::pow(Vh, 0.4996667741545416);
+            const double a0 = 1.0 + K / Q + K * K;
+            shelf_ = {
+                (Vh + Vb * K / Q + K * K) / a0,
+                2.0 * (K * K - Vh) / a0,
+                (Vh - Vb * K / Q + K * K) / a0,
+                2.0 * (K * K - 1.0) / a0,
+                (1.0 - K / Q + K * K) / a0,
+            };
+        }
+
+        // Stage 2: high pass (RLB weighting, ~38 Hz)
+        {
+            const double f0 = 38.13547087602444;
+            const double Q = 0.5003270373238773;
+            const double K = std::tan(pi * f0 / sampleRate);
+            const double a0 = 1.0 + K / Q + K * K;
+            highpass_ = {
+                1.0,
+                -2.0,
+                1.0,
+                2.0 * (K * K - 1.0) / a0,
+                (1.0 - K / Q + K * K) / a0,
+            };
+        }
+
+        if (stepFrames_ == 0)
+            stepFrames_ = 1;
+    }
+
+    // Feed one block of planar audio (one pointer per channel)
+    void process(const float* const* channels, size_t frames) {
+        size_t done = 0;
+        while (done < frames) {
+            const size_t chunk = std::min(frames - done, stepFrames_ - stepPosition_);
+            for (size_t c = 0; c < filters_.size(); ++c)
+                stepEnergy_ += filterAndSquare(filters_[c], channels[c] + done, chunk);
+
+            done += chunk;
+            stepPosition_ += chunk;
+            if (stepPosition_ == stepFrames_) {
+                steps_.push_back(stepEnergy_);
+                stepEnergy_ = 0.0;
+                stepPosition_ = 0;
+            }
+        }
+    }
+
+    // Gated integrated loudness in LUFS, -inf when nothing passes the gates
+    // or the audio is shorter than one 400 ms gating block
+    double integratedLoudness() const {
+        constexpr size_t stepsPerBlock = 4;
+        const double minusInf = -std::numeric_limits<double>::infinity();
+        if (steps_.size() < stepsPerBlock)
+            return minusInf;
+
+        const double blockFrames = static_cast<double>(stepsPerBlock * stepFrames_);
+        std::vector<double> blocks;
+        blocks.reserve(steps_.size() - stepsPerBlock + 1);
+        double windowSum = steps_[0] + steps_[1] + steps_[2];
+        for (size_t i = stepsPerBlock - 1; i < steps_.size(); ++i) {
+            windowSum += steps_[i];
+            blocks.push_back(windowSum / blockFrames);
+            windowSum -= steps_[i + 1 - stepsPerBlock];
+        }
+
+        // Absolute gate at -70 LUFS
+        const double absoluteGate = energyFromLoudness(-70.0);
+        double sum = 0.0;
+        size_t count = 0;
+        for (double energy : blocks) {
+            if (energy > absoluteGate) {
+                sum += energy;
+                ++count;
+            }
+        }
+        if (count == 0)
+            return minusInf;
+
+        // Relative gate at -10 LU below the absolute-gated loudness
+        const double relativeGate = (sum / count) * std::pow(10.0, -10.0 / 10.0);
+        const double gate = std::max(absoluteGate, relativeGate);
+        sum = 0.0;
+        count = 0;
+        for (double energy : blocks) {
+            if (energy > gate) {
+                sum += energy;
+                ++count;
+            }
+        }
+        if (count == 0)
+            return minusInf;
+
+        return loudnessFromEnergy(sum / count);
+    }
+
+    static double loudnessFromEnergy(double energy) {
+        return -0.691 + 10.0 * std::log10(energy);
+    }
+
+    static double energyFromLoudness(double loudness) {
+        return std::pow(10.0, (loudness + 0.691) / 10.0);
+    }
+
+private:
+    struct Coefficients {
+        double b0, b1, b2, a1, a2;
+    };
+
+    struct ChannelFilter {
+        // Direct form I state of both stages
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+        double z1 = 0.0, z2 = 0.0;
+    };
+
+    double filterAndSquare(ChannelFilter& f, const float* input, size_t size) const {
+        const Coefficients& s = shelf_;
+        const Coefficients& h = highpass_;
+        double energy = 0.0;
+        for (size_t i = 0; i < size; ++i) {
+            const double x = input[i];
+            const double y = s.b0 * x + s.b1 * f.x1 + s.b2 * f.x2 - s.a1 * f.y1 - s.a2 * f.y2;
+            // The high pass input is the shelf output, so its feed-forward
+            // history is y1/y2 of the first stage
+            const double z = h.b0 * y + h.b1 * f.y1 + h.b2 * f.y2 - h.a1 * f.z1 - h.a2 * f.z2;
+            f.x2 = f.x1;
+            f.x1 = x;
+            f.y2 = f.y1;
+            f.y1 = y;
+            f.z2 = f.z1;
+            f.z1 = z;
+            energy += z * z;
+        }
+        return energy;
+    }
+
+    size_t stepFrames_;
+    size_t stepPosition_ = 0;
+    double stepEnergy_ = 0.0;
+    Coefficients shelf_ {};
+    Coefficients highpass_ {};
+    std::vector<ChannelFilter> filters_;
+    std::vector<double> steps_;
+};
+
+// Peak, RMS and integrated loudness of everything written to an output,
+// accumulated one block at a time while rendering
+class RenderStats {
+public:
+    RenderStats(int sampleRate, int numChannels)
+        : channelPeaks_(static_cast<size_t>(numChannels), 0.0f),
+          channelSumSquares_(static_cast<size_t>(numChannels), 0.0),
+          loudness_(sampleRate, numChannels) {}
+
+    void process(const float* const* channels, size_t frames) {
+        for (size_t c = 0; c < channelPeaks_.size(); ++c) {
+            channelPeaks_[c] = std::max(channelPeaks_[c], kernels::peakAbs(channels[c], frames));
+            channelSumSquares_[c] += kernels::sumSquares(channels[c], frames);
+        }
+        loudness_.process(channels, frames);
+        numFrames_ += frames;
+    }
+
+    size_t numFrames() const { return numFrames_; }
+    size_t numChannels() const { return channelPeaks_.size(); }
+
+    float channelPeak(size_t channel) const { return channelPeaks_[channel]; }
+
+    double channelRms(size_t channel) const {
+        return numFrames_ > 0 ? std::sqrt(channelSumSquares_[channel] / numFrames_) : 0.0;
+    }
+
+    float peak() const {
+        float peak = 0.0f;
+        for (float p : channelPeaks_)
+            peak = std::max(peak, p);
+        return peak;
+    }
+
+    // RMS over all channels
+    double rms() const {
+        if (numFrames_ == 0 || channelSumSquares_.empty())
+            return 0.0;
+        double sum = 0.0;
+        for (double s : channelSumSquares_)
+            sum += s;
+        return std::sqrt(sum / (static_cast<double>(numFrames_) * channelSumSquares_.size()));
+    }
+
+    double integratedLoudness() const { return loudness_.integratedLoudness(); }
+
+    static double toDecibels(double linear) {
+        return linear > 0.0 ? 20.0 * std::log10(linear) : -std::numeric_limits<double>::infinity();
+    }
+
+private:
+    std::vector<float> channelPeaks_;
+    std::vector<double> channelSumSquares_;
+    LoudnessMeter loudness_;
+    size_t numFrames_ = 0;
+};
+
+} // namespace pysfizz
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "kernels.h"
+
+namespace pysfizz {
+
+// Quality presets of the output resampler
+enum class ResampleQuality {
+    fast,    // 16 taps per phase
+    medium,  // 32 taps per phase
+    best,    // 64 taps per phase
+};
+
+inline ResampleQuality parseResampleQuality(const std::string& name) {
+    if (name == "fast")
+        return ResampleQuality::fast;
+    if (name == "medium")
+        return ResampleQuality::medium;
+    if (name == "best")
+        return ResampleQuality::best;
+    throw std::invalid_argument("Resample quality must be 'fast', 'medium' or 'best'");
+}
+
+// Streaming rational-ratio polyphase resampler (planar, any channel count).
+// The prototype is a Kaiser-windowed sinc at the upsampled rate, split into
+// one short filter per phase. The filter delay is compensated, so output
+// frame k lines up with input time k * inputRate / outputRate; this needs
+// half a filter of input lookahead, which the caller provides by simply
+// feeding more input until enough output has been produced.
+//
+// When the reduced ratio needs more than maxExactPhases phases (coprime
+// rates such as 44100 -> 48001), the prototype is designed with
+// interpolatedPhases phases instead and the filter of each output is
+// interpolated linearly between the two nearest ones.
+// Designed filters are shared by every resampler with the same ratio and
+// quality, so a render does not design its filter again.
+class Resampler {
+public:
+    static constexpr size_t maxExactPhases = 1024;
+    static constexpr size_t interpolatedPhases = 512;
+
+    Resampler(int inputRate, int outputRate, size_t numChannels, ResampleQuality quality)
+        : buffers_(numChannels) {
+        if (inputRate <= 0 || outputRate <= 0)
+            throw std::invalid_argument("Sample rates must be positive");
+
+        const int divisor = std::gcd(inputRate, outputRate);
+        up_ = outputRate / divisor;
+        down_ = inputRate / divisor;
+
+        filter_ = designedFilter(up_, down_, quality);
+        taps_ = filter_->taps;
+
+        if (!filter_->interpolated) {
+            // Delay compensation: output time is offset by the prototype center
+            const int64_t center = (static_cast<int64_t>(taps_) * up_ - 1) / 2;
+            newest_ = center / up_;
+            phase_ = static_cast<size_t>(center % up_);
+        } else {
+            // The interpolated prototype is centered on an input frame
+            newest_ = static_cast<int64_t>(taps_ / 2);
+            phase_ = 0;
+            interpolatedCoefficients_.resize(taps_);
+        }
+
+        // Input history starts with taps_ - 1 zeros standing for negative time
+        for (auto& buffer : buffers_)
+            buffer.assign(taps_ - 1, 0.0f);
+        bufferStart_ = -static_cast<int64_t>(taps_ - 1);
+    }
+
+    // Push frames of input and write as many output frames as are ready,
+    // up to maxOutput. Returns the number of output frames written.
+    size_t process(const float* const* input, size_t frames, float* const* output, size_t maxOutput) {
+        for (size_t c = 0; c < buffers_.size(); ++c)
+            buffers_[c].insert(buffers_[c].end(), input[c], input[c] + frames);
+        const int64_t available = bufferStart_ + static_cast<int64_t>(buffers_[0].size());
+
+        size_t produced = 0;
+        while (produced < maxOutput && newest_ < available) {
+            const float* coeffs = filter_->interpolated ? interpolateCoefficients()
+                                                         : &filter_->coefficients[phase_ * taps_];
+            const size_t first = static_cast<size_t>(newest_ + 1 - static_cast<int64_t>(taps_) - bufferStart_);
+            for (size_t c = 0; c < buffers_.size(); ++c)
+                output[c][produced] = kernels::dot(coeffs, buffers_[c].data() + first, taps_);
+            ++produced;
+
+            phase_ += down_;
+            newest_ += static_cast<int64_t>(phase_ / up_);
+            phase_ %= up_;
+        }
+
+        // Drop the input that no future output can reach
+        const int64_t keepFrom = std::min(newest_ + 1 - static_cast<int64_t>(taps_), available);
+        if (keepFrom > bufferStart_) {
+            const auto drop = static_cast<std::ptrdiff_t>(keepFrom - bufferStart_);
+            for (auto& buffer : buffers_)
+                buffer.erase(buffer.begin(), buffer.begin() + drop);
+            bufferStart_ = keepFrom;
+        }
+
+        return produced;
+    }
+
+    size_t tapsPerPhase() const { return taps_; }
+    bool interpolated() const { return filter_->interpolated; }
+
+private:
+    // Prototype split into phases, each stored with its taps reversed so
+    // that an output is a forward dot product
+    struct Filter {
+        size_t taps = 32;
+        bool interpolated = false;
+        std::vector<float> coefficients;
+    };
+
+    static double besselI0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 50; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if (term < 1e-12 * sum)
+                break;
+        }
+        return sum;
+    }
+
+    // Filter for the ratio and quality, designed on first use and then
+    // shared; the cache is dropped when it grows past a few dozen ratios
+    static std::shared_ptr<const Filter> designedFilter(size_t up, size_t down, ResampleQuality quality) {
+        static std::mutex mutex;
+        static std::map<std::tuple<size_t, size_t, ResampleQuality>, std::shared_ptr<const Filter>> cache;
+        const auto key = std::make_tuple(up, down, quality);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto it = cache.find(key);
+            if (it != cache.end())
+                return it->second;
+        }
+        auto filter = designFilter(up, down, quality);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= 32)
+            cache.clear();
+        return cache.emplace(key, std::move(filter)).first->second;
+    }
+
+    // Kaiser-windowed sinc. Exact: at the upsampled rate, up phases.
+    // Interpolated: interpolatedPhases + 1 phases, the last one being the
+    // first one delayed by an input frame.
+    static std::shared_ptr<const Filter> designFilter(size_t up, size_t down, ResampleQuality quality) {
+        auto filter = std::make_shared<Filter>();
+        double rolloff, beta;
+        switch (quality) {
+        case ResampleQuality::fast: filter->taps = 16; rolloff = 0.85; beta = 6.0; break;
+        case ResampleQuality::best: filter->taps = 64; rolloff = 0.945; beta = 10.0; break;
+        case ResampleQuality::medium:
+        default: filter->taps = 32; rolloff = 0.91; beta = 8.0; break;
+        }
+        const size_t taps = filter->taps;
+        filter->interpolated = up > maxExactPhases;
+
+        const double pi = 3.14159265358979323846;
+        const size_t phases = filter->interpolated ? interpolatedPhases : up;
+        const size_t length = filter->interpolated ? taps * phases + 1 : taps * phases;
+        // Integer center, matching the delay compensation in the constructor
+        const double center = static_cast<double>(filter->interpolated ? taps * phases / 2 : (length - 1) / 2);
+        const double halfLength = filter->interpolated ? center : static_cast<double>(length) / 2.0;
+        // Relative to the prototype rate: input rate times the phases
+        const double cutoff = rolloff * 0.5 * std::min(1.0, static_cast<double>(up) / down) / phases;
+
+        std::vector<double> prototype(length);
+        double sum = 0.0;
+        for (size_t n = 0; n < length; ++n) {
+            const double t = static_cast<double>(n) - center;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = (t == 0.0) ? 1.0 : std::sin(pi * x) / (pi * x);
+            const double ratio = t / halfLength;
+            const double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+            prototype[n] = 2.0 * cutoff * sinc * window;
+            sum += prototype[n];
+        }
+
+        // Unity DC gain for every phase
+        const double gain = static_cast<double>(phases) / sum;
+        const size_t numPhases = filter->interpolated ? phases + 1 : phases;
+        filter->coefficients.resize(numPhases * taps);
+        for (size_t p = 0; p < numPhases; ++p) {
+            for (size_t j = 0; j < taps; ++j)
+                filter->coefficients[p * taps + (taps - 1 - j)] = static_cast<float>(prototype[p + j * phases] * gain);
+        }
+        return filter;
+    }
+
+    // Filter of the current phase, between the two nearest designed ones
+    const float* interpolateCoefficients() {
+        const uint64_t position = static_cast<uint64_t>(phase_) * interpolatedPhases;
+        const size_t index = static_cast<size_t>(position / up_);
+        const float fraction = static_cast<float>(position % up_) / static_cast<float>(up_);
+        const float* a = &filter_->coefficients[index * taps_];
+        const float* b = a + taps_;
+        for (size_t i = 0; i < taps_; ++i)
+            interpolatedCoefficients_[i] = a[i] + fraction * (b[i] - a[i]);
+        return interpolatedCoefficients_.data();
+    }
+
+    size_t up_ = 1;
+    size_t down_ = 1;
+    size_t taps_ = 32;
+    std::shared_ptr<const Filter> filter_;
+    std::vector<float> interpolatedCoefficients_;
+
+    // Position of the next output: newest input frame it needs, and phase
+    int64_t newest_ = 0;
+    size_t phase_ = 0;
+
+    std::vector<std::vector<float>> buffers_;
+    int64_t bufferStart_ = 0;
+};
+
+} // namespace pysfizz
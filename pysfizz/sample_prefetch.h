@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "thread_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+namespace pysfizz {
+
+// Sample files of an instrument, read ahead of its load by a pool of
+// threads so that sfizz, which decodes them one after the other, finds
+// them in the page cache instead of waiting on the disk for each one.
+// The scan below is a light pass over the SFZ text (#include, #define,
+// default_path and sample opcodes), not the sfizz parser: a file it misses
+// is simply not read ahead, and the load itself is unchanged.
+
+namespace detail {
+
+// Strip // and /* */ comments; inBlock carries a block comment across lines
+inline std::string stripComments(const std::string& line, bool& inBlock) {
+    std::string out;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (inBlock) {
+            if (line.compare(i, 2, "*/") == 0) {
+                inBlock = false;
+                ++i;
+            }
+        } else if (line.compare(i, 2, "/*") == 0) {
+            inBlock = true;
+            ++i;
+        } else if (line.compare(i, 2, "//") == 0) {
+            break;
+        } else {
+            out += line[i];
+        }
+    }
+    return out;
+}
+
+inline std::string expandDefines(std::string text, const std::map<std::string, std::string>& defines) {
+    // Reverse order takes $FOOBAR before $FOO, which would shadow it
+    for (auto it = defines.rbegin(); it != defines.rend(); ++it) {
+        for (size_t pos = 0; (pos = text.find(it->first, pos)) != std::string::npos; pos += it->second.size())
+            text.replace(pos, it->first.size(), it->second);
+    }
+    return text;
+}
+
+inline bool isOpcodeChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+// Opcode spans of a line: start of the name, position of '=' and end of
+// the value. A value runs until the next opcode or header, so that sample
+// paths may contain spaces
+struct OpcodeSpan {
+    size_t name;
+    size_t equals;
+    size_t valueEnd;
+};
+
+inline std::vector<OpcodeSpan> lineOpcodeSpans(const std::string& line) {
+    // Opcode names: runs of name characters before '=', starting the line
+    // or following a space or a header
+    std::vector<std::pair<size_t, size_t>> names;  // (start, position of '=')
+    for (size_t eq = line.find('='); eq != std::string::npos; eq = line.find('=', eq + 1)) {
+        size_t start = eq;
+        while (start > 0 && isOpcodeChar(line[start - 1]))
+            --start;
+        if (start < eq && (start == 0 || std::isspace(static_cast<unsigned char>(line[start - 1])) || line[start - 1] == '>'))
+            names.emplace_back(start, eq);
+    }
+
+    std::vector<OpcodeSpan> spans;
+    for (size_t k = 0; k < names.size(); ++k) {
+        const size_t valueStart = names[k].second + 1;
+        size_t valueEnd = k + 1 < names.size() ? names[k + 1].first : line.size();
+        valueEnd = std::min(valueEnd, line.find('<', valueStart));
+        while (valueEnd > valueStart && std::isspace(static_cast<unsigned char>(line[valueEnd - 1])))
+            --valueEnd;
+        spans.push_back({ names[k].first, names[k].second, valueEnd });
+    }
+    return spans;
+}
+
+// Opcodes of a line, as (name, value)
+inline std::vector<std::pair<std::string, std::string>> lineOpcodes(const std::string& line) {
+    std::vector<std::pair<std::string, std::string>> opcodes;
+    for (const auto& span : lineOpcodeSpans(line))
+        opcodes.emplace_back(line.substr(span.name, span.equals - span.name),
+                             line.substr(span.equals + 1, span.valueEnd - span.equals - 1));
+    return opcodes;
+}
+
+inline void scanSfz(const std::string& text, const std::filesystem::path& base,
+                    std::map<std::string, std::string>& defines, std::string& defaultPath,
+                    std::set<std::string>& samples, std::vector<std::string>* includes, int depth) {
+    std::istringstream in(text);
+    std::string raw;
+    bool inBlock = false;
+    while (std::getline(in, raw)) {
+        std::string line = stripComments(raw, inBlock);
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            continue;
+
+        if (line.compare(first, 7, "#define") == 0) {
+            std::istringstream define(line.substr(first + 7));
+            std::string name, value;
+            define >> name;
+            std::getline(define >> std::ws, value);
+            while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+                value.pop_back();
+            if (!name.empty() && name[0] == '$')
+                defines[name] = value;
+            continue;
+        }
+        line = expandDefines(line, defines);
+        if (line.compare(first, 8, "#include") == 0) {
+            const size_t open = line.find('"', first);
+            const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos || depth > 16)
+                continue;
+            const std::filesystem::path path = base / line.substr(open + 1, close - open - 1);
+            if (includes)
+                includes->push_back(path.string());
+            std::ifstream file(path, std::ios::binary);
+            if (file) {
+                std::ostringstream included;
+                included << file.rdbuf();
+                scanSfz(included.str(), base, defines, defaultPath, samples, includes, depth + 1);
+            }
+            continue;
+        }
+
+        for (const auto& opcode : lineOpcodes(line)) {
+            std::string value = opcode.second;
+            std::replace(value.begin(), value.end(), '\\', '/');
+            if (opcode.first == "default_path")
+                defaultPath = value;
+            else if (opcode.first == "sample" && !value.empty() && value[0] != '*')
+                samples.insert((base / (defaultPath + value)).lexically_normal().string());
+        }
+    }
+}
+
+} // namespace detail
+
+// Sample files named by SFZ text whose sample paths are relative to base.
+// The include files followed are appended to includes when given.
+inline std::vector<std::string> scanSampleFiles(const std::string& text, const std::filesystem::path& base,
+                                                std::vector<std::string>* includes = nullptr) {
+    std::map<std::string, std::string> defines;
+    std::string defaultPath;
+    std::set<std::string> samples;
+    detail::scanSfz(text, base, defines, defaultPath, samples, includes, 0);
+    return std::vector<std::string>(samples.begin(), samples.end());
+}
+
+// Read the first prefixBytes of each file (all of it when 0) on numThreads
+// threads. Files are taken in on-disk order where the platform tells it
+// (inode numbers), each thread reading its file from the start, so the
+// disk sees a few sequential streams rather than random seeks.
+inline void prefetchFiles(std::vector<std::string> files, size_t numThreads, size_t prefixBytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<std::pair<uint64_t, std::string>> byInode;
+    for (auto& file : files) {
+        struct stat info;
+        if (::stat(file.c_str(), &info) == 0)
+            byInode.emplace_back(static_cast<uint64_t>(info.st_ino), std::move(file));
+    }
+    std::sort(byInode.begin(), byInode.end());
+    files.clear();
+    for (auto& entry : byInode)
+        files.push_back(std::move(entry.second));
+#endif
+    if (files.empty())
+        return;
+
+    numThreads = std::max<size_t>(1, std::min(numThreads, files.size()));
+    // Each thread takes the next file in order; a read error only skips it
+    std::atomic<size_t> next { 0 };
+    auto read = [&](size_t) {
+        std::vector<char> buffer(1 << 20);
+        for (size_t i; (i = next.fetch_add(1)) < files.size();) {
+            std::ifstream in(files[i], std::ios::binary);
+            size_t remaining = prefixBytes > 0 ? prefixBytes : SIZE_MAX;
+            while (in && remaining > 0) {
+                in.read(buffer.data(), static_cast<std::streamsize>(std::min(buffer.size(), remaining)));
+                const size_t count = static_cast<size_t>(in.gcount());
+                if (count == 0)
+                    break;
+                remaining -= std::min(remaining, count);
+            }
+        }
+    };
+    if (numThreads == 1) {
+        read(0);
+        return;
+    }
+    ThreadPool pool(numThreads - 1);
+    pool.parallelFor(numThreads, read);
+}
+
+} // namespace pysfizz
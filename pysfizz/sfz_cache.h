@@ -0,0 +1,314 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "sample_prefetch.h"
+
+namespace pysfizz {
+
+// Compiled form of an SFZ file, for loads that skip resolving its includes:
+// the text with every #include inlined and comments dropped, as sfizz would
+// read it, and the files it was built from. #define lines are kept for the
+// sfizz parser to expand, so the loaded instrument is the same.
+struct CompiledSfz {
+    struct Dependency {
+        std::string path;
+        uint64_t size;   // kMissing when the file did not exist
+        int64_t mtime;
+        uint64_t hash;   // FNV-1a of the contents
+    };
+    static constexpr uint64_t kMissing = ~uint64_t(0);
+
+    std::string text;
+    std::vector<Dependency> dependencies;
+};
+
+namespace detail {
+
+inline uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline bool readWholeFile(const std::filesystem::path& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream data;
+    data << in.rdbuf();
+    contents = data.str();
+    return true;
+}
+
+inline int64_t fileMtime(const std::filesystem::path& path, std::error_code& error) {
+    return static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+}
+
+inline CompiledSfz::Dependency makeDependency(const std::filesystem::path& path, const std::string* contents) {
+    CompiledSfz::Dependency dependency { path.string(), CompiledSfz::kMissing, 0, 0 };
+    std::error_code error;
+    if (contents) {
+        dependency.size = contents->size();
+        dependency.mtime = fileMtime(path, error);
+        dependency.hash = fnv1a(*contents);
+    }
+    return dependency;
+}
+
+// Includes are relative to the directory of the root file, as in sfizz
+inline void compileSfz(const std::string& text, const std::filesystem::path& base,
+                       std::map<std::string, std::string>& defines, CompiledSfz& compiled, int depth) {
+    std::istringstream in(text);
+    std::string raw;
+    bool inBlock = false;
+    while (std::getline(in, raw)) {
+        const std::string line = stripComments(raw, inBlock);
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            continue;
+
+        if (line.compare(first, 7, "#define") == 0) {
+            std::istringstream define(line.substr(first + 7));
+            std::string name, value;
+            define >> name;
+            std::getline(define >> std::ws, value);
+            while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+                value.pop_back();
+            if (!name.empty() && name[0] == '$')
+                defines[name] = value;
+        } else if (line.compare(first, 8, "#include") == 0 && depth < 16) {
+            const std::string expanded = expandDefines(line, defines);
+            const size_t open = expanded.find('"');
+            const size_t close = open == std::string::npos ? open : expanded.find('"', open + 1);
+            if (close != std::string::npos) {
+                const std::filesystem::path path = base / expanded.substr(open + 1, close - open - 1);
+                std::string contents;
+                const bool found = readWholeFile(path, contents);
+                compiled.dependencies.push_back(makeDependency(path, found ? &contents : nullptr));
+                if (found)
+                    compileSfz(contents, base, defines, compiled, depth + 1);
+                continue;
+            }
+        }
+        compiled.text += line;
+        compiled.text += '\n';
+    }
+}
+
+template <class T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void writeString(std::ostream& out, const std::string& value) {
+    writeValue(out, static_cast<uint64_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+template <class T>
+bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool readString(std::istream& in, std::string& value, uint64_t limit) {
+    uint64_t size;
+    if (!readValue(in, size) || size > limit)
+        return false;
+    value.resize(static_cast<size_t>(size));
+    return static_cast<bool>(in.read(&value[0], static_cast<std::streamsize>(size)));
+}
+
+constexpr char kCompiledSfzMagic[8] = { 'P', 'S', 'F', 'Z', 'C', 'M', 'P', '1' };
+
+} // namespace detail
+
+// Compile an SFZ file; throws std::runtime_error if it cannot be read
+inline CompiledSfz compileSfzFile(const std::string& path) {
+    std::string contents;
+    if (!detail::readWholeFile(path, contents))
+        throw std::runtime_error("Cannot read SFZ file " + path);
+    CompiledSfz compiled;
+    compiled.dependencies.push_back(detail::makeDependency(path, &contents));
+    std::map<std::string, std::string> defines;
+    detail::compileSfz(contents, std::filesystem::path(path).parent_path(), defines, compiled, 0);
+    return compiled;
+}
+
+// Compile SFZ text whose includes are relative to base
+inline CompiledSfz compileSfzText(const std::string& text, const std::filesystem::path& base) {
+    CompiledSfz compiled;
+    std::map<std::string, std::string> defines;
+    detail::compileSfz(text, base, defines, compiled, 0);
+    return compiled;
+}
+
+// Compiled text without the regions whose indices, counting <region>
+// headers from 0, are given: each header is dropped with its opcodes, up
+// to the next header. Other headers and #define lines are kept, so the
+// regions left inherit the same values. numRegions receives the count of
+// <region> headers in the text.
+inline std::string removeRegions(const std::string& text, const std::set<int>& indices, int& numRegions) {
+    std::istringstream in(text);
+    std::string line;
+    std::string out;
+    int region = -1;
+    bool dropping = false;
+    while (std::getline(in, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first != std::string::npos && line[first] == '#') {
+            out += line;
+            out += '\n';
+            continue;
+        }
+        for (size_t pos = 0; pos < line.size();) {
+            const size_t header = line.find('<', pos);
+            const size_t close = header == std::string::npos ? header : line.find('>', header);
+            if (close == std::string::npos) {
+                if (!dropping)
+                    out.append(line, pos, std::string::npos);
+                break;
+            }
+            if (!dropping)
+                out.append(line, pos, header - pos);
+            if (line.compare(header, close + 1 - header, "<region>") == 0) {
+                ++region;
+                dropping = indices.count(region) > 0;
+            } else {
+                dropping = false;
+            }
+            if (!dropping)
+                out.append(line, header, close + 1 - header);
+            pos = close + 1;
+        }
+        out += '\n';
+    }
+    numRegions = region + 1;
+    return out;
+}
+
+// Whether the files a compiled SFZ was built from are unchanged. A file
+// with a new modification time but the same size is hashed again, so
+// that touching it does not throw the cache away; its new time is then
+// stored in compiled and restamped set, for the caller to write the cache
+// back and hash it only once.
+inline bool compiledSfzUpToDate(CompiledSfz& compiled, bool& restamped) {
+    restamped = false;
+    for (auto& dependency : compiled.dependencies) {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(dependency.path, error);
+        if (error) {
+            if (dependency.size != CompiledSfz::kMissing)
+                return false;
+            continue;
+        }
+        if (size != dependency.size)
+            return false;
+        const int64_t mtime = detail::fileMtime(dependency.path, error);
+        if (mtime == dependency.mtime && !error)
+            continue;
+        std::string contents;
+        if (!detail::readWholeFile(dependency.path, contents) || detail::fnv1a(contents) != dependency.hash)
+            return false;
+        dependency.mtime = mtime;
+        restamped = true;
+    }
+    return true;
+}
+
+// Size and modification time of files by path (size kMissing for files
+// that do not exist), to tell which ones changed between two loads
+using FileStamps = std::map<std::string, std::pair<uint64_t, int64_t>>;
+
+inline FileStamps stampFiles(const std::vector<std::string>& files) {
+    FileStamps stamps;
+    for (const auto& file : files) {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(file, error);
+        if (error) {
+            stamps[file] = { CompiledSfz::kMissing, 0 };
+            continue;
+        }
+        stamps[file] = { static_cast<uint64_t>(size), detail::fileMtime(file, error) };
+    }
+    return stamps;
+}
+
+// Whether any of the stamped files changed since
+inline bool stampsChanged(const FileStamps& stamps) {
+    std::vector<std::string> files;
+    for (const auto& entry : stamps)
+        files.push_back(entry.first);
+    return stampFiles(files) != stamps;
+}
+
+// Cache file of an SFZ file in cacheDir, named after its absolute path
+inline std::string compiledSfzPath(const std::string& cacheDir, const std::string& sfzPath) {
+    const std::string absolute = std::filesystem::absolute(sfzPath).lexically_normal().string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.sfzc", static_cast<unsigned long long>(detail::fnv1a(absolute)));
+    return (std::filesystem::path(cacheDir) / name).string();
+}
+
+// Read a cache file; false if it is missing, truncated or of another version
+inline bool readCompiledSfz(const std::string& file, CompiledSfz& compiled) {
+    std::ifstream in(file, std::ios::binary);
+    char magic[sizeof(detail::kCompiledSfzMagic)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), detail::kCompiledSfzMagic))
+        return false;
+    const uint64_t limit = uint64_t(1) << 32;
+    uint64_t count;
+    if (!detail::readValue(in, count) || count > (1u << 20))
+        return false;
+    compiled.dependencies.resize(static_cast<size_t>(count));
+    for (auto& dependency : compiled.dependencies) {
+        if (!detail::readString(in, dependency.path, limit) || !detail::readValue(in, dependency.size)
+            || !detail::readValue(in, dependency.mtime) || !detail::readValue(in, dependency.hash))
+            return false;
+    }
+    return detail::readString(in, compiled.text, limit);
+}
+
+// Write a cache file through a temporary file, so that concurrent readers
+// never see it half written; failures are ignored, the cache being optional
+inline void writeCompiledSfz(const std::string& file, const CompiledSfz& compiled) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+    const std::string temporary = file + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(detail::kCompiledSfzMagic, sizeof(detail::kCompiledSfzMagic));
+        detail::writeValue(out, static_cast<uint64_t>(compiled.dependencies.size()));
+        for (const auto& dependency : compiled.dependencies) {
+            detail::writeString(out, dependency.path);
+            detail::writeValue(out, dependency.size);
+            detail::writeValue(out, dependency.mtime);
+            detail::writeValue(out, dependency.hash);
+        }
+        detail::writeString(out, compiled.text);
+        if (!out)
+            error = std::make_error_code(std::errc::io_error);
+    }
+    if (!error)
+        std::filesystem::rename(temporary, file, error);
+    if (error)
+        std::filesystem::remove(temporary, error);
+}
+
+} // namespace pysfizz
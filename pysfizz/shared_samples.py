@@ -0,0 +1,67 @@
+import hashlib
+import os
+import re
+import tempfile
+from pathlib import Path
+
+from . import _sfizz
+
+# Worker processes playing the same library. sfizz decodes samples into
+# private buffers of each synth, and pysfizz cannot share those between
+# processes. What can be cut is how much each synth decodes: with
+# streaming=True it preloads only the first STREAMING_PRELOAD_SIZE frames of
+# each sample and streams the rest from the sample files while a voice plays
+# them. Those reads go through the page cache, which the kernel keeps once
+# per machine however many processes read the same files.
+
+# frames of each sample preloaded by synths loaded with streaming=True
+STREAMING_PRELOAD_SIZE = 8192
+
+_INCLUDE = re.compile(r'#include\s+"([^"]+)"')
+
+
+def shared_root():
+    # PYSFIZZ_SHARED_DIR, else /dev/shm/pysfizz, else a temporary directory
+    root = os.environ.get("PYSFIZZ_SHARED_DIR")
+    if root:
+        return Path(root)
+    if os.path.isdir("/dev/shm"):
+        return Path("/dev/shm") / "pysfizz"
+    return Path(tempfile.gettempdir()) / "pysfizz-shared"
+
+
+def _key(sfz_path):
+    # instrument path and version of its SFZ file
+    stat = sfz_path.stat()
+    text = f"{sfz_path}:{stat.st_size}:{stat.st_mtime_ns}"
+    return sfz_path.stem + "-" + hashlib.sha1(text.encode()).hexdigest()[:16]
+
+
+def _instrument_files(sfz_path):
+    # the SFZ file, the files it includes and the sample files of its regions;
+    # both includes and samples are relative to the directory of the SFZ file
+    from .synth import suppress_stderr
+    files = set()
+    pending = [sfz_path]
+    while pending:
+        path = pending.pop()
+        if path in files or not path.is_file():
+            continue
+        files.add(path)
+        for name in _INCLUDE.findall(path.read_text(errors="replace")):
+            pending.append((sfz_path.parent / name).resolve())
+
+    synth = _sfizz.Synth()
+    synth.set_preload_size(STREAMING_PRELOAD_SIZE)
+    with suppress_stderr():
+        loaded = synth.load_sfz_file(str(sfz_path))
+    if not loaded:
+        raise RuntimeError(f"Failed to load {sfz_path}")
+    for index in range(synth.get_num_regions()):
+        sample = synth.get_region_data(index)["sample_id"]
+        if sample.startswith("*"):
+            continue  # generated, e.g. *sine
+        path = (sfz_path.parent / sample).resolve()
+        if path.is_file():
+            files.add(path)
+    return files
@@ -1,4 +1,8 @@
 from . import _sfizz
+from .events import event_array
+from .packs import PACK_SUFFIXES, lease_size, open_instrument
+from .shared_samples import STREAMING_PRELOAD_SIZE
+import asyncio
 import os
 import sys
 from contextlib import contextmanager
@@ -20,38 +24,320 @@ def suppress_stderr():
         os.dup2(original_stderr_fd, stderr_fd)
         os.close(original_stderr_fd)
 
+# default normalization targets: dBFS for "peak", LUFS for "loudness"
+NORMALIZE_TARGETS = {"peak": -1.0, "loudness": -23.0}
+
+CHANNEL_LAYOUTS = ("stereo", "mono", "mid_side", "left")
+RESAMPLE_QUALITIES = ("fast", "medium", "best")
+
+def cache_dir():
+    # SFZ files with their includes inlined and decoded samples:
+    # PYSFIZZ_CACHE_DIR, else the user cache directory
+    root = os.environ.get("PYSFIZZ_CACHE_DIR")
+    if root:
+        return Path(root)
+    return Path(os.environ.get("XDG_CACHE_HOME") or Path.home() / ".cache") / "pysfizz"
+
+def _render_options(channels="stereo", output_sample_rate=None, resample_quality="medium",
+                    stats=False, normalize=None, target=None, partial=False):
+    if channels not in CHANNEL_LAYOUTS:
+        raise ValueError(f"channels must be one of {list(CHANNEL_LAYOUTS)}, got {channels!r}")
+    if resample_quality not in RESAMPLE_QUALITIES:
+        raise ValueError(f"resample_quality must be one of {list(RESAMPLE_QUALITIES)}, got {resample_quality!r}")
+    options = _sfizz.RenderOptions()
+    options.channels = channels
+    if output_sample_rate is not None:
+        if output_sample_rate <= 0:
+            raise ValueError("output_sample_rate must be positive")
+        options.output_sample_rate = int(output_sample_rate)
+    options.resample_quality = resample_quality
+    options.stats = stats
+    if normalize is not None:
+        if normalize not in NORMALIZE_TARGETS:
+            raise ValueError(f"normalize must be one of {list(NORMALIZE_TARGETS)}, got {normalize!r}")
+        options.normalize = normalize
+        options.target = NORMALIZE_TARGETS[normalize] if target is None else float(target)
+    elif target is not None:
+        raise ValueError("target requires normalize to be set")
+    options.partial = partial
+    return options
+
+def _event_options(time_slices=1, slice_margin=0.5, **kwargs):
+    options = _render_options(**kwargs)
+    if time_slices < 1:
+        raise ValueError("time_slices must be at least 1")
+    options.time_slices = time_slices
+    options.slice_margin = slice_margin
+    return options
+
+def _settle(future, result, error):
+    if future.done():
+        return  # cancelled
+    if error is not None:
+        future.set_exception(error)
+    else:
+        future.set_result(result)
+
+def _async_completion():
+    # future of the running loop, and the callback that resolves it from a native thread
+    loop = asyncio.get_running_loop()
+    future = loop.create_future()
+    def done(result, error):
+        loop.call_soon_threadsafe(_settle, future, result, error)
+    return future, done
+
+async def _stop_on_cancel(future, token):
+    # await a native render, stopping it if the await is cancelled
+    try:
+        return await future
+    except asyncio.CancelledError:
+        token.cancel()
+        raise
+
 class Synth:
     def __init__(self, sample_rate=48000, block_size=1024):
         self._synth = _sfizz.Synth(sample_rate, block_size)
         self._synth.enable_freewheeling()
         self.path = None
+        self._source = None
+        self._samples = None
+        self._pack_lease = None
+        self._shared_bytes = 0
+        # preload size a streaming load replaced, given back by the next
+        # load that does not stream
+        self._preload_before_streaming = None
         self.playable_keys = []
         # expose _sfizz.Synth methods
         self.get_sample_rate = self._synth.get_sample_rate
         self.set_sample_rate = self._synth.set_sample_rate
         self.get_block_size = self._synth.get_block_size
         self.set_block_size = self._synth.set_block_size
+        self.get_preload_size = self._synth.get_preload_size
+        self.set_preload_size = self._synth.set_preload_size
+        self.get_load_threads = self._synth.get_load_threads
+        self.set_load_threads = self._synth.set_load_threads
+        self.get_sample_memory = self._synth.get_sample_memory
+        self.get_num_voices = self._synth.get_num_voices
+        self.set_num_voices = self._synth.set_num_voices
+        self.get_sample_quality = self._synth.get_sample_quality
+        self.set_sample_quality = self._synth.set_sample_quality
+        self.get_oscillator_quality = self._synth.get_oscillator_quality
+        self.set_oscillator_quality = self._synth.set_oscillator_quality
 
-    def load_sfz_file(self, path, quiet=True):
+    def load_sfz_file(self, path, quiet=True, streaming=False, progress=None, include_cache=False,
+                      decode_cache=False):
+        # streaming=True preloads only the start of each sample and streams
+        # the rest through the page cache (see pysfizz.shared_samples); a
+        # later load without it restores the preload size from before
+        # progress: Progress counting the sample bytes of the instrument
+        # include_cache=True (or a directory) loads through a copy of the
+        # file with its includes inlined, rebuilt whenever one of them
+        # changes; sfizz still parses the whole text
+        # decode_cache=True (or a directory) decodes compressed samples (FLAC,
+        # Ogg, MP3, WavPack) on the load threads into float WAV files kept
+        # for later loads, instead of leaving sfizz to decode them serially
+        # path may also be a pack (.tar or .zip, see pysfizz.packs)
         path = Path(path)
         if not path.is_file():
             raise FileNotFoundError(f"File not found: {path}")
-        if path.suffix.lower() != ".sfz":
-            raise ValueError(f"File is not a SFZ file: {path}")
-        path = str(path)
+        source = {"path": str(path), "streaming": streaming, "include_cache": include_cache,
+                  "decode_cache": decode_cache}
+        lease = None
+        if path.suffix.lower() in PACK_SUFFIXES:
+            path, lease = open_instrument(path)
+            path = Path(path)
+        try:
+            if path.suffix.lower() != ".sfz":
+                raise ValueError(f"File is not a SFZ file: {path}")
+            path = str(path)
+            self._stream_samples(streaming)
+            if decode_cache:
+                self._synth.set_decode_cache_dir(str(cache_dir() / "decoded" if decode_cache is True else decode_cache))
+            else:
+                self._synth.set_decode_cache_dir("")
+            if include_cache:
+                directory = str(cache_dir() if include_cache is True else include_cache)
+                load = lambda: self._synth.load_sfz_file_cached(path, directory, progress)
+            else:
+                load = lambda: self._synth.load_sfz_file(path, progress)
+            loaded = self._load(load, path, source, quiet)
+        except BaseException:
+            if lease is not None:
+                lease.close()
+            raise
+        self._hold(lease if loaded else None, None)
+        return loaded
+
+    def _stream_samples(self, streaming):
+        if streaming:
+            if self._preload_before_streaming is None:
+                self._preload_before_streaming = self._synth.get_preload_size()
+            self._synth.set_preload_size(STREAMING_PRELOAD_SIZE)
+        elif self._preload_before_streaming is not None:
+            # unless it was set to something else since
+            if self._synth.get_preload_size() == STREAMING_PRELOAD_SIZE:
+                self._synth.set_preload_size(self._preload_before_streaming)
+            self._preload_before_streaming = None
+
+    def load_sfz_string(self, text, virtual_path=None, quiet=True, progress=None, samples=None):
+        # sample paths are relative to the directory of virtual_path
+        # (default: a file in the current directory), or name the samples of
+        # a SampleBank passed as samples (see pysfizz.memory_samples)
+        if samples is not None:
+            if virtual_path is not None:
+                raise ValueError("virtual_path and samples are exclusive")
+            virtual_path = samples.directory / "instrument.sfz"
+        virtual_path = str(Path(virtual_path) if virtual_path else Path.cwd() / "instrument.sfz")
+        source = {"text": text, "virtual_path": virtual_path}
+        self._stream_samples(False)
+        loaded = self._load(lambda: self._synth.load_sfz_string(text, virtual_path, progress), virtual_path, source, quiet)
+        self._hold(None, samples if loaded else None)
+        return loaded
+
+    def _hold(self, lease, samples):
+        # keep alive what the loaded instrument reads its samples from, and
+        # let go of what the previous one did
+        if self._pack_lease is not None:
+            self._pack_lease.close()
+        self._pack_lease = lease
+        self._samples = samples
+        # size of that copy, for memory_report
+        if lease is not None:
+            self._shared_bytes = lease_size(lease)
+        elif samples is not None:
+            self._shared_bytes = samples.nbytes()
+        else:
+            self._shared_bytes = 0
+
+    def reload_if_changed(self, quiet=True, progress=None):
+        # load the instrument file again if it, one of its includes or one of
+        # its sample files changed since the last load, as a full load;
+        # returns a dict with "reloaded", "success", "text_changed"
+        # and "changed_samples". A file that disappeared leaves the current
+        # instrument loaded; a failed reload leaves none, as load_sfz_file.
+        # Raises ValueError for instruments loaded from a string or a pack,
+        # or pruned since the load.
+        source = self._source
+        if source is None or "path" not in source:
+            raise ValueError("No SFZ file loaded")
+        if Path(source["path"]).suffix.lower() in PACK_SUFFIXES:
+            raise ValueError("Instruments loaded from a pack are reloaded with load_sfz_file")
         if quiet:
             with suppress_stderr():
-                success = self._synth.load_sfz_file(path)
+                result = self._synth.reload_if_changed(progress)
         else:
-            success = self._synth.load_sfz_file(path)
+            result = self._synth.reload_if_changed(progress)
+        if result["reloaded"]:
+            if result["success"] and self._synth.get_num_regions() > 0:
+                self.update_playable_keys()
+            else:
+                self.path = None
+                self._source = None
+        return result
+
+    def memory_report(self):
+        # bytes held by this synth, from get_memory_report: preloaded sample
+        # data per file, block buffers, estimates of sfizz's voice and effect
+        # bus buffers (from the buffer counts of its build configuration,
+        # not measured), and render replicas; plus the shared copy the
+        # instrument plays from (unpacked pack or sample bank, sized at load),
+        # the instrument registry's synths and the resident set of the
+        # process (None where /proc is missing)
+        from .registry import _registry
+        report = self._synth.get_memory_report()
+        report["shared_bytes"] = self._shared_bytes
+        report["registry_bytes"] = _registry.memory() if _registry is not None else 0
+        try:
+            with open("/proc/self/statm") as f:
+                report["rss_bytes"] = int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+        except (OSError, ValueError, AttributeError):
+            report["rss_bytes"] = None
+        return report
+
+    def prune_regions(self, predicate, quiet=True):
+        # drop the regions for which predicate(region_data) is true, with
+        # region_data as returned by get_region_data (e.g. trigger "release",
+        # sample_id of another mic position), releasing the sample data only
+        # they used; returns the bytes of sample memory freed. The instrument
+        # is then played from its pruned SFZ text, so reload_if_changed raises
+        # ValueError until load_sfz_file loads the file again. Raises
+        # RuntimeError, leaving the instrument as it is, when the SFZ files
+        # changed since the load.
+        if self.path is None:
+            raise ValueError("No SFZ file loaded")
+        regions = (self._synth.get_region_data(i) for i in range(self._synth.get_num_regions()))
+        ids = [region["id"] for region in regions if predicate(region)]
+        if not ids:
+            return 0
+        if quiet:
+            with suppress_stderr():
+                freed = self._synth.prune_regions(ids)
+        else:
+            freed = self._synth.prune_regions(ids)
+        self._source = {"text": self._synth.get_sfz_text(), "virtual_path": self.path}
+        self.update_playable_keys()
+        return freed
+
+    def _load(self, load, path, source, quiet):
+        if quiet:
+            with suppress_stderr():
+                success = load()
+        else:
+            success = load()
         if success and self._synth.get_num_regions() > 0:
             self.path = path
+            self._source = source
             self.update_playable_keys()
             return True
         else:
             self.path = None
+            self._source = None
             return False
 
+    def _preload_size(self):
+        # as set by the user, whatever a streaming load replaced it with
+        if self._preload_before_streaming is not None:
+            return self._preload_before_streaming
+        return self._synth.get_preload_size()
+
+    # Pickling keeps the configuration, instrument source and controller state;
+    # unpickling builds a new synth and loads the instrument again
+    def __getstate__(self):
+        return {
+            "sample_rate": self._synth.get_sample_rate(),
+            "block_size": self._synth.get_block_size(),
+            "num_voices": self._synth.get_num_voices(),
+            "freewheeling": self._synth.is_freewheeling(),
+            "sample_quality": self._synth.get_sample_quality(),
+            "oscillator_quality": self._synth.get_oscillator_quality(),
+            "preload_size": self._preload_size(),
+            "source": self._source,
+            "cc_values": list(self._synth.get_cc_values()),
+            "pitch_wheel": self._synth.get_pitch_wheel_value(),
+        }
+
+    def __setstate__(self, state):
+        self.__init__(state["sample_rate"], state["block_size"])
+        synth = self._synth
+        synth.set_num_voices(state["num_voices"])
+        if not state["freewheeling"]:
+            synth.disable_freewheeling()
+        # qualities apply to the current process mode
+        synth.set_sample_quality(state["sample_quality"])
+        synth.set_oscillator_quality(state["oscillator_quality"])
+        synth.set_preload_size(state["preload_size"])
+        source = state["source"]
+        if source is not None:
+            if "text" in source:
+                loaded = self.load_sfz_string(source["text"], source["virtual_path"])
+            else:
+                loaded = self.load_sfz_file(source["path"], streaming=source["streaming"],
+                                           include_cache=source.get("include_cache", False),
+                                           decode_cache=source.get("decode_cache", False))
+            if not loaded:
+                raise RuntimeError(f"Failed to load {source.get('path', source.get('virtual_path'))} while unpickling")
+        synth.set_controllers(state["cc_values"], state["pitch_wheel"])
+
     def update_playable_keys(self):
         if self.path is None:
             raise ValueError("No SFZ file loaded")
@@ -60,35 +346,80 @@ class Synth:
             if len(self._synth.get_regions_for_note(i)) > 0
         ]
 
-    def render_note(self, pitch, vel, note_on_dur, render_dur):
-        nsamples_note_on = int(self.get_sample_rate() * note_on_dur)
-        nsamples_render = int(self.get_sample_rate() * render_dur)
-        block_size = self.get_block_size()
-        nblocks_note_on = nsamples_note_on // block_size
-        note_off_delay = nsamples_note_on % block_size
-        self._synth.note_on(0, pitch, vel)
-        left, right = [], []
-        for _ in range(nblocks_note_on):
-            left_block, right_block = self._synth.render_block()
-            left.append(left_block)
-            right.append(right_block)
-        self._synth.note_off(note_off_delay, pitch, 0)
-        nsamples_current = nblocks_note_on * block_size
-        while self._synth.get_num_active_voices() > 0 and nsamples_current < nsamples_render:
-            left_block, right_block = self._synth.render_block()
-            left.append(left_block)
-            right.append(right_block)
-            nsamples_current += block_size
-        nblocks_silent = 1 + max(0, (nsamples_render - nsamples_current) // block_size)
-        for _ in range(nblocks_silent):
-            left_block, right_block = self._synth.render_block()
-            left.append(left_block)
-            right.append(right_block)
-        rendered_audio = np.array([
-            np.concatenate(left),
-            np.concatenate(right)
-        ])
-        return rendered_audio[:, :nsamples_render]
+    def render_note(self, pitch, vel, note_on_dur, render_dur, channels="stereo",
+                    output_sample_rate=None, resample_quality="medium",
+                    stats=False, normalize=None, target=None, out=None,
+                    cancel=None, timeout=None, partial=False, progress=None):
+        # out: optional float32 C-contiguous array of the returned shape to
+        # render into (see output_shape), returned instead of a new array
+        # cancel: CancelToken to stop the render from another thread
+        # timeout: seconds after which the render stops with RenderTimeout
+        # partial: on cancel or timeout, return the audio rendered so far
+        # instead of raising (Ctrl-C always raises KeyboardInterrupt)
+        # progress: Progress updated while rendering, readable from any thread
+        options = _render_options(channels=channels, output_sample_rate=output_sample_rate,
+                                  resample_quality=resample_quality,
+                                  stats=stats, normalize=normalize, target=target, partial=partial)
+        return self._synth.render_note(pitch, vel, note_on_dur, render_dur, options, out,
+                                       cancel, timeout or 0.0, progress)
+
+    def render_events(self, events, render_dur, channels="stereo",
+                      output_sample_rate=None, resample_quality="medium",
+                      stats=False, normalize=None, target=None,
+                      time_slices=1, slice_margin=0.5, out=None,
+                      cancel=None, timeout=None, partial=False, progress=None):
+        # events: see pysfizz.events.event_array
+        # time_slices > 1 cuts the timeline where no note sounds (predicted
+        # tails plus slice_margin seconds) and renders up to that many slices
+        # in parallel on replicas of this synth, each loading the same instrument;
+        # instruments with random opcodes, round robins or keyswitches render serially
+        options = _event_options(channels=channels, output_sample_rate=output_sample_rate,
+                                 resample_quality=resample_quality,
+                                 stats=stats, normalize=normalize, target=target,
+                                 time_slices=time_slices, slice_margin=slice_margin,
+                                 partial=partial)
+        return self._synth.render_events(event_array(events), render_dur, options, out,
+                                         cancel, timeout or 0.0, progress)
+
+    # Awaitable renders for asyncio: the render runs on a shared native thread
+    # pool and resolves the future from there, so the event loop never blocks.
+    # Renders of one synth run in submission order; those of different synths
+    # run in parallel. Cancelling the await stops the render at its next block.
+    # Blocking calls on the synth meanwhile wait for the render in progress.
+    async def render_note_async(self, pitch, vel, note_on_dur, render_dur, channels="stereo",
+                                output_sample_rate=None, resample_quality="medium",
+                                stats=False, normalize=None, target=None, out=None,
+                                cancel=None, timeout=None, partial=False, progress=None):
+        options = _render_options(channels=channels, output_sample_rate=output_sample_rate,
+                                  resample_quality=resample_quality,
+                                  stats=stats, normalize=normalize, target=target, partial=partial)
+        future, done = _async_completion()
+        token = _sfizz.CancelToken() if cancel is None else _sfizz.CancelToken(cancel)
+        self._synth.render_note_async(pitch, vel, note_on_dur, render_dur, options, out,
+                                      token, timeout or 0.0, progress, done)
+        return await _stop_on_cancel(future, token)
+
+    async def render_events_async(self, events, render_dur, channels="stereo",
+                                  output_sample_rate=None, resample_quality="medium",
+                                  stats=False, normalize=None, target=None,
+                                  time_slices=1, slice_margin=0.5, out=None,
+                                  cancel=None, timeout=None, partial=False, progress=None):
+        options = _event_options(channels=channels, output_sample_rate=output_sample_rate,
+                                 resample_quality=resample_quality,
+                                 stats=stats, normalize=normalize, target=target,
+                                 time_slices=time_slices, slice_margin=slice_margin,
+                                 partial=partial)
+        future, done = _async_completion()
+        token = _sfizz.CancelToken() if cancel is None else _sfizz.CancelToken(cancel)
+        self._synth.render_events_async(event_array(events), render_dur, options, out,
+                                        token, timeout or 0.0, progress, done)
+        return await _stop_on_cancel(future, token)
+
+    def output_shape(self, render_dur, channels="stereo", output_sample_rate=None):
+        # shape of the audio returned by render_note / render_events
+        rate = output_sample_rate or self._synth.get_sample_rate()
+        num_frames = int(rate * render_dur)
+        return (num_frames,) if channels in ("mono", "left") else (2, num_frames)
 
     def get_note_info(self, midi_note):
         if self.path is None:
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pysfizz {
+
+// Fixed pool of native worker threads.
+// Work never touches Python objects, so it runs without holding the GIL.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(size_t numThreads = 0) {
+        if (numThreads == 0)
+            numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        workers_.reserve(numThreads);
+        for (size_t i = 0; i < numThreads; ++i)
+            workers_.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Queue a task; it must not throw
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        condition_.notify_one();
+    }
+
+    // Run fn(0) ... fn(count - 1) on the pool and the calling thread, and
+    // wait for all of them. The first exception thrown is rethrown here.
+    // The caller takes indices too, so this may be nested inside pool tasks:
+    // helpers that only get scheduled after all indices are taken do nothing.
+    // While the caller waits for the others it runs poll every pollInterval;
+    // if poll throws, the wait goes on (poll must make the tasks stop) and
+    // its exception is rethrown first.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn,
+                     const std::function<void()>& poll = nullptr,
+                     std::chrono::milliseconds pollInterval = std::chrono::milliseconds(10)) {
+        if (count == 0)
+            return;
+        if (count == 1) {
+            fn(0);
+            return;
+        }
+
+        struct Shared {
+            std::function<void(size_t)> fn;
+            size_t count = 0;
+            std::atomic<size_t> next { 0 };
+            std::mutex mutex;
+            std::condition_variable done;
+            size_t completed = 0;
+            std::exception_ptr error;
+        };
+        auto shared = std::make_shared<Shared>();
+        shared->fn = fn;
+        shared->count = count;
+
+        auto drain = [](Shared& s) {
+            for (size_t i; (i = s.next.fetch_add(1)) < s.count;) {
+                std::exception_ptr error;
+                try {
+                    s.fn(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (error && !s.error)
+                    s.error = error;
+                if (++s.completed == s.count)
+                    s.done.notify_all();
+            }
+        };
+
+        const size_t helpers = std::min(count - 1, workers_.size());
+        for (size_t h = 0; h < helpers; ++h)
+            submit([shared, drain] { drain(*shared); });
+
+        drain(*shared);
+
+        std::exception_ptr pollError;
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        auto finished = [&shared] { return shared->completed == shared->count; };
+        while (!finished()) {
+            if (!poll || pollError) {
+                shared->done.wait(lock, finished);
+            } else if (!shared->done.wait_for(lock, pollInterval, finished)) {
+                lock.unlock();
+                try {
+                    poll();
+                } catch (...) {
+                    pollError = std::current_exception();
+                }
+                lock.lock();
+            }
+        }
+        if (pollError)
+            std::rethrow_exception(pollError);
+        if (shared->error)
+            std::rethrow_exception(shared->error);
+    }
+
+private:
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_ = false;
+};
+
+} // namespace pysfizz
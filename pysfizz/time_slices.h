@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "events.h"
+#include "sample_prefetch.h"
+
+namespace pysfizz {
+
+// Predicted lengths of the voices started by one note, in frames
+struct NoteTail {
+    // Counted from the note-on: voices that ignore the note-off (one-shots)
+    int64_t fromNoteOn = 0;
+    // Counted from the effective note-off: release stages and release triggers
+    int64_t fromNoteOff = 0;
+};
+
+using NoteTailPredictor = std::function<NoteTail(int note, int velocity)>;
+
+// Whether SFZ text uses anything whose outcome depends on more than the
+// controller state at a slice start, which a fresh replica cannot pick up
+// where the serial render stands:
+// - random values and noise generators, drawn from a generator sfizz
+//   shares between all synths of a process
+// - round robins and keyswitches, which count or remember earlier notes
+// - CC-triggered regions, which would fire when a replica is given the
+//   controller state of its slice start
+// - effect buses, whose tails and state carry over from earlier notes
+// Such instruments are rendered in one piece.
+inline bool hasCarriedState(const std::string& text) {
+    std::istringstream lines(text);
+    std::string line;
+    bool inBlock = false;
+    while (std::getline(lines, line)) {
+        line = detail::stripComments(line, inBlock);
+        if (line.find("<effect>") != std::string::npos)
+            return true;
+        for (const auto& opcode : detail::lineOpcodes(line)) {
+            const std::string& name = opcode.first;
+            const std::string& value = opcode.second;
+            if (name.find("random") != std::string::npos || name == "lorand" || name == "hirand"
+                || name.compare(0, 4, "seq_") == 0 || name.compare(0, 3, "sw_") == 0
+                || name.compare(0, 7, "on_locc") == 0 || name.compare(0, 7, "on_hicc") == 0
+                || name.compare(0, 10, "start_locc") == 0 || name.compare(0, 10, "start_hicc") == 0
+                || (name == "sample" && (value == "*noise" || value == "*gnoise"))
+                || (name == "oscillator_phase" && !value.empty() && value[0] == '-'))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Find where an event timeline can be cut into independent slices.
+// A cut is only placed where no note is held (sustain pedal included),
+// every predicted tail has ended at least marginFrames earlier, and on a
+// block boundary that comes before the block of the next note-on, so that
+// a fresh synth started at the cut renders the same blocks as the serial one.
+// Among those points, at most maxSlices - 1 are chosen, as close as possible
+// to an even split of totalFrames. Returns the slice start frames, the first
+// one being 0.
+inline std::vector<int64_t> planTimeSlices(const std::vector<Event>& events, const NoteTailPredictor& predict,
+                                           int64_t marginFrames, int blockSize, int64_t totalFrames,
+                                           size_t maxSlices) {
+    std::vector<int64_t> starts { 0 };
+    if (maxSlices <= 1 || events.empty())
+        return starts;
+
+    const int64_t block = blockSize;
+    std::vector<int64_t> candidates;
+
+    std::array<int, 128> heldVelocity;   // -1 when not held
+    std::array<bool, 128> sustained {};  // released while the pedal was down
+    heldVelocity.fill(-1);
+    std::array<int, 128> sustainedVelocity {};
+    int numHeld = 0;
+    int numSustained = 0;
+    bool pedalDown = false;
+    int64_t busyUntil = 0;
+
+    auto release = [&](int note, int velocity, int64_t frame) {
+        busyUntil = std::max(busyUntil, frame + predict(note, velocity).fromNoteOff);
+    };
+
+    for (const auto& event : events) {
+        switch (event.type) {
+        case EventType::note_on: {
+            if (numHeld == 0 && numSustained == 0) {
+                const int64_t earliest = (busyUntil + marginFrames + block - 1) / block * block;
+                const int64_t latest = event.frame / block * block;
+                if (earliest > 0 && earliest <= latest && earliest < totalFrames)
+                    candidates.push_back(earliest);
+            }
+            const NoteTail tail = predict(event.data1, event.data2);
+            busyUntil = std::max(busyUntil, event.frame + tail.fromNoteOn);
+            if (heldVelocity[event.data1] < 0)
+                ++numHeld;
+            // A retriggered sustained note keeps its old voices until the
+            // pedal goes up, so it stays counted as sustained
+            heldVelocity[event.data1] = event.data2;
+            break;
+        }
+        case EventType::note_off:
+            if (heldVelocity[event.data1] >= 0) {
+                --numHeld;
+                if (pedalDown) {
+                    if (!sustained[event.data1])
+                        ++numSustained;
+                    sustained[event.data1] = true;
+                    sustainedVelocity[event.data1] = heldVelocity[event.data1];
+                } else {
+                    release(event.data1, heldVelocity[event.data1], event.frame);
+                }
+                heldVelocity[event.data1] = -1;
+            }
+            break;
+        case EventType::cc:
+            if (event.data1 == 64) {
+                const bool down = event.data2 >= 64;
+                if (pedalDown && !down) {
+                    for (int note = 0; note < 128; ++note) {
+                        if (sustained[note]) {
+                            release(note, sustainedVelocity[note], event.frame);
+                            sustained[note] = false;
+                        }
+                    }
+                    numSustained = 0;
+                }
+                pedalDown = down;
+            }
+            break;
+        case EventType::pitch_wheel:
+            break;
+        }
+    }
+
+    // Pick the candidates closest to an even split
+    for (size_t k = 1; k < maxSlices && !candidates.empty(); ++k) {
+        const int64_t ideal = totalFrames * static_cast<int64_t>(k) / static_cast<int64_t>(maxSlices);
+        auto best = std::min_element(candidates.begin(), candidates.end(), [ideal](int64_t a, int64_t b) {
+            return std::llabs(a - ideal) < std::llabs(b - ideal);
+        });
+        if (*best > starts.back())
+            starts.push_back(*best);
+    }
+    return starts;
+}
+
+} // namespace pysfizz
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "kernels.h"
+
+namespace pysfizz {
+
+// Write planar float audio ((channels, frames), C-contiguous) to a WAV
+// file, as 16-bit PCM or 32-bit float. Samples are written in host order,
+// which is little-endian on every platform the package is built for.
+inline void writeWav(const std::string& path, const float* data, size_t numChannels, size_t numFrames,
+                     int sampleRate, bool float32) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file)
+        throw std::runtime_error("Cannot write " + path);
+
+    const uint32_t bytesPerSample = float32 ? 4 : 2;
+    const uint32_t blockAlign = static_cast<uint32_t>(numChannels) * bytesPerSample;
+    const uint64_t dataSize = static_cast<uint64_t>(numFrames) * blockAlign;
+    if (dataSize > 0xffffffffull - 36)
+        throw std::runtime_error("Audio too long for a WAV file: " + path);
+
+    uint8_t header[44];
+    auto put16 = [&header](size_t offset, uint32_t value) {
+        header[offset] = static_cast<uint8_t>(value);
+        header[offset + 1] = static_cast<uint8_t>(value >> 8);
+    };
+    auto put32 = [&header](size_t offset, uint32_t value) {
+        for (size_t i = 0; i < 4; ++i)
+            header[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    };
+    std::copy_n("RIFF", 4, header);
+    put32(4, static_cast<uint32_t>(36 + dataSize));
+    std::copy_n("WAVEfmt ", 8, header + 8);
+    put32(16, 16);
+    put16(20, float32 ? 3 : 1);  // IEEE float or PCM
+    put16(22, static_cast<uint32_t>(numChannels));
+    put32(24, static_cast<uint32_t>(sampleRate));
+    put32(28, static_cast<uint32_t>(sampleRate) * blockAlign);
+    put16(32, blockAlign);
+    put16(34, bytesPerSample * 8);
+    std::copy_n("data", 4, header + 36);
+    put32(40, static_cast<uint32_t>(dataSize));
+    bool ok = std::fwrite(header, 1, sizeof(header), file.get()) == sizeof(header);
+
+    // Interleave a chunk of frames at a time
+    const size_t chunkFrames = 4096;
+    std::vector<int16_t> pcm(chunkFrames);
+    std::vector<int16_t> interleavedPcm(float32 ? 0 : chunkFrames * numChannels);
+    std::vector<float> interleavedFloat(float32 ? chunkFrames * numChannels : 0);
+    for (size_t start = 0; ok && start < numFrames; start += chunkFrames) {
+        const size_t frames = std::min(chunkFrames, numFrames - start);
+        for (size_t c = 0; c < numChannels; ++c) {
+            const float* channel = data + c * numFrames + start;
+            if (float32) {
+                for (size_t i = 0; i < frames; ++i)
+                    interleavedFloat[i * numChannels + c] = channel[i];
+            } else {
+                kernels::floatToInt16(pcm.data(), channel, frames);
+                for (size_t i = 0; i < frames; ++i)
+                    interleavedPcm[i * numChannels + c] = pcm[i];
+            }
+        }
+        const size_t bytes = frames * blockAlign;
+        const void* chunk = float32 ? static_cast<const void*>(interleavedFloat.data())
+                                    : static_cast<const void*>(interleavedPcm.data());
+        ok = std::fwrite(chunk, 1, bytes, file.get()) == bytes;
+    }
+
+    if (!ok || std::fflush(file.get()) != 0)
+        throw std::runtime_error("Failed writing " + path);
+}
+
+} // namespace pysfizz
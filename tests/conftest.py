@@ -0,0 +1,65 @@
+import wave
+
+import numpy as np
+import pytest
+
+import pysfizz
+
+SAMPLE_RATE = 48000
+
+
+def tone(frequency, duration, sample_rate=SAMPLE_RATE, amplitude=0.5, channels=1):
+    # sine of the given frequency, shaped (frames,) or (frames, channels)
+    t = np.arange(int(sample_rate * duration)) / sample_rate
+    audio = (amplitude * np.sin(2 * np.pi * frequency * t)).astype(np.float32)
+    return audio if channels == 1 else np.repeat(audio[:, None], channels, axis=1)
+
+
+def write_wav(path, audio, sample_rate=SAMPLE_RATE):
+    # 16-bit PCM, from float audio shaped (frames,) or (frames, channels)
+    audio = np.asarray(audio)
+    with wave.open(str(path), "wb") as f:
+        f.setnchannels(1 if audio.ndim == 1 else audio.shape[1])
+        f.setsampwidth(2)
+        f.setframerate(sample_rate)
+        f.writeframes((np.clip(audio, -1.0, 1.0) * 32767).astype("<i2").tobytes())
+    return path
+
+
+def read_wav(path):
+    # 16-bit PCM as float audio shaped (channels, frames), and its sample rate
+    with wave.open(str(path), "rb") as f:
+        assert f.getsampwidth() == 2
+        data = np.frombuffer(f.readframes(f.getnframes()), dtype="<i2")
+        audio = data.reshape(-1, f.getnchannels()).T / 32768.0
+        return audio, f.getframerate()
+
+
+def load(path, **kwargs):
+    synth = pysfizz.Synth(**kwargs)
+    assert synth.load_sfz_file(path)
+    return synth
+
+
+@pytest.fixture(autouse=True)
+def isolated_dirs(tmp_path_factory, monkeypatch):
+    # keep unpacked packs, sample banks and caches out of the user's directories
+    monkeypatch.setenv("PYSFIZZ_SHARED_DIR", str(tmp_path_factory.mktemp("shared")))
+    monkeypatch.setenv("PYSFIZZ_CACHE_DIR", str(tmp_path_factory.mktemp("cache")))
+
+
+@pytest.fixture
+def sine_sfz(tmp_path):
+    # generated sine, the same on every render
+    path = tmp_path / "sine.sfz"
+    path.write_text("<region> sample=*sine ampeg_release=0.05\n")
+    return path
+
+
+@pytest.fixture
+def sample_sfz(tmp_path):
+    # a 440 Hz tone read from a WAV file, played at its pitch on note 69
+    write_wav(tmp_path / "tone.wav", tone(440, 1.0))
+    path = tmp_path / "tone.sfz"
+    path.write_text("<region> sample=tone.wav pitch_keycenter=69 ampeg_release=0.05\n")
+    return path
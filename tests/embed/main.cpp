@@ -0,0 +1,41 @@
+// Renders a note with pysfizz::Engine, into its own output and into a
+// caller-owned buffer, and prints the frame count and peak of the first.
+//
+// Usage: pysfizz_embed <sfz file>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "engine.h"
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: pysfizz_embed <sfz file>\n");
+        return 2;
+    }
+
+    pysfizz::Engine engine(48000);
+    if (!engine.loadSfzFile(argv[1])) {
+        std::fprintf(stderr, "Failed to load %s\n", argv[1]);
+        return 1;
+    }
+
+    pysfizz::RenderOptions options;
+    options.channels = "mono";
+    pysfizz::RenderOutput audio = engine.renderNote(69, 100, 0.25, 0.5, options);
+
+    std::vector<float> buffer(audio.numFrames());
+    pysfizz::RenderOutput into = engine.makeOutput(0.5, options, buffer.data());
+    engine.renderNote(69, 100, 0.25, options, into);
+    if (!std::equal(buffer.begin(), buffer.end(), audio.channel(0))) {
+        std::fprintf(stderr, "Renders into caller memory differ\n");
+        return 1;
+    }
+
+    float peak = 0.0f;
+    for (size_t i = 0; i < audio.numFrames(); ++i)
+        peak = std::max(peak, std::fabs(audio.channel(0)[i]));
+    std::printf("%zu %.6f\n", audio.numFrames(), peak);
+    return 0;
+}
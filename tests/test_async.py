@@ -0,0 +1,85 @@
+import asyncio
+
+import numpy as np
+import pytest
+
+from conftest import SAMPLE_RATE, load
+
+EVENTS = [(0.0, "note_on", 60, 100), (0.3, "note_on", 67, 80), (0.5, "note_off", 60), (0.8, "note_off", 67)]
+
+
+def test_gather_matches_blocking(sample_sfz):
+    synth = load(sample_sfz)
+
+    async def main():
+        return await asyncio.gather(*(synth.render_note_async(p, 100, 0.5, 1.0) for p in range(60, 68)))
+
+    results = asyncio.run(main())
+    reference = load(sample_sfz)
+    for pitch, audio in zip(range(60, 68), results):
+        np.testing.assert_array_equal(audio, reference.render_note(pitch, 100, 0.5, 1.0))
+
+
+def test_synths_render_in_parallel(sine_sfz, sample_sfz):
+    synths = [load(sine_sfz), load(sample_sfz), load(sine_sfz)]
+
+    async def main():
+        return await asyncio.gather(*(s.render_events_async(EVENTS, 1.0, stats=True) for s in synths))
+
+    for synth, (audio, stats) in zip(synths, asyncio.run(main())):
+        expected, expected_stats = synth.render_events(EVENTS, 1.0, stats=True)
+        np.testing.assert_array_equal(audio, expected)
+        assert stats["peak"] == expected_stats["peak"]
+
+
+def test_options_and_out(sine_sfz):
+    synth = load(sine_sfz)
+    out = np.empty(synth.output_shape(1.0, "mono", 16000), dtype=np.float32)
+
+    async def main():
+        return await synth.render_note_async(60, 100, 0.5, 1.0, channels="mono", output_sample_rate=16000, out=out)
+
+    assert asyncio.run(main()) is out
+    np.testing.assert_array_equal(out, synth.render_note(60, 100, 0.5, 1.0, channels="mono", output_sample_rate=16000))
+
+
+def test_invalid_options_raise_before_submitting(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(ValueError):
+        asyncio.run(synth.render_note_async(60, 100, 0.5, 1.0, channels="quad"))
+    with pytest.raises(ValueError):
+        asyncio.run(synth.render_events_async(EVENTS, 1.0, time_slices=0))
+
+
+def test_blocking_call_waits_for_render_in_flight(sine_sfz):
+    synth = load(sine_sfz)
+    reference = load(sine_sfz)
+
+    async def main():
+        long_render = asyncio.create_task(synth.render_note_async(60, 100, 1.0, 30.0))
+        await asyncio.sleep(0)  # submitted
+        blocking = synth.render_note(64, 100, 0.5, 1.0)
+        return blocking, await long_render
+
+    blocking, audio = asyncio.run(main())
+    np.testing.assert_array_equal(blocking, reference.render_note(64, 100, 0.5, 1.0))
+    assert audio.shape == (2, 30 * SAMPLE_RATE)
+
+
+def test_sample_rate_change_fails_queued_renders(sine_sfz):
+    synth = load(sine_sfz)
+
+    async def main():
+        # the second render is queued behind the first, and waits for the engine
+        # after set_sample_rate, which waits for the first one
+        first = asyncio.create_task(synth.render_note_async(60, 100, 1.0, 30.0))
+        queued = asyncio.create_task(synth.render_note_async(64, 100, 0.5, 1.0))
+        await asyncio.sleep(0)
+        synth.set_sample_rate(44100)
+        return await asyncio.gather(first, queued, return_exceptions=True)
+
+    first, queued = asyncio.run(main())
+    assert isinstance(queued, ValueError)
+    assert isinstance(first, ValueError) or first.shape == (2, 30 * SAMPLE_RATE)
+    # renders submitted after the change are sized for the new rate
+    assert asyncio.run(synth.render_note_async(60, 100, 0.5, 1.0)).shape == (2, 44100)
@@ -0,0 +1,168 @@
+import json
+import os
+import struct
+import subprocess
+from pathlib import Path
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import SAMPLE_RATE, load, read_wav
+
+EXE = Path(pysfizz.__file__).parent / "bin" / ("pysfizz-render.exe" if os.name == "nt" else "pysfizz-render")
+
+pytestmark = pytest.mark.skipif(not EXE.exists(), reason="pysfizz-render is not installed")
+
+# 16-bit output, read back against float renders
+PCM_TOLERANCE = 1e-3
+
+
+def run(manifest, *args):
+    return subprocess.run([str(EXE), str(manifest), "--quiet", *args], capture_output=True, text=True)
+
+
+def write_jsonl(path, jobs):
+    path.write_text("".join(json.dumps(job) + "\n" for job in jobs))
+    return path
+
+
+def write_midi(path, notes, division=480, tempo=500000):
+    # format 0 file of (pitch, velocity, start tick, end tick) notes
+    def delta(value):
+        out = [value & 0x7F]
+        value >>= 7
+        while value:
+            out.insert(0, 0x80 | (value & 0x7F))
+            value >>= 7
+        return bytes(out)
+
+    events = [(0, bytes([0xFF, 0x51, 0x03]) + tempo.to_bytes(3, "big"))]
+    for pitch, velocity, start, end in notes:
+        events.append((start, bytes([0x90, pitch, velocity])))
+        events.append((end, bytes([0x80, pitch, 0])))
+    events.sort(key=lambda e: e[0])
+    track, now = b"", 0
+    for tick, data in events:
+        track += delta(tick - now) + data
+        now = tick
+    track += delta(0) + bytes([0xFF, 0x2F, 0x00])
+    path.write_bytes(b"MThd" + struct.pack(">IHHH", 6, 0, 1, division)
+                     + b"MTrk" + struct.pack(">I", len(track)) + track)
+    return path
+
+
+def test_jsonl_jobs_match_synth(tmp_path, sine_sfz):
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [
+        {"instrument": sine_sfz.name, "output": "out/single.wav", "pitch": 60, "velocity": 100, "note_on_dur": 0.5},
+        {"instrument": str(sine_sfz), "output": "out/notes.wav", "notes": [[60, 100, 0.0, 0.3], [67, 80, 0.2, 0.4]],
+         "cc": {"7": 64}, "render_dur": 1.0},
+    ])
+    result = run(manifest, "--threads", "2")
+    assert result.returncode == 0, result.stderr
+
+    audio, rate = read_wav(tmp_path / "out" / "single.wav")
+    assert rate == SAMPLE_RATE
+    assert audio.shape == (2, int(SAMPLE_RATE * (0.5 + 2.0)))
+    expected = load(sine_sfz).render_note(60, 100, 0.5, 2.5)
+    np.testing.assert_allclose(audio, expected, atol=PCM_TOLERANCE)
+
+    audio, _ = read_wav(tmp_path / "out" / "notes.wav")
+    events = [(0.0, "cc", 7, 64), (0.0, "note_on", 60, 100), (0.3, "note_off", 60),
+              (0.2, "note_on", 67, 80), (0.6, "note_off", 67)]
+    expected = load(sine_sfz).render_events(events, 1.0)
+    assert audio.shape == expected.shape
+    np.testing.assert_allclose(audio, expected, atol=PCM_TOLERANCE)
+
+
+def test_csv_manifest(tmp_path, sine_sfz):
+    manifest = tmp_path / "jobs.csv"
+    manifest.write_text(
+        "instrument,output,notes,cc,render_dur,channels\n"
+        f"{sine_sfz.name},chord.wav,60:100:0:0.4;64:100:0:0.4,\"7=100;10=32\",0.8,mono\n"
+    )
+    result = run(manifest)
+    assert result.returncode == 0, result.stderr
+    audio, _ = read_wav(tmp_path / "chord.wav")
+    events = [(0.0, "cc", 7, 100), (0.0, "cc", 10, 32), (0.0, "note_on", 60, 100), (0.4, "note_off", 60),
+              (0.0, "note_on", 64, 100), (0.4, "note_off", 64)]
+    expected = load(sine_sfz).render_events(events, 0.8, channels="mono")
+    assert audio.shape == (1, expected.shape[0])
+    np.testing.assert_allclose(audio[0], expected, atol=PCM_TOLERANCE)
+
+
+def test_midi_file(tmp_path, sine_sfz):
+    # 480 ticks per quarter note at 120 bpm: 960 ticks per second
+    write_midi(tmp_path / "song.mid", [(60, 100, 0, 480), (64, 90, 480, 960)])
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [
+        {"instrument": sine_sfz.name, "output": "song.wav", "midi": "song.mid", "tail": 0.5},
+    ])
+    result = run(manifest)
+    assert result.returncode == 0, result.stderr
+    audio, _ = read_wav(tmp_path / "song.wav")
+    events = [(0.0, "note_on", 60, 100), (0.5, "note_off", 60), (0.5, "note_on", 64, 90), (1.0, "note_off", 64)]
+    expected = load(sine_sfz).render_events(events, 1.5)
+    assert audio.shape == expected.shape
+    np.testing.assert_allclose(audio, expected, atol=PCM_TOLERANCE)
+
+
+def test_output_options(tmp_path, sine_sfz):
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [
+        {"instrument": sine_sfz.name, "output": "low.wav", "pitch": 60, "note_on_dur": 0.5, "render_dur": 1.0,
+         "sample_rate": 44100, "output_sample_rate": 16000, "normalize": "peak", "target": -6.0},
+    ])
+    result = run(manifest)
+    assert result.returncode == 0, result.stderr
+    audio, rate = read_wav(tmp_path / "low.wav")
+    assert rate == 16000
+    assert audio.shape == (2, 16000)
+    assert np.abs(audio).max() == pytest.approx(10 ** (-6.0 / 20), abs=PCM_TOLERANCE)
+
+
+def test_float32_format(tmp_path, sine_sfz):
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [
+        {"instrument": sine_sfz.name, "output": "float.wav", "pitch": 60, "note_on_dur": 0.5, "render_dur": 1.0,
+         "format": "float32"},
+    ])
+    result = run(manifest)
+    assert result.returncode == 0, result.stderr
+    data = (tmp_path / "float.wav").read_bytes()
+    audio_format, channels, rate = struct.unpack_from("<HHI", data, 20)
+    assert (audio_format, channels, rate) == (3, 2, SAMPLE_RATE)
+    audio = np.frombuffer(data, dtype="<f4", offset=44).reshape(-1, 2).T
+    np.testing.assert_allclose(audio, load(sine_sfz).render_note(60, 100, 0.5, 1.0), atol=1e-6)
+
+
+def test_failed_job_sets_exit_status(tmp_path, sine_sfz):
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [
+        {"instrument": sine_sfz.name, "output": "good.wav", "pitch": 60, "note_on_dur": 0.2},
+        {"instrument": "missing.sfz", "output": "bad.wav", "pitch": 60, "note_on_dur": 0.2},
+    ])
+    result = run(manifest)
+    assert result.returncode == 1
+    assert f"{manifest}:2:" in result.stderr
+    assert "Rendered 1 of 2 jobs" in result.stderr
+    assert (tmp_path / "good.wav").exists()
+    assert not (tmp_path / "bad.wav").exists()
+
+
+@pytest.mark.parametrize("job, message", [
+    ({"output": "a.wav", "pitch": 60}, "Missing 'instrument'"),
+    ({"instrument": "a.sfz", "pitch": 60}, "Missing 'output'"),
+    ({"instrument": "a.sfz", "output": "a.wav"}, "Missing 'notes', 'pitch' or 'midi'"),
+    ({"instrument": "a.sfz", "output": "a.wav", "pitch": 60, "colour": "red"}, "Unknown field 'colour'"),
+    ({"instrument": "a.sfz", "output": "a.wav", "pitch": 60, "format": "int24"}, "'format'"),
+])
+def test_invalid_manifest(tmp_path, job, message):
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [job])
+    result = run(manifest)
+    assert result.returncode == 2
+    assert result.stderr.startswith("pysfizz-render: ")
+    assert f"{manifest}:1: " in result.stderr and message in result.stderr
+    assert not (tmp_path / "a.wav").exists()
+
+
+def test_invalid_arguments(tmp_path):
+    assert run(tmp_path / "missing.jsonl").returncode == 2
+    manifest = write_jsonl(tmp_path / "jobs.jsonl", [])
+    assert run(manifest, "--threads").returncode == 2
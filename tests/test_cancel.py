@@ -0,0 +1,125 @@
+import _thread
+import asyncio
+import threading
+import time
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import SAMPLE_RATE, load
+
+# long enough that no render finishes before it is stopped
+LONG = 600.0
+HELD = [(0.0, "note_on", 60, 100), (LONG, "note_off", 60)]
+
+
+def cancelled_token():
+    token = pysfizz.CancelToken()
+    token.cancel()
+    return token
+
+
+def test_token():
+    parent = pysfizz.CancelToken()
+    child = pysfizz.CancelToken(parent)
+    assert not parent.cancelled and not child.cancelled
+    parent.cancel()
+    assert child.cancelled
+    parent.reset()
+    assert not child.cancelled
+
+
+def test_cancelled_token_raises(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(pysfizz.RenderCancelled) as info:
+        synth.render_note(60, 100, 1.0, LONG, cancel=cancelled_token())
+    assert not isinstance(info.value, TimeoutError)
+    with pytest.raises(pysfizz.RenderCancelled):
+        synth.render_events(HELD, LONG, time_slices=4, cancel=cancelled_token())
+
+
+def test_timeout(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(pysfizz.RenderTimeout) as info:
+        synth.render_events(HELD, LONG, timeout=0.05)
+    assert isinstance(info.value, TimeoutError)
+    assert isinstance(info.value, pysfizz.RenderCancelled)
+
+
+def test_cancel_from_another_thread(sine_sfz):
+    synth = load(sine_sfz)
+    token = pysfizz.CancelToken()
+    timer = threading.Timer(0.1, token.cancel)
+    timer.start()
+    try:
+        with pytest.raises(pysfizz.RenderCancelled):
+            synth.render_events(HELD, LONG, cancel=token)
+    finally:
+        timer.cancel()
+
+
+def test_interrupt_during_time_slices(sine_sfz):
+    # the first slice is short: the calling thread may be done with it and
+    # waiting for the long one, and must still see the interrupt
+    synth = load(sine_sfz)
+    events = [(0.0, "note_on", 60, 100), (0.2, "note_off", 60), (2.0, "note_on", 64, 100), (LONG, "note_off", 64)]
+    timer = threading.Timer(0.2, _thread.interrupt_main)
+    start = time.monotonic()
+    timer.start()
+    try:
+        with pytest.raises(KeyboardInterrupt):
+            synth.render_events(events, LONG, time_slices=2, slice_margin=0.2)
+    finally:
+        timer.cancel()
+    assert time.monotonic() - start < 2.0
+    # stopped slices leave the synth reusable
+    np.testing.assert_array_equal(synth.render_note(64, 100, 0.5, 1.0), load(sine_sfz).render_note(64, 100, 0.5, 1.0))
+
+
+def test_partial_returns_the_start(sine_sfz):
+    synth = load(sine_sfz)
+    audio = synth.render_events(HELD, LONG, timeout=0.1, partial=True)
+    assert audio.shape[0] == 2
+    assert 0 < audio.shape[1] < int(LONG * SAMPLE_RATE)
+    expected = load(sine_sfz).render_events(HELD, audio.shape[1] / SAMPLE_RATE)
+    frames = min(audio.shape[1], expected.shape[1])
+    np.testing.assert_array_equal(audio[:, :frames], expected[:, :frames])
+
+    audio = synth.render_note(60, 100, 1.0, LONG, channels="mono", cancel=cancelled_token(), partial=True)
+    assert audio.ndim == 1 and audio.shape[0] < int(LONG * SAMPLE_RATE)
+
+
+def test_stopped_synth_renders_again(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(pysfizz.RenderTimeout):
+        synth.render_events(HELD, LONG, timeout=0.05)
+    np.testing.assert_array_equal(synth.render_note(64, 100, 0.5, 1.0), load(sine_sfz).render_note(64, 100, 0.5, 1.0))
+
+
+def test_ensemble(sine_sfz):
+    band = pysfizz.Ensemble()
+    band.add_track(load(sine_sfz))
+    with pytest.raises(pysfizz.RenderCancelled):
+        band.render([HELD], LONG, cancel=cancelled_token())
+    with pytest.raises(pysfizz.RenderTimeout):
+        band.render([HELD], LONG, timeout=0.05)
+
+
+def test_async_cancel(sine_sfz):
+    synth = load(sine_sfz)
+
+    async def main():
+        task = asyncio.create_task(synth.render_events_async(HELD, LONG))
+        await asyncio.sleep(0.1)
+        task.cancel()
+        with pytest.raises(asyncio.CancelledError):
+            await task
+        with pytest.raises(pysfizz.RenderCancelled):
+            await synth.render_note_async(60, 100, 1.0, LONG, cancel=cancelled_token())
+        with pytest.raises(pysfizz.RenderTimeout):
+            await synth.render_note_async(60, 100, 1.0, LONG, timeout=0.05)
+        # the stopped renders free the synth for the next one
+        return await synth.render_note_async(64, 100, 0.5, 1.0)
+
+    np.testing.assert_array_equal(asyncio.run(main()), load(sine_sfz).render_note(64, 100, 0.5, 1.0))
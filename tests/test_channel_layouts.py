@@ -0,0 +1,60 @@
+import numpy as np
+import pytest
+
+from conftest import load
+
+
+@pytest.fixture
+def panned_sfz(tmp_path):
+    # left and right differ, so that every layout is told apart
+    path = tmp_path / "panned.sfz"
+    path.write_text("<region> sample=*sine pan=60 ampeg_release=0.05\n")
+    return path
+
+
+@pytest.fixture
+def stereo(panned_sfz):
+    audio = load(panned_sfz).render_note(69, 100, 0.5, 0.75)
+    assert not np.allclose(audio[0], audio[1])
+    return audio
+
+
+def test_mono(panned_sfz, stereo):
+    mono = load(panned_sfz).render_note(69, 100, 0.5, 0.75, channels="mono")
+    assert mono.shape == (stereo.shape[1],)
+    np.testing.assert_allclose(mono, (stereo[0] + stereo[1]) / 2, atol=1e-7)
+
+
+def test_mid_side(panned_sfz, stereo):
+    mid_side = load(panned_sfz).render_note(69, 100, 0.5, 0.75, channels="mid_side")
+    assert mid_side.shape == stereo.shape
+    np.testing.assert_allclose(mid_side[0], (stereo[0] + stereo[1]) / 2, atol=1e-7)
+    np.testing.assert_allclose(mid_side[1], (stereo[0] - stereo[1]) / 2, atol=1e-7)
+
+
+def test_left(panned_sfz, stereo):
+    left = load(panned_sfz).render_note(69, 100, 0.5, 0.75, channels="left")
+    np.testing.assert_array_equal(left, stereo[0])
+
+
+def test_events_use_layout(panned_sfz, stereo):
+    events = [(0.0, "note_on", 69, 100), (0.5, "note_off", 69)]
+    mono = load(panned_sfz).render_events(events, 0.75, channels="mono")
+    np.testing.assert_allclose(mono, (stereo[0] + stereo[1]) / 2, atol=1e-7)
+
+
+def test_statistics_of_converted_output(panned_sfz):
+    audio, stats = load(panned_sfz).render_note(69, 100, 0.5, 0.75, channels="mono", stats=True)
+    assert len(stats["channel_peak"]) == 1
+    assert stats["peak"] == pytest.approx(np.abs(audio).max(), rel=1e-6)
+
+
+def test_output_shape(panned_sfz):
+    synth = load(panned_sfz)
+    for channels in ("stereo", "mono", "mid_side", "left"):
+        assert synth.render_note(69, 100, 0.1, 0.2, channels=channels).shape == synth.output_shape(0.2, channels)
+
+
+def test_rejects_unknown_layout(panned_sfz):
+    with pytest.raises(ValueError):
+        load(panned_sfz).render_note(69, 100, 0.5, 0.75, channels="surround")
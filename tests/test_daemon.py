@@ -0,0 +1,98 @@
+import socket
+import tempfile
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+import numpy as np
+import pytest
+
+from conftest import load
+
+pytestmark = pytest.mark.skipif(not hasattr(socket, "AF_UNIX"), reason="Unix domain sockets are unavailable")
+
+from pysfizz.daemon import RenderClient, RenderServer  # noqa: E402
+
+EVENTS = [(0.0, "note_on", 60, 100), (0.3, "note_on", 67, 80), (0.5, "note_off", 60), (0.8, "note_off", 67)]
+
+
+@pytest.fixture
+def server():
+    # socket paths are limited to about a hundred bytes: a short directory
+    with tempfile.TemporaryDirectory(prefix="pysfizz-") as directory:
+        server = RenderServer(Path(directory) / "render.sock", workers=2, engines_per_instrument=2)
+        thread = threading.Thread(target=server.serve_forever, daemon=True)
+        thread.start()
+        deadline = time.monotonic() + 10
+        while not Path(server.socket_path).exists():
+            assert time.monotonic() < deadline, "the server did not start"
+            time.sleep(0.01)
+        yield server
+        server.shutdown()
+        thread.join(timeout=10)
+
+
+@pytest.fixture
+def client(server):
+    with RenderClient(server.socket_path) as client:
+        yield client
+
+
+def test_ping(client):
+    assert client.ping() == {"ok": True, "workers": 2}
+
+
+def test_renders_match_synth(client, sine_sfz, sample_sfz):
+    client.load(sample_sfz)
+    np.testing.assert_array_equal(client.render_note(sine_sfz, 60, 100, 0.5, 1.0),
+                                  load(sine_sfz).render_note(60, 100, 0.5, 1.0))
+    audio, stats = client.render_events(sample_sfz, EVENTS, 1.0, channels="mono", stats=True)
+    expected, expected_stats = load(sample_sfz).render_events(EVENTS, 1.0, channels="mono", stats=True)
+    np.testing.assert_array_equal(audio, expected)
+    assert stats.keys() == expected_stats.keys()
+    assert stats["peak"] == expected_stats["peak"]
+    assert stats["channel_rms"] == list(expected_stats["channel_rms"])
+
+
+def test_sample_rate_and_options(client, sine_sfz):
+    audio = client.render_note(sine_sfz, 60, 100, 0.5, 1.0, sample_rate=44100, output_sample_rate=16000)
+    assert audio.shape == (2, 16000)
+    expected = load(sine_sfz, sample_rate=44100).render_note(60, 100, 0.5, 1.0, output_sample_rate=16000)
+    np.testing.assert_array_equal(audio, expected)
+
+
+def test_concurrent_clients(server, sine_sfz):
+    expected = load(sine_sfz).render_note(60, 100, 0.5, 1.0)
+
+    def render(_):
+        with RenderClient(server.socket_path) as client:
+            return [client.render_note(sine_sfz, 60, 100, 0.5, 1.0) for _ in range(3)]
+
+    with ThreadPoolExecutor(4) as pool:
+        for results in pool.map(render, range(4)):
+            for audio in results:
+                np.testing.assert_array_equal(audio, expected)
+
+
+def test_errors_reach_the_client(client, tmp_path, sine_sfz):
+    with pytest.raises(FileNotFoundError):
+        client.render_note(tmp_path / "missing.sfz", 60, 100, 0.5, 1.0)
+    with pytest.raises(TypeError):
+        client.render_note(sine_sfz, 60, 100, 0.5, 1.0, out=None)
+    with pytest.raises(ValueError):
+        client.render_note(sine_sfz, 60, 100, 0.5, 1.0, channels="quad")
+    # the connection still serves requests after an error
+    assert client.render_note(sine_sfz, 60, 100, 0.5, 1.0).shape == (2, 48000)
+
+
+def test_audio_outlives_the_next_request(client, sine_sfz):
+    first = client.render_note(sine_sfz, 60, 100, 0.5, 1.0)
+    copy = first.copy()
+    client.render_note(sine_sfz, 72, 100, 0.5, 1.0)
+    np.testing.assert_array_equal(first, copy)
+
+
+def test_rejects_invalid_settings(tmp_path):
+    with pytest.raises(ValueError):
+        RenderServer(tmp_path / "render.sock", engines_per_instrument=0)
@@ -0,0 +1,89 @@
+import os
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load, tone, write_wav
+
+soundfile = pytest.importorskip("soundfile")
+
+EVENTS = [(0.0, "note_on", 60, 100), (0.5, "note_off", 60), (0.2, "note_on", 69, 90), (0.8, "note_off", 69)]
+
+
+@pytest.fixture
+def flac_sfz(tmp_path):
+    # a FLAC sample under a default_path, next to a WAV one
+    (tmp_path / "samples").mkdir()
+    soundfile.write(tmp_path / "samples" / "low.flac", tone(220, 1.0), 48000, subtype="PCM_16")
+    write_wav(tmp_path / "samples" / "high.wav", tone(440, 1.0))
+    path = tmp_path / "flac.sfz"
+    path.write_text("<control> default_path=samples/\n"
+                    "<region> sample=low.flac key=60 pitch_keycenter=60\n"
+                    "<region> sample=high.wav key=69 pitch_keycenter=69\n")
+    return path
+
+
+def load_decoded(path, cache):
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(path, decode_cache=cache)
+    return synth
+
+
+def test_decoded_load_renders_the_same(tmp_path, flac_sfz):
+    cache = tmp_path / "decoded"
+    synth = load_decoded(flac_sfz, cache)
+    (decoded,) = cache.iterdir()
+    assert decoded.suffix == ".wav"
+    samples = {synth._synth.get_region_data(i)["sample_id"] for i in range(synth._synth.get_num_regions())}
+    assert str(decoded) in {os.path.normpath(s) for s in samples}
+    np.testing.assert_allclose(synth.render_events(EVENTS, 1.0), load(flac_sfz).render_events(EVENTS, 1.0), atol=1e-6)
+
+
+def test_later_loads_reuse_decoded_files(tmp_path, flac_sfz):
+    cache = tmp_path / "decoded"
+    load_decoded(flac_sfz, cache)
+    (decoded,) = cache.iterdir()
+    mtime = decoded.stat().st_mtime_ns
+    load_decoded(flac_sfz, cache)
+    assert list(cache.iterdir()) == [decoded]
+    assert decoded.stat().st_mtime_ns == mtime
+
+
+def test_changed_sample_is_decoded_again(tmp_path, flac_sfz):
+    cache = tmp_path / "decoded"
+    load_decoded(flac_sfz, cache)
+    sample = flac_sfz.parent / "samples" / "low.flac"
+    soundfile.write(sample, tone(330, 0.5), 48000, subtype="PCM_16")
+    stat = sample.stat()
+    os.utime(sample, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    synth = load_decoded(flac_sfz, cache)
+    assert len(list(cache.iterdir())) == 2
+    np.testing.assert_allclose(synth.render_events(EVENTS, 1.0), load(flac_sfz).render_events(EVENTS, 1.0), atol=1e-6)
+
+
+def test_default_directory(flac_sfz):
+    load_decoded(flac_sfz, True)
+    assert len(list((pysfizz.synth.cache_dir() / "decoded").iterdir())) == 1
+
+
+def test_without_compressed_samples(tmp_path, sample_sfz):
+    cache = tmp_path / "decoded"
+    synth = load_decoded(sample_sfz, cache)
+    assert not cache.exists() or not list(cache.iterdir())
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(sample_sfz).render_events(EVENTS, 1.0))
+
+
+def test_text_reload_reuses_decoded_files(tmp_path, flac_sfz):
+    cache = tmp_path / "decoded"
+    synth = load_decoded(flac_sfz, cache)
+    (decoded,) = cache.iterdir()
+    mtime = decoded.stat().st_mtime_ns
+    flac_sfz.write_text(flac_sfz.read_text().replace("pitch_keycenter=60", "pitch_keycenter=62"))
+    stat = flac_sfz.stat()
+    os.utime(flac_sfz, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    result = synth.reload_if_changed()
+    assert result["reloaded"] and result["text_changed"] and result["changed_samples"] == []
+    assert list(cache.iterdir()) == [decoded]
+    assert decoded.stat().st_mtime_ns == mtime
+    np.testing.assert_allclose(synth.render_events(EVENTS, 1.0), load(flac_sfz).render_events(EVENTS, 1.0), atol=1e-6)
@@ -0,0 +1,71 @@
+import os
+import shutil
+import subprocess
+from pathlib import Path
+
+import pytest
+
+from conftest import load
+
+ROOT = Path(__file__).resolve().parents[1]
+
+# Builds tests/embed, a C++ program linking pysfizz::core without Python,
+# from this source tree and from an installed copy of the core found with
+# find_package. It compiles sfizz, so it only runs when asked:
+# PYSFIZZ_TEST_EMBED=1 pytest tests/test_embed.py
+pytestmark = pytest.mark.skipif(
+    not os.environ.get("PYSFIZZ_TEST_EMBED") or shutil.which("cmake") is None
+    or not (ROOT / "external" / "sfizz" / "CMakeLists.txt").is_file(),
+    reason="set PYSFIZZ_TEST_EMBED=1, with cmake and the sfizz submodule, to build the C++ embedding test",
+)
+
+
+def build_embed(build, *options):
+    subprocess.run(["cmake", "-S", str(ROOT / "tests" / "embed"), "-B", str(build),
+                    "-DCMAKE_BUILD_TYPE=Release", *options], check=True)
+    subprocess.run(["cmake", "--build", str(build), "--target", "pysfizz_embed", "--config", "Release",
+                    "--parallel"], check=True)
+    names = ["pysfizz_embed", "pysfizz_embed.exe", "Release/pysfizz_embed.exe"]
+    return next(build / name for name in names if (build / name).is_file())
+
+
+@pytest.fixture(scope="module")
+def embed(tmp_path_factory):
+    return build_embed(tmp_path_factory.mktemp("embed-build"), f"-DPYSFIZZ_SOURCE_DIR={ROOT}")
+
+
+@pytest.fixture(scope="module")
+def installed(tmp_path_factory):
+    # the core built and installed on its own, then found from a clean prefix
+    build = tmp_path_factory.mktemp("core-build")
+    prefix = tmp_path_factory.mktemp("prefix")
+    subprocess.run(["cmake", "-S", str(ROOT), "-B", str(build), "-DCMAKE_BUILD_TYPE=Release",
+                    "-DPYSFIZZ_BUILD_PYTHON=OFF", f"-DCMAKE_INSTALL_PREFIX={prefix}"], check=True)
+    subprocess.run(["cmake", "--build", str(build), "--config", "Release", "--parallel"], check=True)
+    subprocess.run(["cmake", "--install", str(build), "--config", "Release"], check=True)
+    program = build_embed(tmp_path_factory.mktemp("consumer-build"), f"-DCMAKE_PREFIX_PATH={prefix}")
+    # where Windows finds the core's DLL
+    env = {**os.environ, "PATH": os.pathsep.join([str(prefix / "bin"), os.environ.get("PATH", "")])}
+    return program, env
+
+
+def render_note(program, sfz, env=None):
+    result = subprocess.run([str(program), str(sfz)], capture_output=True, text=True, check=True, env=env)
+    return result.stdout.split()
+
+
+def test_renders_as_bindings(embed, sine_sfz):
+    frames, peak = render_note(embed, sine_sfz)
+    audio = load(sine_sfz).render_note(69, 100, 0.25, 0.5, channels="mono")
+    assert int(frames) == audio.shape[0]
+    assert float(peak) == pytest.approx(float(abs(audio).max()), abs=1e-6)
+
+
+def test_installed_core(installed, embed, sine_sfz):
+    program, env = installed
+    assert render_note(program, sine_sfz, env) == render_note(embed, sine_sfz)
+
+
+def test_reports_load_failure(embed, tmp_path):
+    result = subprocess.run([str(embed), str(tmp_path / "missing.sfz")], capture_output=True, text=True)
+    assert result.returncode == 1
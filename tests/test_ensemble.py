@@ -0,0 +1,66 @@
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load
+
+MELODY = [(0.0, "note_on", 60, 100), (0.2, "note_on", 64, 90), (0.4, "note_off", 60), (0.6, "note_off", 64)]
+BASS = [(0.1, "note_on", 36, 110), (0.7, "note_off", 36)]
+
+
+def test_single_track_matches_synth(sine_sfz):
+    band = pysfizz.Ensemble()
+    band.add_track(load(sine_sfz))
+    expected = load(sine_sfz).render_events(MELODY, 1.0)
+    np.testing.assert_allclose(band.render([MELODY], 1.0), expected, atol=1e-6)
+
+
+def test_mix_is_sum_of_stems(sine_sfz, sample_sfz):
+    band = pysfizz.Ensemble(num_threads=2)
+    band.add_track(load(sine_sfz), gain=0.5)
+    band.add_track(load(sample_sfz), gain=2.0)
+    assert band.num_tracks == 2
+    mix, stems = band.render([MELODY, BASS], 1.0, stems=True)
+    assert len(stems) == 2
+    np.testing.assert_allclose(mix, stems[0] + stems[1], atol=1e-6)
+    np.testing.assert_allclose(stems[0], 0.5 * load(sine_sfz).render_events(MELODY, 1.0), atol=1e-6)
+    np.testing.assert_allclose(stems[1], 2.0 * load(sample_sfz).render_events(BASS, 1.0), atol=1e-5)
+
+
+def test_balance(sine_sfz):
+    band = pysfizz.Ensemble()
+    band.add_track(load(sine_sfz), pan=-1.0)
+    expected = load(sine_sfz).render_events(MELODY, 1.0)
+    audio = band.render([MELODY], 1.0)
+    np.testing.assert_allclose(audio[0], expected[0], atol=1e-6)
+    assert not audio[1].any()
+    band.set_track_pan(0, 0.5)
+    band.set_track_gain(0, 0.25)
+    audio = band.render([MELODY], 1.0)
+    np.testing.assert_allclose(audio[0], 0.25 * 0.5 * expected[0], atol=1e-6)
+    np.testing.assert_allclose(audio[1], 0.25 * expected[1], atol=1e-6)
+
+
+def test_options_apply_to_mix(sine_sfz):
+    band = pysfizz.Ensemble()
+    band.add_track(load(sine_sfz))
+    mono, stats = band.render([MELODY], 1.0, channels="mono", output_sample_rate=16000, stats=True)
+    assert mono.shape == (16000,)
+    assert stats["peak"] == pytest.approx(np.abs(mono).max(), rel=1e-6)
+
+
+def test_rejects_invalid_tracks(sine_sfz):
+    band = pysfizz.Ensemble()
+    with pytest.raises(ValueError):
+        band.render([], 1.0)
+    synth = load(sine_sfz)
+    band.add_track(synth)
+    with pytest.raises(ValueError):
+        band.add_track(synth)
+    with pytest.raises(ValueError):
+        band.add_track(load(sine_sfz), pan=2.0)
+    with pytest.raises(ValueError):
+        band.render([MELODY, BASS], 1.0)
+    band.add_track(load(sine_sfz, sample_rate=44100))
+    with pytest.raises(ValueError):
+        band.render([MELODY, BASS], 1.0)
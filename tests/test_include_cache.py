@@ -0,0 +1,87 @@
+import os
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load, tone, write_wav
+
+EVENTS = [(0.0, "note_on", 60, 100), (0.5, "note_off", 60), (0.2, "note_on", 64, 90), (0.8, "note_off", 64)]
+
+
+@pytest.fixture
+def split_sfz(tmp_path):
+    # an instrument spread over nested includes, with a define and comments
+    write_wav(tmp_path / "tone.wav", tone(440, 1.0))
+    (tmp_path / "inc").mkdir()
+    (tmp_path / "inc" / "regions.sfz").write_text(
+        "// regions\n<region> sample=tone.wav key=$LOW pitch_keycenter=$LOW\n#include \"inc/more.sfz\"\n")
+    (tmp_path / "inc" / "more.sfz").write_text("<region> sample=*sine key=64 /* generated */\n")
+    path = tmp_path / "split.sfz"
+    path.write_text("#define $LOW 60\n<group> ampeg_release=0.05\n#include \"inc/regions.sfz\"\n")
+    return path
+
+
+def load_cached(path, cache):
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(path, include_cache=cache)
+    return synth
+
+
+def touch(path):
+    stat = path.stat()
+    os.utime(path, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+
+
+def test_cached_load_renders_the_same(tmp_path, split_sfz):
+    cache = tmp_path / "cache"
+    synth = load_cached(split_sfz, cache)
+    (compiled,) = cache.iterdir()
+    assert compiled.suffix == ".sfzc"
+    assert synth._synth.get_num_regions() == 2
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(split_sfz).render_events(EVENTS, 1.0))
+
+    # later loads read the copy as it is
+    mtime = compiled.stat().st_mtime_ns
+    synth = load_cached(split_sfz, cache)
+    assert compiled.stat().st_mtime_ns == mtime
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(split_sfz).render_events(EVENTS, 1.0))
+
+
+def test_changed_include_rebuilds_the_copy(tmp_path, split_sfz):
+    cache = tmp_path / "cache"
+    load_cached(split_sfz, cache)
+    more = split_sfz.parent / "inc" / "more.sfz"
+    more.write_text("<region> sample=*saw key=64\n")
+    touch(more)
+    synth = load_cached(split_sfz, cache)
+    assert len(list(cache.iterdir())) == 1
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(split_sfz).render_events(EVENTS, 1.0))
+
+
+def test_touched_include_keeps_the_copy(tmp_path, split_sfz):
+    cache = tmp_path / "cache"
+    load_cached(split_sfz, cache)
+    touch(split_sfz.parent / "inc" / "regions.sfz")
+    synth = load_cached(split_sfz, cache)
+    (compiled,) = cache.iterdir()
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(split_sfz).render_events(EVENTS, 1.0))
+    # the new time was recorded: the next load does not hash the file again
+    mtime = compiled.stat().st_mtime_ns
+    load_cached(split_sfz, cache)
+    assert compiled.stat().st_mtime_ns == mtime
+
+
+def test_default_directory(split_sfz):
+    load_cached(split_sfz, True)
+    assert len(list(pysfizz.synth.cache_dir().glob("*.sfzc"))) == 1
+
+
+def test_corrupt_copy_is_rebuilt(tmp_path, split_sfz):
+    cache = tmp_path / "cache"
+    load_cached(split_sfz, cache)
+    (compiled,) = cache.iterdir()
+    compiled.write_bytes(compiled.read_bytes()[:10])
+    synth = load_cached(split_sfz, cache)
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), load(split_sfz).render_events(EVENTS, 1.0))
+    assert compiled.stat().st_size > 10
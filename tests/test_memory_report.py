@@ -0,0 +1,104 @@
+import sys
+
+import pytest
+
+import pysfizz
+from pysfizz.shared_samples import STREAMING_PRELOAD_SIZE
+from conftest import SAMPLE_RATE, load, tone
+
+KEYS = {"samples", "sample_bytes", "block_buffer_bytes", "voice_bytes", "effect_buses", "effect_bus_bytes",
+        "streaming_bytes", "replicas", "replica_bytes", "voices", "active_voices", "total_bytes",
+        "shared_bytes", "registry_bytes", "rss_bytes"}
+COMPONENTS = ("sample_bytes", "block_buffer_bytes", "voice_bytes", "effect_bus_bytes", "replica_bytes")
+
+# voices render into a stereo block each, plus sfizz's pool of 6 mono and 4 stereo block buffers
+# (bufferPoolSize and stereoBufferPoolSize in sfizz's Config.h)
+POOL_BUFFERS = 6 + 2 * 4
+
+
+def test_keys_and_total(sample_sfz):
+    report = load(sample_sfz).memory_report()
+    assert set(report) == KEYS
+    assert report["total_bytes"] == sum(report[key] for key in COMPONENTS)
+
+
+def test_samples(sample_sfz):
+    synth = load(sample_sfz)
+    report = synth.memory_report()
+    assert list(report["samples"]) == ["tone.wav"]
+    assert report["sample_bytes"] == sum(report["samples"].values()) == synth.get_sample_memory() > 0
+    # the tone is one second of mono audio: what is not preloaded is streamed
+    assert report["sample_bytes"] + report["streaming_bytes"] == SAMPLE_RATE * 4
+
+
+def test_streaming_load_streams_more(sample_sfz):
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(sample_sfz, streaming=True)
+    report = synth.memory_report()
+    assert report["sample_bytes"] == STREAMING_PRELOAD_SIZE * 4
+    assert report["streaming_bytes"] == (SAMPLE_RATE - STREAMING_PRELOAD_SIZE) * 4
+
+
+def test_generated_samples(sine_sfz):
+    report = load(sine_sfz).memory_report()
+    assert report["samples"] == {}
+    assert report["sample_bytes"] == report["streaming_bytes"] == 0
+
+
+@pytest.mark.parametrize("block_size", [256, 1024])
+def test_buffers_follow_voices_and_block_size(sine_sfz, block_size):
+    synth = load(sine_sfz, block_size=block_size)
+    synth.set_num_voices(32)
+    report = synth.memory_report()
+    assert report["voices"] == 32
+    assert report["block_buffer_bytes"] >= 2 * block_size * 4
+    assert report["voice_bytes"] == (2 * 32 + POOL_BUFFERS) * block_size * 4
+    synth.set_num_voices(64)
+    assert synth.memory_report()["voice_bytes"] - report["voice_bytes"] == 2 * 32 * block_size * 4
+
+
+def test_effect_buses(tmp_path, sine_sfz):
+    plain = load(sine_sfz).memory_report()
+    # the main bus is always there
+    assert plain["effect_buses"] >= 1
+    path = tmp_path / "effects.sfz"
+    path.write_text("<effect> bus=fx1 type=lofi\n<region> sample=*sine effect1=50\n")
+    report = load(path).memory_report()
+    assert report["effect_buses"] == plain["effect_buses"] + 1
+    assert report["effect_bus_bytes"] == report["effect_buses"] * 4 * 1024 * 4
+
+
+def test_replicas(sine_sfz):
+    synth = load(sine_sfz)
+    assert synth.memory_report()["replicas"] == 0
+    events = [(0.0, "note_on", 60, 100), (0.2, "note_off", 60), (2.0, "note_on", 64, 100), (2.2, "note_off", 64)]
+    synth.render_events(events, 3.0, time_slices=2, slice_margin=0.2)
+    report = synth.memory_report()
+    assert report["replicas"] == 1
+    assert report["replica_bytes"] == load(sine_sfz).memory_report()["total_bytes"]
+
+
+def test_shared_copies(tmp_path, sample_sfz):
+    assert load(sample_sfz).memory_report()["shared_bytes"] == 0
+
+    with pysfizz.SampleBank() as bank:
+        bank.add("tone.wav", tone(440, 1.0), sample_rate=SAMPLE_RATE)
+        synth = pysfizz.Synth()
+        assert synth.load_sfz_string("<region> sample=tone.wav", samples=bank)
+        assert synth.memory_report()["shared_bytes"] == bank.nbytes()
+
+    pack = pysfizz.pack_instrument(sample_sfz, tmp_path / "tone.tar")
+    synth = load(pack)
+    _, lease = pysfizz.open_instrument(pack)
+    with lease:
+        assert synth.memory_report()["shared_bytes"] == pysfizz.packs.lease_size(lease) > 0
+    # loading something else lets go of the copy
+    assert synth.load_sfz_file(sample_sfz)
+    assert synth.memory_report()["shared_bytes"] == 0
+
+
+def test_process_memory(sample_sfz):
+    report = load(sample_sfz).memory_report()
+    assert report["registry_bytes"] == pysfizz.instrument_registry().memory()
+    if sys.platform.startswith("linux"):
+        assert report["rss_bytes"] > report["total_bytes"]
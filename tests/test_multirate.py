@@ -0,0 +1,77 @@
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load
+
+
+@pytest.fixture
+def multi(sine_sfz):
+    synth = pysfizz.MultiRateSynth(block_size=512, num_voices=16)
+    assert synth.load_sfz_file(sine_sfz)
+    return synth
+
+
+def test_no_engine_before_a_rate_is_used(multi):
+    assert multi.sample_rates == []
+
+
+def test_renders_at_each_rate(multi, sine_sfz):
+    for rate in (22050, 44100, 48000):
+        audio = multi.render_note(rate, 69, 100, 0.25, 0.5)
+        np.testing.assert_array_equal(audio, load(sine_sfz, sample_rate=rate, block_size=512).render_note(69, 100, 0.25, 0.5))
+    assert multi.sample_rates == [22050, 44100, 48000]
+
+
+def test_render_events_at_each_rate(multi, sine_sfz):
+    events = [(0.0, "note_on", 60, 100), (0.1, "note_on", 67, 90), (0.3, "note_off", 60), (0.4, "note_off", 67)]
+    for rate in (16000, 48000):
+        audio = multi.render_events(rate, events, 0.6, channels="mono")
+        expected = load(sine_sfz, sample_rate=rate, block_size=512).render_events(events, 0.6, channels="mono")
+        np.testing.assert_array_equal(audio, expected)
+    assert multi.sample_rates == [16000, 48000]
+
+
+def test_engine_per_rate_is_kept(multi):
+    engine = multi.engine(44100)
+    assert multi.engine(44100) is engine
+    assert engine.get_sample_rate() == 44100
+    assert engine.get_block_size() == 512
+    assert engine.get_num_voices() == 16
+    multi.release(44100)
+    assert multi.sample_rates == []
+    assert multi.engine(44100) is not engine
+
+
+def test_playable_keys_use_an_existing_engine(multi):
+    multi.engine(44100)
+    assert multi.playable_keys == list(range(128))
+    assert multi.sample_rates == [44100]
+
+
+def test_playable_keys_load_one_engine(multi):
+    assert multi.playable_keys == list(range(128))
+    assert multi.sample_rates == [48000]
+
+
+def test_load_reloads_existing_engines(multi, tmp_path):
+    multi.engine(44100)
+    other = tmp_path / "keys.sfz"
+    other.write_text("<region> sample=*sine lokey=60 hikey=72\n")
+    assert multi.load_sfz_file(other)
+    assert multi.sample_rates == [44100]
+    assert multi.engine(44100).playable_keys == list(range(60, 73))
+
+
+def test_rejects_invalid_use(sine_sfz, tmp_path):
+    multi = pysfizz.MultiRateSynth()
+    with pytest.raises(ValueError):
+        multi.engine(48000)
+    with pytest.raises(FileNotFoundError):
+        multi.load_sfz_file(tmp_path / "missing.sfz")
+    (tmp_path / "notes.txt").write_text("")
+    with pytest.raises(ValueError):
+        multi.load_sfz_file(tmp_path / "notes.txt")
+    assert multi.load_sfz_file(sine_sfz)
+    with pytest.raises(ValueError):
+        multi.engine(0)
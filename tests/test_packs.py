@@ -0,0 +1,178 @@
+import io
+import os
+import tarfile
+import zipfile
+from pathlib import Path
+
+import numpy as np
+import pytest
+
+import pysfizz
+from pysfizz.packs import lease_size
+from pysfizz.shared_samples import shared_root
+from conftest import load, tone, write_wav
+
+try:
+    import fcntl
+except ImportError:
+    fcntl = None
+
+needs_flock = pytest.mark.skipif(fcntl is None, reason="copies are only collected where flock exists")
+
+EVENTS = [(0.0, "note_on", 69, 100), (0.5, "note_off", 69), (0.2, "note_on", 72, 90), (0.8, "note_off", 72)]
+
+
+@pytest.fixture
+def instrument(tmp_path):
+    # an SFZ file with an include and samples in subdirectories
+    root = tmp_path / "inst"
+    (root / "samples").mkdir(parents=True)
+    write_wav(root / "samples" / "a.wav", tone(440, 1.0))
+    write_wav(root / "samples" / "b.wav", tone(660, 1.0))
+    (root / "regions.sfz").write_text("<region> sample=samples/b.wav key=72 pitch_keycenter=72\n")
+    path = root / "inst.sfz"
+    path.write_text('<region> sample=samples/a.wav key=69 pitch_keycenter=69\n#include "regions.sfz"\n')
+    return path
+
+
+def render(synth):
+    return synth.render_events(EVENTS, 1.0)
+
+
+def zip_instrument(sfz, pack, compression=zipfile.ZIP_STORED):
+    root = sfz.parent
+    with zipfile.ZipFile(pack, "w", compression) as archive:
+        for file in sorted(root.rglob("*")):
+            if file.is_file():
+                archive.write(file, file.relative_to(root).as_posix())
+    return pack
+
+
+def unpacked_copies():
+    return sorted(p for p in shared_root().iterdir() if not p.name.startswith("."))
+
+
+def test_tar_pack_plays_like_the_directory(tmp_path, instrument):
+    pack = pysfizz.pack_instrument(instrument, tmp_path / "inst.tar")
+    with tarfile.open(pack) as archive:
+        assert sorted(archive.getnames()) == [".instrument", "inst.sfz", "regions.sfz", "samples/a.wav", "samples/b.wav"]
+    synth = load(pack)
+    assert Path(synth.path).is_relative_to(shared_root())
+    np.testing.assert_array_equal(render(synth), render(load(instrument)))
+
+
+def test_default_pack_path(instrument):
+    assert pysfizz.pack_instrument(instrument) == str(instrument.with_suffix(".tar"))
+
+
+@pytest.mark.parametrize("compression", [zipfile.ZIP_STORED, zipfile.ZIP_DEFLATED])
+def test_zip_pack(tmp_path, instrument, compression):
+    pack = zip_instrument(instrument, tmp_path / "inst.zip", compression)
+    np.testing.assert_array_equal(render(load(pack)), render(load(instrument)))
+
+
+def test_unpacked_once(tmp_path, instrument):
+    pack = pysfizz.pack_instrument(instrument, tmp_path / "inst.tar")
+    first = pysfizz.unpack_instrument(pack)
+    assert pysfizz.unpack_instrument(pack) == first
+    assert len(unpacked_copies()) == 1
+
+
+def test_members(tmp_path, instrument):
+    # no .instrument marker and two SFZ files: the member must be named
+    pack = zip_instrument(instrument, tmp_path / "inst.zip")
+    with pytest.raises(ValueError):
+        pysfizz.unpack_instrument(pack)
+    sfz = pysfizz.unpack_instrument(pack, "regions.sfz")
+    assert Path(sfz).name == "regions.sfz"
+    with pytest.raises(FileNotFoundError):
+        pysfizz.unpack_instrument(pack, "missing.sfz")
+
+
+@pytest.mark.parametrize("name", ["../escape.sfz", "/absolute.sfz"])
+def test_unsafe_members(tmp_path, name):
+    data = b"<region> sample=*sine\n"
+    pack = tmp_path / "evil.tar"
+    with tarfile.open(pack, "w:") as archive:
+        info = tarfile.TarInfo(name)
+        info.size = len(data)
+        archive.addfile(info, io.BytesIO(data))
+    with pytest.raises(ValueError):
+        pysfizz.unpack_instrument(pack)
+    assert not (tmp_path / "escape.sfz").exists()
+
+
+def test_not_a_pack(tmp_path, instrument):
+    with pytest.raises(ValueError):
+        load(instrument.parent / "samples" / "a.wav")
+    garbage = tmp_path / "garbage.tar"
+    garbage.write_bytes(b"not an archive" * 100)
+    with pytest.raises(ValueError):
+        pysfizz.unpack_instrument(garbage)
+    compressed = tmp_path / "inst.tar"
+    with tarfile.open(compressed, "w:gz") as archive:
+        archive.add(instrument, "inst.sfz")
+    with pytest.raises(ValueError):
+        pysfizz.unpack_instrument(compressed)
+
+
+def test_open_instrument_lease(tmp_path, instrument):
+    pack = pysfizz.pack_instrument(instrument, tmp_path / "inst.tar")
+    sfz, lease = pysfizz.open_instrument(pack)
+    try:
+        directory = Path(sfz).parent
+        # every member, without the marker the lease is held on
+        assert lease_size(lease) == sum(f.stat().st_size for f in directory.rglob("*")
+                                        if f.is_file() and f.name != ".pack")
+    finally:
+        lease.close()
+
+
+@needs_flock
+def test_budget_collects_unleased_copies(tmp_path, instrument, monkeypatch):
+    monkeypatch.setenv("PYSFIZZ_PACK_BUDGET", "0")
+    first = pysfizz.pack_instrument(instrument, tmp_path / "first.tar")
+    second = pysfizz.pack_instrument(instrument, tmp_path / "second.tar")
+    pysfizz.unpack_instrument(first)
+    pysfizz.unpack_instrument(second)
+    # only the copy just unpacked is kept
+    (copy,) = unpacked_copies()
+    assert copy.name.startswith("second")
+
+
+@needs_flock
+def test_leased_copies_are_kept(tmp_path, instrument, monkeypatch):
+    monkeypatch.setenv("PYSFIZZ_PACK_BUDGET", "0")
+    first = pysfizz.pack_instrument(instrument, tmp_path / "first.tar")
+    second = pysfizz.pack_instrument(instrument, tmp_path / "second.tar")
+    synth = load(first)
+    expected = render(synth)
+    pysfizz.unpack_instrument(second)
+    assert len(unpacked_copies()) == 2
+    np.testing.assert_array_equal(render(synth), expected)
+    # loading something else gives the lease back
+    assert synth.load_sfz_file(instrument)
+    pysfizz.unpack_instrument(second)
+    assert len(unpacked_copies()) == 1
+
+
+@needs_flock
+def test_changed_pack_replaces_its_copy(tmp_path, instrument):
+    pack = pysfizz.pack_instrument(instrument, tmp_path / "inst.tar")
+    old = Path(pysfizz.unpack_instrument(pack)).parent
+    instrument.write_text("<region> sample=samples/a.wav key=69 pitch_keycenter=57\n")
+    pysfizz.pack_instrument(instrument, pack)
+    stat = os.stat(pack)
+    os.utime(pack, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    synth = load(pack)
+    assert not old.exists()
+    assert len(unpacked_copies()) == 1
+    np.testing.assert_array_equal(render(synth), render(load(instrument)))
+
+
+def test_remove_unpacked(tmp_path, instrument):
+    pack = pysfizz.pack_instrument(instrument, tmp_path / "inst.tar")
+    pysfizz.unpack_instrument(pack)
+    pysfizz.remove_unpacked(pack)
+    assert unpacked_copies() == []
+    pysfizz.remove_unpacked(pack)  # nothing left to remove
@@ -0,0 +1,28 @@
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load
+
+
+def test_build_reports_pgo():
+    assert isinstance(pysfizz._sfizz.pgo, bool)
+    # pgo is only set when the profile data was found after training
+    assert pysfizz._sfizz.pgo == (pysfizz._sfizz.pgo_profiles > 0)
+
+
+@pytest.mark.skipif(not pysfizz._sfizz.pgo, reason="not a PGO build")
+def test_pgo_build_used_profiles():
+    assert pysfizz._sfizz.pgo_profiles > 0
+
+
+def test_trained_paths_render_as_documented(sample_sfz, sine_sfz):
+    # the paths pgo_train.cpp trains: file-backed and generated samples,
+    # held notes, the sustain pedal and pitch wheel, through render_events
+    events = [(0.0, "cc", 64, 127), (0.0, "note_on", 60, 100), (0.2, "pitch_wheel", 4096),
+              (0.3, "note_off", 60), (0.6, "cc", 64, 0), (0.6, "pitch_wheel", 0)]
+    for path in (sample_sfz, sine_sfz):
+        audio = load(path).render_events(events, 1.0)
+        assert np.isfinite(audio).all()
+        assert np.abs(audio[:, :int(0.5 * 48000)]).max() > 0.01
+        np.testing.assert_array_equal(load(path).render_events(events, 1.0), audio)
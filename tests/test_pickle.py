@@ -0,0 +1,71 @@
+import pickle
+from concurrent.futures import ProcessPoolExecutor
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load
+
+EVENTS = [(0.0, "note_on", 69, 100), (0.4, "note_off", 69), (0.2, "note_on", 64, 90), (0.6, "note_off", 64)]
+
+
+def render(synth):
+    return synth.render_events(EVENTS, 1.0)
+
+
+def configured(path):
+    synth = load(path, sample_rate=44100, block_size=256)
+    synth.set_num_voices(32)
+    synth.set_sample_quality(3)
+    synth.set_oscillator_quality(2)
+    cc_values = list(synth._synth.get_cc_values())
+    cc_values[7] = 0.75
+    cc_values[10] = 0.25
+    synth._synth.set_controllers(cc_values, 0.5)
+    return synth
+
+
+def test_round_trip_keeps_configuration(sample_sfz):
+    synth = configured(sample_sfz)
+    copy = pickle.loads(pickle.dumps(synth))
+    assert copy.__getstate__() == synth.__getstate__()
+    assert copy.path == synth.path
+    assert copy.playable_keys == synth.playable_keys
+
+
+def test_round_trip_renders_the_same(sample_sfz):
+    synth = configured(sample_sfz)
+    copy = pickle.loads(pickle.dumps(synth))
+    np.testing.assert_array_equal(render(copy), render(configured(sample_sfz)))
+
+
+def test_string_source(tmp_path, sample_sfz):
+    synth = pysfizz.Synth()
+    text = sample_sfz.read_text()
+    assert synth.load_sfz_string(text, tmp_path / "virtual.sfz")
+    copy = pickle.loads(pickle.dumps(synth))
+    assert copy.__getstate__()["source"] == {"text": text, "virtual_path": str(tmp_path / "virtual.sfz")}
+    np.testing.assert_array_equal(render(copy), render(load(sample_sfz)))
+
+
+def test_empty_synth():
+    copy = pickle.loads(pickle.dumps(pysfizz.Synth(sample_rate=22050)))
+    assert copy.path is None
+    assert copy.get_sample_rate() == 22050
+
+
+def test_missing_instrument(tmp_path, sample_sfz):
+    data = pickle.dumps(load(sample_sfz))
+    sample_sfz.unlink()
+    with pytest.raises(FileNotFoundError):
+        pickle.loads(data)
+
+
+def test_process_pool(sample_sfz):
+    synth = load(sample_sfz)
+    with ProcessPoolExecutor(2) as pool:
+        results = list(pool.map(render, [synth, synth]))
+    expected = render(load(sample_sfz))
+    for audio in results:
+        np.testing.assert_array_equal(audio, expected)
@@ -0,0 +1,91 @@
+import asyncio
+import sys
+
+import pytest
+
+import pysfizz
+from conftest import SAMPLE_RATE, load
+
+EVENTS = [(0.0, "note_on", 60, 100), (0.5, "note_off", 60), (2.0, "note_on", 64, 100), (2.5, "note_off", 64)]
+
+
+def test_render_counts(sine_sfz):
+    synth = load(sine_sfz)
+    progress = pysfizz.Progress()
+    assert progress.fraction == 0.0
+    synth.render_note(60, 100, 0.5, 1.0, progress=progress)
+    assert progress.frames_total == progress.frames_done == SAMPLE_RATE
+    assert progress.jobs_total == progress.jobs_done == 1
+    assert progress.fraction == 1.0
+
+    # totals add up over renders, counted at the output rate
+    synth.render_events(EVENTS, 3.0, output_sample_rate=16000, progress=progress)
+    assert progress.frames_total == progress.frames_done == SAMPLE_RATE + 3 * 16000
+    assert progress.jobs_total == progress.jobs_done == 2
+
+    progress.reset()
+    assert (progress.frames_total, progress.frames_done, progress.jobs_total, progress.jobs_done) == (0, 0, 0, 0)
+
+
+def test_time_slices(sine_sfz):
+    progress = pysfizz.Progress()
+    load(sine_sfz).render_events(EVENTS, 3.0, time_slices=2, slice_margin=0.2, progress=progress)
+    assert progress.frames_total == progress.frames_done == 3 * SAMPLE_RATE
+
+
+def test_time_slices_count_up(sine_sfz):
+    seen = []
+    progress = pysfizz.Progress(lambda p: seen.append(p.frames_done), interval=0.0)
+    load(sine_sfz).render_events(EVENTS, 3.0, time_slices=2, slice_margin=0.2, output_sample_rate=44100,
+                                 progress=progress)
+    assert seen[-1] == 3 * 44100
+    assert seen == sorted(seen)
+
+
+def test_callback_sees_final_counts(sine_sfz):
+    seen = []
+    progress = pysfizz.Progress(lambda p: seen.append((p.frames_done, p.jobs_done)), interval=0.0)
+    load(sine_sfz).render_note(60, 100, 0.5, 1.0, progress=progress)
+    assert seen
+    assert seen[-1] == (SAMPLE_RATE, 1)
+    assert [frames for frames, _ in seen] == sorted(frames for frames, _ in seen)
+
+
+def test_callback_errors_do_not_stop_the_render(sine_sfz, monkeypatch):
+    def fail(progress):
+        raise RuntimeError("callback failed")
+
+    unraisable = []
+    monkeypatch.setattr(sys, "unraisablehook", unraisable.append)
+    progress = pysfizz.Progress(fail, interval=0.0)
+    audio = load(sine_sfz).render_note(60, 100, 0.5, 1.0, progress=progress)
+    assert audio.shape == (2, SAMPLE_RATE)
+    assert unraisable and isinstance(unraisable[0].exc_value, RuntimeError)
+    assert progress.frames_done == SAMPLE_RATE
+
+
+def test_async(sine_sfz):
+    synth = load(sine_sfz)
+    progress = pysfizz.Progress()
+
+    async def main():
+        await asyncio.gather(*(synth.render_note_async(p, 100, 0.5, 1.0, progress=progress) for p in (60, 64, 67)))
+
+    asyncio.run(main())
+    assert progress.frames_total == progress.frames_done == 3 * SAMPLE_RATE
+    assert progress.jobs_done == 3
+
+
+def test_load_counts_sample_bytes(sample_sfz, sine_sfz):
+    progress = pysfizz.Progress()
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(sample_sfz, progress=progress)
+    assert progress.bytes_loaded == (sample_sfz.parent / "tone.wav").stat().st_size
+    # generated samples read nothing
+    assert synth.load_sfz_file(sine_sfz, progress=progress)
+    assert progress.bytes_loaded == (sample_sfz.parent / "tone.wav").stat().st_size
+
+
+def test_invalid_interval():
+    with pytest.raises(ValueError):
+        pysfizz.Progress(lambda p: None, interval=-1.0)
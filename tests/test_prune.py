@@ -0,0 +1,102 @@
+import pickle
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load, tone, write_wav
+
+ATTACKS = ("<region> sample=a.wav key=60 pitch_keycenter=60\n"
+           "<region> sample=b.wav key=62 pitch_keycenter=62\n")
+RELEASES = "<region> sample=r.wav key=60 trigger=release_key\n<region> sample=b.wav key=62 trigger=release_key\n"
+EVENTS = [(0.0, "note_on", 60, 100), (0.3, "note_off", 60), (0.4, "note_on", 62, 90), (0.7, "note_off", 62)]
+
+
+@pytest.fixture
+def layered(tmp_path):
+    # attack regions, and release regions of which one shares a sample with an attack
+    for name, frequency in (("a", 220), ("b", 330), ("r", 880)):
+        write_wav(tmp_path / f"{name}.wav", tone(frequency, 1.0))
+    (tmp_path / "attacks.sfz").write_text(ATTACKS)
+    path = tmp_path / "layered.sfz"
+    path.write_text(ATTACKS + RELEASES)
+    return path
+
+
+def regions(synth):
+    return [synth._synth.get_region_data(i) for i in range(synth._synth.get_num_regions())]
+
+
+def test_pruned_synth_plays_the_rest(layered):
+    synth = load(layered)
+    attacks = load(layered.parent / "attacks.sfz")
+    freed = synth.prune_regions(lambda r: r["trigger"] == "release_key")
+    assert [r["trigger"] for r in regions(synth)] == ["attack", "attack"]
+    # only r.wav is no longer used
+    assert freed == load(layered).get_sample_memory() - attacks.get_sample_memory() > 0
+    assert synth.get_sample_memory() == attacks.get_sample_memory()
+    assert synth.playable_keys == [60, 62]
+    np.testing.assert_array_equal(synth.render_events(EVENTS, 1.0), attacks.render_events(EVENTS, 1.0))
+
+
+def test_nothing_to_prune(layered):
+    synth = load(layered)
+    before = synth.get_sample_memory()
+    assert synth.prune_regions(lambda r: False) == 0
+    assert synth.get_sample_memory() == before
+    assert len(regions(synth)) == 4
+
+
+def test_prune_by_sample(layered):
+    synth = load(layered)
+    synth.prune_regions(lambda r: r["sample_id"].endswith("b.wav"))
+    assert {r["sample_id"] for r in regions(synth)} == {"a.wav", "r.wav"}
+    assert synth.playable_keys == [60]
+
+
+def test_regions_dropped_by_sfizz_keep_their_ids(tmp_path, layered):
+    # the first region names a missing sample: sfizz drops it, but it keeps its place
+    path = tmp_path / "missing.sfz"
+    path.write_text("<region> sample=missing.wav key=64\n" + ATTACKS)
+    synth = load(path)
+    assert [r["id"] for r in regions(synth)] == [1, 2]
+    synth.prune_regions(lambda r: r["id"] == 2)
+    assert [r["sample_id"] for r in regions(synth)] == ["a.wav"]
+
+
+def test_pruned_instrument_survives_pickling(layered):
+    synth = load(layered)
+    synth.prune_regions(lambda r: r["trigger"] == "release_key")
+    copy = pickle.loads(pickle.dumps(synth))
+    assert len(regions(copy)) == 2
+    assert copy.get_sample_memory() == synth.get_sample_memory()
+    np.testing.assert_array_equal(copy.render_events(EVENTS, 1.0), synth.render_events(EVENTS, 1.0))
+
+
+def test_prune_twice(layered):
+    synth = load(layered)
+    synth.prune_regions(lambda r: r["trigger"] == "release_key")
+    synth.prune_regions(lambda r: r["sample_id"] == "b.wav")
+    assert [r["sample_id"] for r in regions(synth)] == ["a.wav"]
+
+
+def test_requires_an_instrument():
+    with pytest.raises(ValueError):
+        pysfizz.Synth().prune_regions(lambda r: True)
+
+
+def test_pruned_instrument_is_not_reloaded(layered):
+    synth = load(layered)
+    synth.prune_regions(lambda r: r["trigger"] == "release_key")
+    with pytest.raises(ValueError):
+        synth.reload_if_changed()
+    assert synth.load_sfz_file(layered)
+    assert len(regions(synth)) == 4
+
+
+def test_changed_files_are_not_pruned(layered):
+    synth = load(layered)
+    layered.write_text(ATTACKS)
+    with pytest.raises(RuntimeError):
+        synth.prune_regions(lambda r: r["trigger"] == "release_key")
+    assert len(regions(synth)) == 4
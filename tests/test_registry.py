@@ -0,0 +1,165 @@
+import os
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load, tone, write_wav
+
+
+@pytest.fixture
+def instruments(tmp_path):
+    # two instruments holding sample data
+    paths = []
+    for name, duration in (("a", 1.0), ("b", 2.0)):
+        write_wav(tmp_path / f"{name}.wav", tone(440, duration))
+        path = tmp_path / f"{name}.sfz"
+        path.write_text(f"<region> sample={name}.wav pitch_keycenter=69\n")
+        paths.append(path)
+    return paths
+
+
+def entry(registry, path):
+    (found,) = [e for e in registry.report() if e["path"] == str(path.resolve())]
+    return found
+
+
+def test_idle_synth_is_lent_again(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as first:
+        audio = first.render_note(69, 100, 0.5, 1.0)
+    with registry.borrow(instruments[0]) as second:
+        assert second is first
+        np.testing.assert_array_equal(second.render_note(69, 100, 0.5, 1.0), audio)
+    np.testing.assert_array_equal(audio, load(instruments[0]).render_note(69, 100, 0.5, 1.0))
+    report = entry(registry, instruments[0])
+    assert (report["loads"], report["hits"], report["synths"], report["idle"], report["in_use"]) == (1, 1, 1, 1, 0)
+    assert report["bytes"] == registry.memory() == first.get_sample_memory() > 0
+
+
+def test_concurrent_borrows_load_separate_synths(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as first, registry.borrow(instruments[0]) as second:
+        assert second is not first
+        assert entry(registry, instruments[0])["in_use"] == 2
+    assert entry(registry, instruments[0])["idle"] == 2
+
+
+def test_keys(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as first:
+        pass
+    with registry.borrow(instruments[0], sample_rate=44100) as other:
+        assert other is not first
+        assert other.get_sample_rate() == 44100
+    assert len(registry.report()) == 2
+
+
+def test_eviction_under_budget(instruments):
+    registry = pysfizz.InstrumentRegistry(budget=load(instruments[1]).get_sample_memory())
+    with registry.borrow(instruments[0]):
+        pass
+    with registry.borrow(instruments[1]):
+        pass
+    # the least recently used synth went to make room
+    assert entry(registry, instruments[0])["synths"] == 0
+    assert entry(registry, instruments[1])["synths"] == 1
+    assert registry.memory() <= registry.budget
+    assert [e["path"] for e in registry.report()] == [str(p.resolve()) for p in reversed(instruments)]
+
+
+def test_synths_in_use_are_kept(instruments):
+    registry = pysfizz.InstrumentRegistry(budget=0)
+    with registry.borrow(instruments[0]) as synth:
+        assert registry.memory() == synth.get_sample_memory() > 0
+        synth.render_note(69, 100, 0.5, 1.0)
+    assert registry.memory() == 0
+
+
+def test_changed_file_is_loaded_again(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as first:
+        pass
+    instruments[0].write_text("<region> sample=a.wav pitch_keycenter=57\n")
+    stat = instruments[0].stat()
+    os.utime(instruments[0], ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    with registry.borrow(instruments[0]) as second:
+        assert second is not first
+        np.testing.assert_array_equal(second.render_note(57, 100, 0.5, 1.0),
+                                      load(instruments[0]).render_note(57, 100, 0.5, 1.0))
+    assert entry(registry, instruments[0])["loads"] == 2
+    assert entry(registry, instruments[0])["synths"] == 1
+
+
+@pytest.mark.parametrize("changed", ["include", "sample"])
+def test_changed_include_or_sample_is_loaded_again(tmp_path, changed):
+    write_wav(tmp_path / "tone.wav", tone(440, 1.0))
+    (tmp_path / "release.sfz").write_text("ampeg_release=0.05\n")
+    path = tmp_path / "inst.sfz"
+    path.write_text('<region> sample=tone.wav pitch_keycenter=69\n#include "release.sfz"\n')
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(path) as first:
+        pass
+    if changed == "include":
+        (tmp_path / "release.sfz").write_text("ampeg_release=0.5\n")
+    else:
+        write_wav(tmp_path / "tone.wav", tone(440, 0.5, amplitude=0.25))
+    changed_file = tmp_path / ("release.sfz" if changed == "include" else "tone.wav")
+    stat = changed_file.stat()
+    os.utime(changed_file, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+    with registry.borrow(path) as second:
+        assert second is not first
+        np.testing.assert_array_equal(second.render_note(69, 100, 0.5, 1.0), load(path).render_note(69, 100, 0.5, 1.0))
+    assert entry(registry, path)["loads"] == 2
+    assert entry(registry, path)["synths"] == 1
+
+
+def test_changed_synths_are_dropped(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as synth:
+        synth.set_num_voices(8)
+    with registry.borrow(instruments[0]) as synth:
+        assert synth.load_sfz_file(instruments[1])
+    assert entry(registry, instruments[0])["synths"] == 0
+    assert registry.memory() == 0
+
+
+def test_returned_synths_are_reset(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as synth:
+        cc_values = [0.5] * 128
+        synth._synth.set_controllers(cc_values, 0.25)
+    with registry.borrow(instruments[0]) as again:
+        assert again is synth
+        assert again._synth.get_pitch_wheel_value() == 0.0
+        np.testing.assert_array_equal(again.render_note(69, 100, 0.5, 1.0),
+                                      load(instruments[0]).render_note(69, 100, 0.5, 1.0))
+
+
+def test_clear(instruments):
+    registry = pysfizz.InstrumentRegistry()
+    with registry.borrow(instruments[0]) as first:
+        with registry.borrow(instruments[1]):
+            pass
+        registry.clear()
+        assert registry.memory() == first.get_sample_memory()
+    assert registry.memory() == 0
+    with registry.borrow(instruments[0]) as again:
+        assert again is not first
+
+
+def test_errors(tmp_path):
+    with pytest.raises(ValueError):
+        pysfizz.InstrumentRegistry(budget=-1)
+    registry = pysfizz.InstrumentRegistry()
+    with pytest.raises(FileNotFoundError):
+        registry.acquire(tmp_path / "missing.sfz")
+    empty = tmp_path / "empty.sfz"
+    empty.write_text("// no regions\n")
+    with pytest.raises(RuntimeError):
+        registry.acquire(empty)
+    assert entry(registry, empty)["in_use"] == 0
+
+
+def test_process_wide_registry():
+    assert pysfizz.instrument_registry() is pysfizz.instrument_registry()
@@ -0,0 +1,116 @@
+import os
+from pathlib import Path
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load, tone, write_wav
+
+
+def touch(path):
+    stat = path.stat()
+    os.utime(path, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+
+
+def render(synth):
+    return synth.render_note(69, 100, 0.5, 1.0)
+
+
+def test_unchanged(sample_sfz):
+    synth = load(sample_sfz)
+    assert synth.reload_if_changed() == {"reloaded": False, "success": True, "text_changed": False,
+                                         "changed_samples": []}
+    np.testing.assert_array_equal(render(synth), render(load(sample_sfz)))
+
+
+def test_changed_text(sample_sfz):
+    synth = load(sample_sfz)
+    sample_sfz.write_text("<region> sample=tone.wav pitch_keycenter=57 ampeg_release=0.05\n")
+    touch(sample_sfz)
+    result = synth.reload_if_changed()
+    assert result["reloaded"] and result["success"] and result["text_changed"]
+    assert result["changed_samples"] == []
+    np.testing.assert_array_equal(render(synth), render(load(sample_sfz)))
+    assert not synth.reload_if_changed()["reloaded"]
+
+
+def test_changed_include(tmp_path, sample_sfz):
+    (tmp_path / "release.sfz").write_text("ampeg_release=0.05\n")
+    sample_sfz.write_text('<region> sample=tone.wav pitch_keycenter=69\n#include "release.sfz"\n')
+    synth = load(sample_sfz)
+    (tmp_path / "release.sfz").write_text("ampeg_release=0.2\n")
+    touch(tmp_path / "release.sfz")
+    result = synth.reload_if_changed()
+    assert result["reloaded"] and result["text_changed"]
+    np.testing.assert_array_equal(render(synth), render(load(sample_sfz)))
+
+
+def test_changed_sample(tmp_path, sample_sfz):
+    synth = load(sample_sfz)
+    write_wav(tmp_path / "tone.wav", tone(440, 0.5, amplitude=0.25))
+    touch(tmp_path / "tone.wav")
+    result = synth.reload_if_changed()
+    assert result["reloaded"] and result["success"] and not result["text_changed"]
+    assert [Path(p).resolve() for p in result["changed_samples"]] == [(tmp_path / "tone.wav").resolve()]
+    np.testing.assert_array_equal(render(synth), render(load(sample_sfz)))
+
+
+def test_vanished_file_keeps_the_instrument(sample_sfz):
+    synth = load(sample_sfz)
+    expected = render(synth)
+    sample_sfz.unlink()
+    result = synth.reload_if_changed()
+    assert not result["reloaded"] and not result["success"]
+    assert synth.path == str(sample_sfz)
+    np.testing.assert_array_equal(render(synth), expected)
+
+
+def test_failed_reload_leaves_no_instrument(sample_sfz):
+    synth = load(sample_sfz)
+    sample_sfz.write_text("// no regions\n")
+    touch(sample_sfz)
+    result = synth.reload_if_changed()
+    assert result["reloaded"]
+    assert synth.path is None
+    with pytest.raises(ValueError):
+        synth.reload_if_changed()
+
+
+def test_include_cache_copy_follows(tmp_path, sample_sfz):
+    cache = tmp_path / "cache"
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(sample_sfz, include_cache=cache)
+    sample_sfz.write_text("<region> sample=tone.wav pitch_keycenter=57 ampeg_release=0.05\n")
+    touch(sample_sfz)
+    assert synth.reload_if_changed()["reloaded"]
+    # a later cached load finds the copy rebuilt by the reload
+    (compiled,) = cache.iterdir()
+    mtime = compiled.stat().st_mtime_ns
+    again = pysfizz.Synth()
+    assert again.load_sfz_file(sample_sfz, include_cache=cache)
+    assert compiled.stat().st_mtime_ns == mtime
+    np.testing.assert_array_equal(render(again), render(synth))
+
+
+def test_touched_cached_file_is_not_reloaded(tmp_path, sample_sfz):
+    # a cached load knows the compiled text, so a touch alone reloads nothing
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(sample_sfz, include_cache=tmp_path / "cache")
+    touch(sample_sfz)
+    assert synth._synth.files_changed()
+    assert not synth.reload_if_changed()["reloaded"]
+    assert not synth._synth.files_changed()
+
+
+def test_requires_a_file(tmp_path, sample_sfz):
+    with pytest.raises(ValueError):
+        pysfizz.Synth().reload_if_changed()
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_string(sample_sfz.read_text(), tmp_path / "virtual.sfz")
+    with pytest.raises(ValueError):
+        synth.reload_if_changed()
+    pack = pysfizz.pack_instrument(sample_sfz)
+    synth = load(pack)
+    with pytest.raises(ValueError):
+        synth.reload_if_changed()
@@ -0,0 +1,80 @@
+import numpy as np
+import pytest
+
+from conftest import load
+
+
+def python_render_note(synth, pitch, vel, note_on_dur, render_dur):
+    # the Python block loop that render_note replaced: note-on at frame 0,
+    # note-off after note_on_dur seconds, output cut to render_dur seconds
+    raw = synth._synth
+    rate, block_size = raw.get_sample_rate(), raw.get_block_size()
+    note_on_frames = int(rate * note_on_dur)
+    render_frames = int(rate * render_dur)
+    blocks = []
+
+    def render():
+        left, right = raw.render_block()
+        blocks.append(np.array([left, right]))  # the block buffers are reused
+
+    raw.note_on(0, pitch, vel)
+    for _ in range(note_on_frames // block_size):
+        render()
+    raw.note_off(note_on_frames % block_size, pitch, 0)
+    while sum(block.shape[1] for block in blocks) < render_frames:
+        render()
+    return np.concatenate(blocks, axis=1)[:, :render_frames]
+
+
+@pytest.mark.parametrize("note_on_dur, render_dur", [(0.5, 1.0), (0.3333, 0.75), (1.0, 0.5), (0.0, 0.2)])
+def test_matches_block_loop(sine_sfz, note_on_dur, render_dur):
+    audio = load(sine_sfz, block_size=256).render_note(69, 100, note_on_dur, render_dur)
+    expected = python_render_note(load(sine_sfz, block_size=256), 69, 100, note_on_dur, render_dur)
+    assert audio.shape == expected.shape == (2, int(48000 * render_dur))
+    assert audio.dtype == np.float32
+    np.testing.assert_allclose(audio, expected, atol=1e-6)
+
+
+def test_sample_instrument_matches_block_loop(sample_sfz):
+    audio = load(sample_sfz).render_note(69, 127, 0.4, 0.6)
+    expected = python_render_note(load(sample_sfz), 69, 127, 0.4, 0.6)
+    assert np.abs(audio).max() > 0.01
+    np.testing.assert_allclose(audio, expected, atol=1e-6)
+
+
+def test_leaves_synth_silent(sine_sfz):
+    synth = load(sine_sfz)
+    first = synth.render_note(60, 100, 2.0, 0.5)  # cut while the note is held
+    assert synth.get_num_active_voices() == 0
+    np.testing.assert_array_equal(synth.render_note(60, 100, 2.0, 0.5), first)
+
+
+def test_release_tail_does_not_leak(tmp_path):
+    # the release outlasts the render: it must not sound in the next one
+    path = tmp_path / "tail.sfz"
+    path.write_text("<region> sample=*sine ampeg_release=5\n")
+    synth = load(path)
+    first = synth.render_note(69, 100, 0.1, 0.5)
+    assert synth.get_num_active_voices() == 0
+    np.testing.assert_array_equal(synth.render_note(69, 100, 0.1, 0.5), first)
+
+
+def test_renders_into_out(sine_sfz):
+    synth = load(sine_sfz)
+    out = np.full(synth.output_shape(0.5), np.nan, dtype=np.float32)
+    assert synth.render_note(69, 100, 0.25, 0.5, out=out) is out
+    np.testing.assert_array_equal(out, load(sine_sfz).render_note(69, 100, 0.25, 0.5))
+
+
+def test_rejects_wrong_out(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(ValueError):
+        synth.render_note(69, 100, 0.25, 0.5, out=np.zeros((2, 10), dtype=np.float32))
+    with pytest.raises(TypeError):
+        synth.render_note(69, 100, 0.25, 0.5, out=np.zeros(synth.output_shape(0.5), dtype=np.float64))
+
+
+@pytest.mark.parametrize("args", [(128, 100, 0.5, 1.0), (60, -1, 0.5, 1.0), (60, 100, -0.5, 1.0), (60, 100, 0.5, -1.0)])
+def test_rejects_invalid_arguments(sine_sfz, args):
+    with pytest.raises(ValueError):
+        load(sine_sfz).render_note(*args)
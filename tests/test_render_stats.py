@@ -0,0 +1,89 @@
+import math
+
+import numpy as np
+import pytest
+
+from conftest import load, tone
+
+# ITU-R BS.1770 K-weighting at 48 kHz: high shelf, then high pass
+SHELF = ([1.53512485958697, -2.69169618940638, 1.19839281085285], [1.0, -1.69065929318241, 0.73248077421585])
+HIGH_PASS = ([1.0, -2.0, 1.0], [1.0, -1.99004745483398, 0.99007225036621])
+
+
+def biquad(x, coefficients):
+    (b0, b1, b2), (_, a1, a2) = coefficients
+    y = np.empty(len(x))
+    x1 = x2 = y1 = y2 = 0.0
+    for i, xi in enumerate(x.tolist()):
+        yi = b0 * xi + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2
+        x2, x1, y2, y1 = x1, xi, y1, yi
+        y[i] = yi
+    return y
+
+
+def reference_loudness(audio, sample_rate=48000):
+    # gated integrated loudness of (channels, frames) audio, per BS.1770-4
+    weighted = [biquad(biquad(channel.astype(np.float64), SHELF), HIGH_PASS) for channel in audio]
+    block, step = int(0.4 * sample_rate), int(0.1 * sample_rate)
+    energies = np.array([
+        sum(np.mean(channel[start:start + block] ** 2) for channel in weighted)
+        for start in range(0, audio.shape[1] - block + 1, step)
+    ])
+    loudness = lambda energy: -0.691 + 10 * math.log10(energy)
+    gated = energies[energies > 10 ** ((-70 + 0.691) / 10)]
+    relative = loudness(gated.mean()) - 10
+    return loudness(gated[gated > 10 ** ((relative + 0.691) / 10)].mean())
+
+
+def test_reference_matches_ebu_tech_3341():
+    # test case 1: stereo 1 kHz sine at -23 dBFS reads -23 LUFS
+    audio = tone(1000, 3.0, amplitude=10 ** (-23 / 20), channels=2).T
+    assert reference_loudness(audio) == pytest.approx(-23.0, abs=0.1)
+
+
+def test_loudness_matches_reference(sample_sfz):
+    audio, stats = load(sample_sfz).render_note(69, 100, 1.5, 2.0, stats=True)
+    assert stats["loudness_lufs"] == pytest.approx(reference_loudness(audio), abs=0.01)
+
+
+def test_peak_and_rms_match_audio(sample_sfz):
+    audio, stats = load(sample_sfz).render_note(69, 100, 0.5, 1.0, stats=True)
+    audio = audio.astype(np.float64)
+    assert stats["num_frames"] == audio.shape[1]
+    assert stats["peak"] == pytest.approx(np.abs(audio).max(), rel=1e-6)
+    assert stats["peak_db"] == pytest.approx(20 * math.log10(np.abs(audio).max()), abs=1e-4)
+    assert stats["rms"] == pytest.approx(math.sqrt(np.mean(audio ** 2)), rel=1e-5)
+    assert stats["channel_peak"] == pytest.approx(np.abs(audio).max(axis=1), rel=1e-6)
+    assert stats["channel_rms"] == pytest.approx(np.sqrt(np.mean(audio ** 2, axis=1)), rel=1e-5)
+    assert stats["normalization_gain_db"] == 0.0
+
+
+def test_silence(sine_sfz):
+    audio, stats = load(sine_sfz).render_note(69, 0, 0.1, 0.3, stats=True)
+    assert not audio.any()
+    assert stats["peak"] == 0.0
+    assert stats["loudness_lufs"] == -math.inf
+
+
+def test_short_render_has_no_loudness(sine_sfz):
+    _, stats = load(sine_sfz).render_note(69, 100, 0.1, 0.3, stats=True)
+    assert stats["peak"] > 0.0
+    assert stats["loudness_lufs"] == -math.inf  # shorter than one 400 ms gating block
+
+
+@pytest.mark.parametrize("normalize, target", [("peak", -1.0), ("peak", -6.0), ("loudness", -23.0)])
+def test_normalize(sample_sfz, normalize, target):
+    plain = load(sample_sfz).render_note(69, 100, 1.5, 2.0)
+    audio, stats = load(sample_sfz).render_note(69, 100, 1.5, 2.0, stats=True, normalize=normalize, target=target)
+    measured = stats["peak_db"] if normalize == "peak" else stats["loudness_lufs"]
+    assert stats["normalization_gain_db"] == pytest.approx(target - measured)
+    np.testing.assert_allclose(audio, plain * 10 ** (stats["normalization_gain_db"] / 20), rtol=1e-5, atol=1e-7)
+    if normalize == "peak":
+        assert 20 * math.log10(np.abs(audio).max()) == pytest.approx(target, abs=1e-3)
+    else:
+        assert reference_loudness(audio) == pytest.approx(target, abs=0.05)
+
+
+def test_target_requires_normalize(sine_sfz):
+    with pytest.raises(ValueError):
+        load(sine_sfz).render_note(69, 100, 0.5, 1.0, target=-3.0)
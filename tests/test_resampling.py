@@ -0,0 +1,79 @@
+import numpy as np
+import pytest
+
+from conftest import load
+
+QUALITIES = ("fast", "medium", "best")
+
+
+def rms(audio):
+    # of the steady part, away from the attack, release and filter edges
+    middle = audio[..., audio.shape[-1] // 4:audio.shape[-1] * 3 // 4]
+    return np.sqrt(np.mean(middle.astype(np.float64) ** 2))
+
+
+def note_frequency(note):
+    return 440.0 * 2 ** ((note - 69) / 12)
+
+
+@pytest.mark.parametrize("output_rate", [8000, 16000, 44100, 44101, 96000])
+def test_length(sine_sfz, output_rate):
+    audio = load(sine_sfz).render_note(69, 100, 0.5, 0.75, output_sample_rate=output_rate)
+    assert audio.shape == (2, int(output_rate * 0.75))
+
+
+def test_same_rate_is_not_resampled(sine_sfz):
+    plain = load(sine_sfz).render_note(69, 100, 0.5, 0.75)
+    same = load(sine_sfz).render_note(69, 100, 0.5, 0.75, output_sample_rate=48000)
+    np.testing.assert_array_equal(same, plain)
+
+
+@pytest.mark.parametrize("quality", QUALITIES)
+@pytest.mark.parametrize("output_rate", [16000, 44100, 96000])
+def test_keeps_pitch_and_level_in_passband(sine_sfz, quality, output_rate):
+    plain = load(sine_sfz).render_note(69, 100, 1.0, 1.0)
+    audio = load(sine_sfz).render_note(69, 100, 1.0, 1.0, output_sample_rate=output_rate,
+                                       resample_quality=quality)
+    spectrum = np.abs(np.fft.rfft(audio[0] * np.hanning(audio.shape[1])))
+    peak = np.fft.rfftfreq(audio.shape[1], 1 / output_rate)[np.argmax(spectrum)]
+    assert peak == pytest.approx(440.0, abs=2.0)
+    assert 20 * np.log10(rms(audio) / rms(plain)) == pytest.approx(0.0, abs=0.1)
+
+
+@pytest.mark.parametrize("quality", QUALITIES)
+@pytest.mark.parametrize("output_rate", [44101, 96001])
+def test_coprime_rates(sine_sfz, quality, output_rate):
+    # too many phases for an exact filter: they are interpolated, as
+    # precise as a nearby reducible rate
+    near = load(sine_sfz).render_note(69, 100, 1.0, 1.0, output_sample_rate=output_rate - 1,
+                                      resample_quality=quality)
+    audio = load(sine_sfz).render_note(69, 100, 1.0, 1.0, output_sample_rate=output_rate,
+                                       resample_quality=quality)
+    assert audio.shape == (2, output_rate)
+    spectrum = np.abs(np.fft.rfft(audio[0] * np.hanning(audio.shape[1])))
+    assert np.fft.rfftfreq(audio.shape[1], 1 / output_rate)[np.argmax(spectrum)] == pytest.approx(440.0, abs=2.0)
+    assert 20 * np.log10(rms(audio) / rms(near)) == pytest.approx(0.0, abs=0.01)
+
+
+@pytest.mark.parametrize("quality", QUALITIES)
+def test_rejects_above_output_nyquist(sine_sfz, quality):
+    # a 5.9 kHz tone has no place in an 8 kHz output; what passes is aliasing
+    note = 114
+    assert note_frequency(note) > 1.4 * 4000
+    plain = load(sine_sfz).render_note(note, 100, 1.0, 1.0)
+    audio = load(sine_sfz).render_note(note, 100, 1.0, 1.0, output_sample_rate=8000, resample_quality=quality)
+    assert 20 * np.log10(rms(audio) / rms(plain)) < -40
+
+
+def test_statistics_at_output_rate(sine_sfz):
+    audio, stats = load(sine_sfz).render_note(69, 100, 0.5, 0.75, output_sample_rate=16000, stats=True)
+    assert stats["num_frames"] == audio.shape[1]
+    assert stats["peak"] == pytest.approx(np.abs(audio).max(), rel=1e-6)
+
+
+def test_rejects_invalid_options(sine_sfz):
+    synth = load(sine_sfz)
+    with pytest.raises(ValueError):
+        synth.render_note(69, 100, 0.5, 0.75, output_sample_rate=0)
+    with pytest.raises(ValueError):
+        synth.render_note(69, 100, 0.5, 0.75, output_sample_rate=16000, resample_quality="perfect")
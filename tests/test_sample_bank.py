@@ -0,0 +1,98 @@
+import numpy as np
+import pytest
+
+import pysfizz
+from pysfizz.memory_samples import _wav_header
+from conftest import SAMPLE_RATE, load, tone, write_wav
+
+REGION = "<region> sample=tone.wav pitch_keycenter=69 ampeg_release=0.05\n"
+
+
+def test_bank_renders_like_a_file(tmp_path):
+    audio = tone(440, 1.0)
+    write_wav(tmp_path / "tone.wav", audio)
+    (tmp_path / "tone.sfz").write_text(REGION)
+    with pysfizz.SampleBank() as bank:
+        bank.add("tone.wav", audio, sample_rate=SAMPLE_RATE)
+        synth = pysfizz.Synth()
+        assert synth.load_sfz_string(REGION, samples=bank)
+        expected = load(tmp_path / "tone.sfz").render_note(69, 100, 0.5, 1.0)
+        # the file holds the tone as 16-bit PCM
+        np.testing.assert_allclose(synth.render_note(69, 100, 0.5, 1.0), expected, atol=1e-4)
+
+
+def test_layouts_and_dtypes():
+    bank = pysfizz.SampleBank()
+    mono = tone(220, 0.5)
+    bank.add("mono.wav", mono.astype(np.float64), sample_rate=44100)
+    bank.add("dir/stereo.wav", tone(220, 0.5, channels=2)[::-1], sample_rate=SAMPLE_RATE)
+    assert bank.names() == ["dir/stereo.wav", "mono.wav"]
+    assert bank.info("mono.wav") == (mono.shape[0], 1, 44100)
+    assert bank.info("dir/stereo.wav") == (mono.shape[0], 2, SAMPLE_RATE)
+    assert "mono.wav" in bank and "other.wav" not in bank
+    data = (bank.directory / "mono.wav").read_bytes()
+    header = _wav_header(mono.shape[0], 1, 44100)
+    assert data[:len(header)] == header
+    np.testing.assert_array_equal(np.frombuffer(data, dtype="<f4", offset=len(header)), mono)
+
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_string("<region> sample=mono.wav key=60\n<region> sample=dir/stereo.wav key=62\n",
+                                 samples=bank)
+    assert synth.playable_keys == [60, 62]
+    bank.close()
+
+
+def test_nbytes_counts_files():
+    bank = pysfizz.SampleBank()
+    assert bank.nbytes() == 0
+    bank.add("a.wav", tone(440, 0.25), sample_rate=SAMPLE_RATE)
+    bank.add("b.wav", tone(440, 0.5, channels=2), sample_rate=SAMPLE_RATE)
+    assert bank.nbytes() == sum(p.stat().st_size for p in bank.directory.iterdir())
+    bank.remove("a.wav")
+    assert bank.names() == ["b.wav"]
+    assert bank.nbytes() == (bank.directory / "b.wav").stat().st_size
+    bank.close()
+
+
+def test_replacing_a_sample():
+    with pysfizz.SampleBank() as bank:
+        bank.add("tone.wav", tone(440, 1.0), sample_rate=SAMPLE_RATE)
+        synth = pysfizz.Synth()
+        assert synth.load_sfz_string(REGION, samples=bank)
+        first = synth.render_note(69, 100, 0.5, 1.0)
+        bank.add("tone.wav", tone(440, 1.0, amplitude=0.25), sample_rate=SAMPLE_RATE)
+        assert synth.load_sfz_string(REGION, samples=bank)
+        np.testing.assert_allclose(synth.render_note(69, 100, 0.5, 1.0), 0.5 * first, atol=1e-6)
+
+
+@pytest.mark.parametrize("name", ["../escape.wav", "/absolute.wav", "a/../../b.wav", "bad:name.wav", ""])
+def test_invalid_names(name):
+    with pysfizz.SampleBank() as bank:
+        with pytest.raises(ValueError):
+            bank.add(name, tone(440, 0.1), sample_rate=SAMPLE_RATE)
+
+
+def test_invalid_audio():
+    with pysfizz.SampleBank() as bank:
+        with pytest.raises(ValueError):
+            bank.add("a.wav", np.zeros((10, 3), dtype=np.float32), sample_rate=SAMPLE_RATE)
+        with pytest.raises(ValueError):
+            bank.add("a.wav", np.zeros((2, 2, 2), dtype=np.float32), sample_rate=SAMPLE_RATE)
+        with pytest.raises(ValueError):
+            bank.add("a.wav", np.zeros(10, dtype=np.float32), sample_rate=0)
+        assert bank.names() == []
+
+
+def test_close_removes_files(tmp_path):
+    bank = pysfizz.SampleBank(root=tmp_path)
+    assert bank.directory.parent == tmp_path
+    bank.add("tone.wav", tone(440, 0.1), sample_rate=SAMPLE_RATE)
+    bank.close()
+    assert not bank.directory.exists()
+    assert bank.names() == []
+
+
+def test_exclusive_with_virtual_path(tmp_path):
+    with pysfizz.SampleBank() as bank:
+        with pytest.raises(ValueError):
+            pysfizz.Synth().load_sfz_string(REGION, virtual_path=tmp_path / "a.sfz", samples=bank)
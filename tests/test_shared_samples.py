@@ -0,0 +1,70 @@
+import pickle
+
+import numpy as np
+
+import pysfizz
+from pysfizz.shared_samples import STREAMING_PRELOAD_SIZE, _instrument_files
+from conftest import SAMPLE_RATE, load, tone, write_wav
+
+
+def load_streaming(path):
+    synth = pysfizz.Synth()
+    assert synth.load_sfz_file(path, streaming=True)
+    return synth
+
+
+EVENTS = [(0.0, "note_on", 69, 100), (0.9, "note_off", 69), (0.2, "note_on", 76, 90), (0.8, "note_off", 76)]
+
+
+def test_streaming_load_preloads_less(sample_sfz):
+    synth = load_streaming(sample_sfz)
+    assert synth.get_preload_size() == STREAMING_PRELOAD_SIZE
+    # the tone is longer than the preloaded part, unlike a synth preloading whole samples
+    assert SAMPLE_RATE > STREAMING_PRELOAD_SIZE
+    whole = pysfizz.Synth()
+    whole.set_preload_size(2 * SAMPLE_RATE)
+    assert whole.load_sfz_file(sample_sfz)
+    assert 0 < synth.get_sample_memory() < whole.get_sample_memory()
+
+
+def test_streaming_load_renders_the_same(sample_sfz):
+    # the end of the sample is streamed from the file; freewheeling waits for it
+    expected = load(sample_sfz).render_events(EVENTS, 1.0)
+    np.testing.assert_array_equal(load_streaming(sample_sfz).render_events(EVENTS, 1.0), expected)
+
+
+def test_later_load_restores_preload_size(sample_sfz, sine_sfz):
+    synth = pysfizz.Synth()
+    synth.set_preload_size(4 * STREAMING_PRELOAD_SIZE)
+    assert synth.load_sfz_file(sample_sfz, streaming=True)
+    assert synth.load_sfz_file(sample_sfz, streaming=True)
+    assert synth.get_preload_size() == STREAMING_PRELOAD_SIZE
+    assert synth.load_sfz_file(sine_sfz)
+    assert synth.get_preload_size() == 4 * STREAMING_PRELOAD_SIZE
+    # a size set meanwhile is kept
+    assert synth.load_sfz_file(sample_sfz, streaming=True)
+    synth.set_preload_size(1024)
+    assert synth.load_sfz_string("<region> sample=*sine")
+    assert synth.get_preload_size() == 1024
+
+
+def test_pickled_streaming_synth_restores_preload_size(sample_sfz, sine_sfz):
+    synth = pysfizz.Synth()
+    default = synth.get_preload_size()
+    assert synth.load_sfz_file(sample_sfz, streaming=True)
+    copy = pickle.loads(pickle.dumps(synth))
+    assert copy.get_preload_size() == STREAMING_PRELOAD_SIZE
+    assert copy.load_sfz_file(sine_sfz)
+    assert copy.get_preload_size() == default
+
+
+def test_instrument_files(tmp_path):
+    write_wav(tmp_path / "a.wav", tone(440, 0.1))
+    (tmp_path / "samples").mkdir()
+    write_wav(tmp_path / "samples" / "b.wav", tone(880, 0.1))
+    (tmp_path / "regions.sfz").write_text("<region> sample=samples/b.wav key=62\n")
+    sfz = tmp_path / "inst.sfz"
+    sfz.write_text('<region> sample=a.wav key=60\n<region> sample=*sine key=61\n#include "regions.sfz"\n')
+    assert _instrument_files(sfz.resolve()) == {
+        (tmp_path / name).resolve() for name in ("inst.sfz", "regions.sfz", "a.wav", "samples/b.wav")
+    }
@@ -0,0 +1,57 @@
+import os
+import platform
+import subprocess
+import sys
+
+import numpy as np
+import pytest
+
+import pysfizz
+from conftest import load
+
+
+@pytest.fixture
+def restore_simd_path():
+    active = pysfizz.simd_path()
+    yield
+    pysfizz.set_simd_path(active)
+
+
+def test_fastest_path_is_active():
+    paths = pysfizz.simd_paths()
+    assert paths[0] in ("sse2", "generic")  # the baseline of the architecture
+    if platform.machine().lower() in ("arm64", "aarch64"):
+        assert "neon" in paths
+    assert pysfizz.simd_path() == paths[-1]
+
+
+def test_paths_render_alike(sample_sfz, restore_simd_path):
+    # the kernels convert layouts, apply gains and measure levels
+    events = [(0.0, "note_on", 69, 100), (0.3, "note_on", 76, 80), (0.8, "note_off", 69), (0.9, "note_off", 76)]
+    options = dict(channels="mid_side", stats=True, normalize="peak")
+    results = {}
+    for path in pysfizz.simd_paths():
+        pysfizz.set_simd_path(path)
+        assert pysfizz.simd_path() == path
+        results[path] = load(sample_sfz).render_events(events, 1.2, **options)
+    reference, reference_stats = results[pysfizz.simd_paths()[0]]
+    for audio, stats in results.values():
+        np.testing.assert_allclose(audio, reference, atol=1e-6)
+        assert stats["peak"] == pytest.approx(reference_stats["peak"], rel=1e-6)
+        assert stats["rms"] == pytest.approx(reference_stats["rms"], rel=1e-6)
+
+
+def test_rejects_unknown_path(restore_simd_path):
+    with pytest.raises(ValueError):
+        pysfizz.set_simd_path("neon9000")
+
+
+@pytest.mark.parametrize("requested", ["baseline", "unknown"])
+def test_environment_override(requested):
+    paths = pysfizz.simd_paths()
+    name = paths[0] if requested == "baseline" else "unknown"
+    code = "import pysfizz; print(pysfizz.simd_path())"
+    result = subprocess.run([sys.executable, "-c", code], env={**os.environ, "PYSFIZZ_SIMD": name},
+                            capture_output=True, text=True, check=True)
+    # an unknown or unsupported name falls back to the fastest path
+    assert result.stdout.strip() == (paths[0] if requested == "baseline" else paths[-1])
@@ -0,0 +1,115 @@
+import numpy as np
+import pytest
+
+from conftest import load
+
+
+def phrases(count=12, gap=0.8):
+    # short phrases separated by silences longer than the release and margin
+    events = []
+    for i in range(count):
+        start = i * (0.4 + gap)
+        for offset, note in ((0.0, 60 + i % 5), (0.1, 67), (0.15, 72 - i % 3)):
+            events.append((start + offset, "note_on", note, 90))
+            events.append((start + 0.4, "note_off", note))
+    return sorted(events, key=lambda e: e[0]), count * (0.4 + gap)
+
+
+@pytest.mark.parametrize("time_slices", [2, 4, 8])
+def test_matches_serial_render(sine_sfz, time_slices):
+    events, duration = phrases()
+    serial = load(sine_sfz).render_events(events, duration)
+    sliced = load(sine_sfz).render_events(events, duration, time_slices=time_slices)
+    assert np.abs(serial).max() > 0
+    np.testing.assert_allclose(sliced, serial, atol=1e-6)
+
+
+def test_sample_instrument_matches_serial_render(sample_sfz):
+    events, duration = phrases()
+    serial = load(sample_sfz).render_events(events, duration)
+    sliced = load(sample_sfz).render_events(events, duration, time_slices=4)
+    np.testing.assert_allclose(sliced, serial, atol=1e-6)
+
+
+def test_matches_serial_render_with_options(sine_sfz):
+    events, duration = phrases()
+    options = dict(channels="mono", output_sample_rate=44100, stats=True)
+    serial, serial_stats = load(sine_sfz).render_events(events, duration, **options)
+    sliced, sliced_stats = load(sine_sfz).render_events(events, duration, time_slices=4, **options)
+    np.testing.assert_allclose(sliced, serial, atol=1e-6)
+    assert sliced_stats["peak"] == pytest.approx(serial_stats["peak"])
+    assert sliced_stats["loudness_lufs"] == pytest.approx(serial_stats["loudness_lufs"], abs=1e-3)
+
+
+def test_controllers_carry_over_slices(tmp_path):
+    path = tmp_path / "volume.sfz"
+    path.write_text("<region> sample=*sine amplitude_oncc7=100 amplitude=0 ampeg_release=0.05\n")
+    events, duration = phrases()
+    events = [(0.0, "cc", 7, 127)] + events + [(duration / 2, "cc", 7, 40)]
+    events.sort(key=lambda e: e[0])
+    serial = load(path).render_events(events, duration)
+    sliced = load(path).render_events(events, duration, time_slices=4)
+    np.testing.assert_allclose(sliced, serial, atol=1e-6)
+
+
+def test_no_silent_point_renders_whole(sine_sfz):
+    # one held note: nowhere to cut
+    events = [(0.0, "note_on", 48, 100), (4.0, "note_off", 48)] + phrases(4)[0]
+    serial = load(sine_sfz).render_events(events, 5.0)
+    np.testing.assert_allclose(load(sine_sfz).render_events(events, 5.0, time_slices=4), serial, atol=1e-6)
+
+
+def test_round_robins_render_serially(tmp_path):
+    # the replica of a later slice cannot know which sample comes next
+    path = tmp_path / "round_robin.sfz"
+    path.write_text(
+        "<group> seq_length=2 ampeg_release=0.05\n"
+        "<region> sample=*sine seq_position=1\n"
+        "<region> sample=*saw seq_position=2\n"
+    )
+    events, duration = phrases(count=7)
+    serial = load(path).render_events(events, duration)
+    np.testing.assert_array_equal(load(path).render_events(events, duration, time_slices=4), serial)
+
+
+@pytest.mark.parametrize("text", [
+    "<effect> bus=fx1 type=lofi\n<region> sample=*sine effect1=50 ampeg_release=0.05\n",
+    "<region> sample=*sine ampeg_release=0.05\n<region> sample=*saw on_locc64=64 on_hicc64=127\n",
+    "<region> sample=*noise ampeg_release=0.05\n",
+])
+def test_stateful_instruments_render_serially(tmp_path, text):
+    # effect tails, CC-triggered regions and noise cannot be picked up by a replica
+    path = tmp_path / "stateful.sfz"
+    path.write_text(text)
+    synth = load(path)
+    events, duration = phrases(count=4)
+    synth.render_events(events, duration, time_slices=4)
+    assert synth.memory_report()["replicas"] == 0
+
+
+def test_velocity_release_is_predicted(tmp_path):
+    # the release grows with velocity: the cuts must wait for it
+    path = tmp_path / "velocity.sfz"
+    path.write_text("<region> sample=*sine ampeg_release=0.05 ampeg_vel2release=0.5\n")
+    events, duration = phrases()
+    serial = load(path).render_events(events, duration)
+    synth = load(path)
+    sliced = synth.render_events(events, duration, time_slices=4, slice_margin=0.05)
+    assert synth.memory_report()["replicas"] > 0
+    np.testing.assert_allclose(sliced, serial, atol=1e-6)
+
+
+def test_sounding_voices_render_serially(sine_sfz):
+    # a note started before the call would only play in the first slice
+    events, duration = phrases()
+    expected, synth = load(sine_sfz), load(sine_sfz)
+    for s in (expected, synth):
+        s._synth.note_on(0, 48, 100)
+    serial = expected.render_events(events, duration)
+    np.testing.assert_array_equal(synth.render_events(events, duration, time_slices=4), serial)
+    assert synth.memory_report()["replicas"] == 0
+
+
+def test_rejects_invalid_slices(sine_sfz):
+    with pytest.raises(ValueError):
+        load(sine_sfz).render_events(phrases()[0], 1.0, time_slices=0)